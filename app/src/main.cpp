@@ -3,8 +3,13 @@
 #include "hvk/hello_vulkan.hpp"
 
 int main() {
-    auto engine =
-        std::make_unique<hvk::Engine>("Hello Vulkan", 1920, 1080, hvk::BufferingMode::Double);
+    auto engine = std::make_unique<hvk::Engine>(
+        "Hello Vulkan",
+        1920,
+        1080,
+        hvk::BufferingMode::Double,
+        hvk::UpdateMode::Pipelined
+    );
 
     engine->init();
     engine->run();
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "hvk/bc_encoder.hpp"
+#include "hvk/pixel_kernels.hpp"
+
+// times the texture import kernels and the BC encoder (on one thread) at every
+// SIMD level this CPU supports, starting with the `*_scalar` references. each
+// result is the best of several runs over one image that is larger than the
+// caches, and is checked against the scalar output of the same kernel.
+//
+//   cmake -S . -B build -DHVK_BUILD_BENCHMARKS=ON
+//   cmake --build build --target hvkbench
+//   ./build/bench/hvkbench
+
+namespace hvk {
+
+inline constexpr u32 BENCH_WIDTH = 2048;
+inline constexpr u32 BENCH_HEIGHT = 2048;
+inline constexpr usize BENCH_TEXELS = static_cast<usize>(BENCH_WIDTH) * BENCH_HEIGHT;
+inline constexpr usize BENCH_RUNS = 15;
+
+struct BenchKernel {
+    std::string_view name{};
+    // bytes read and written by one call, for the throughput column
+    usize bytes{};
+    // restores the input of in-place kernels, not timed
+    std::function<void()> reset{};
+    std::function<void()> run{};
+    // output of the last run, compared against the scalar level
+    std::function<std::vector<u8>()> result{};
+};
+
+std::string_view simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar:
+            return "scalar";
+        case SimdLevel::SSE2:
+            return "sse2";
+        case SimdLevel::AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+double best_run_ms(const BenchKernel& kernel) {
+    double best = std::numeric_limits<double>::max();
+    for (usize i = 0; i < BENCH_RUNS; i++) {
+        if (kernel.reset) {
+            kernel.reset();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        kernel.run();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+}  // namespace hvk
+
+int main() {
+    using namespace hvk;
+
+    // noise with a mix of opaque, translucent and transparent alpha so every
+    // branch of the alpha kernels is taken
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<u32> byte{0, 255};
+    std::vector<u8> rgba(BENCH_TEXELS * 4);
+    for (usize i = 0; i < rgba.size(); i++) {
+        const auto value = static_cast<u8>(byte(rng));
+        rgba[i] = i % 4 == 3 && value < 128 ? 255 : value;
+    }
+    std::vector<u8> rgb(BENCH_TEXELS * 3);
+    for (usize i = 0; i < BENCH_TEXELS; i++) {
+        std::memcpy(&rgb[i * 3], &rgba[i * 4], 3);
+    }
+
+    std::vector<u8> work(rgba.size());
+    std::vector<u8> half(BENCH_TEXELS);
+    AlphaCount alpha{};
+    auto reset_work = [&]() { std::memcpy(work.data(), rgba.data(), rgba.size()); };
+    std::vector<u8> blocks{};
+    auto work_result = [&]() { return work; };
+    auto half_result = [&]() { return half; };
+    auto blocks_result = [&]() { return blocks; };
+
+    const std::array<BenchKernel, 8> kernels{{
+        {
+            "count_alpha",
+            rgba.size(),
+            {},
+            [&]() { alpha = count_alpha(rgba.data(), BENCH_TEXELS, 1, 254); },
+            [&]() {
+                std::vector<u8> bytes(sizeof(alpha));
+                std::memcpy(bytes.data(), &alpha, sizeof(alpha));
+                return bytes;
+            },
+        },
+        {
+            "expand_rgb_to_rgba",
+            rgb.size() + work.size(),
+            {},
+            [&]() { expand_rgb_to_rgba(rgb.data(), work.data(), BENCH_TEXELS); },
+            work_result,
+        },
+        {
+            "premultiply_alpha",
+            2 * work.size(),
+            reset_work,
+            [&]() { premultiply_alpha(work.data(), BENCH_TEXELS); },
+            work_result,
+        },
+        {
+            "downsample_2x2_rgba8",
+            rgba.size() + half.size(),
+            {},
+            [&]() {
+                downsample_2x2_rgba8(rgba.data(), BENCH_WIDTH, BENCH_HEIGHT, false, half.data());
+            },
+            half_result,
+        },
+        {
+            "downsample_2x2_rgba8 (srgb)",
+            rgba.size() + half.size(),
+            {},
+            [&]() {
+                downsample_2x2_rgba8(rgba.data(), BENCH_WIDTH, BENCH_HEIGHT, true, half.data());
+            },
+            half_result,
+        },
+        {
+            "swizzle_rgba8",
+            2 * work.size(),
+            reset_work,
+            [&]() { swizzle_rgba8(work.data(), BENCH_TEXELS, {2, 1, 0, 3}); },
+            work_result,
+        },
+        {
+            "encode_bc (bc1)",
+            rgba.size() + bc_level_size(BcFormat::BC1, BENCH_WIDTH, BENCH_HEIGHT),
+            {},
+            [&]() { blocks = encode_bc(rgba.data(), BENCH_WIDTH, BENCH_HEIGHT, BcFormat::BC1); },
+            blocks_result,
+        },
+        {
+            "encode_bc (bc3)",
+            rgba.size() + bc_level_size(BcFormat::BC3, BENCH_WIDTH, BENCH_HEIGHT),
+            {},
+            [&]() { blocks = encode_bc(rgba.data(), BENCH_WIDTH, BENCH_HEIGHT, BcFormat::BC3); },
+            blocks_result,
+        },
+    }};
+
+    const auto detected = detected_simd_level();
+    fmt::print(
+        "{}x{} RGBA8, best of {} runs, detected level: {}\n\n",
+        BENCH_WIDTH,
+        BENCH_HEIGHT,
+        BENCH_RUNS,
+        simd_level_name(detected)
+    );
+    fmt::print("{:<30} {:<8} {:>10} {:>10} {:>9}\n", "kernel", "level", "ms", "GB/s", "speedup");
+
+    bool mismatch{};
+    for (const auto& kernel : kernels) {
+        double scalar_ms{};
+        std::vector<u8> expected{};
+        for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+            if (level > detected) {
+                break;
+            }
+            set_simd_level(level);
+            const auto ms = best_run_ms(kernel);
+            const auto output = kernel.result();
+            if (level == SimdLevel::Scalar) {
+                scalar_ms = ms;
+                expected = output;
+            }
+
+            const bool matches = output == expected;
+            mismatch = mismatch || !matches;
+            fmt::print(
+                "{:<30} {:<8} {:>10.3f} {:>10.2f} {:>8.2f}x{}\n",
+                kernel.name,
+                simd_level_name(level),
+                ms,
+                static_cast<double>(kernel.bytes) / (ms * 1.0e6),
+                scalar_ms / ms,
+                matches ? "" : "  MISMATCH"
+            );
+        }
+    }
+    set_simd_level(detected);
+
+    return mismatch ? 1 : 0;
+}
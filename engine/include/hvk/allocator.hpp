@@ -1,5 +1,10 @@
 #pragma once
 
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.hpp>
 
@@ -18,6 +23,71 @@ struct AllocatedImage {
     VmaAllocation allocation{};
 };
 
+// bytes allocated from, and available to this process in, a set of heaps
+struct MemoryBudget {
+    vk::DeviceSize usage{};
+    vk::DeviceSize budget{};
+};
+
+// one memory heap as reported by `vmaGetHeapBudgets`
+struct HeapBudget {
+    // bytes of device memory blocks allocated from the heap, and bytes of
+    // live allocations placed in them
+    vk::DeviceSize reserved{};
+    vk::DeviceSize allocated{};
+    // as in `MemoryBudget`, including memory of other processes
+    vk::DeviceSize usage{};
+    vk::DeviceSize budget{};
+    bool device_local{};
+};
+
+// blocks and allocations of one custom pool
+struct PoolStats {
+    u32 blocks{};
+    u32 allocations{};
+    vk::DeviceSize reserved{};
+    vk::DeviceSize allocated{};
+};
+
+// allocations of similar size and lifetime share a VMA custom pool, so
+// thousands of resources only need a few `vkAllocateMemory` calls
+enum class MemoryCategory : u8 {
+    // sampled images
+    Texture,
+    // color and depth attachments
+    RenderTarget,
+    // vertex and index buffers
+    Geometry,
+    // host written transfer sources
+    Staging,
+    // transfer sources in host cached memory, for decoders that read back
+    // what they wrote
+    CachedStaging,
+    // uniform and storage buffers written by the host
+    Uniform,
+};
+
+inline constexpr usize MEMORY_CATEGORY_COUNT = 6;
+// block size of the pool for each category, allocations larger than half a
+// block are left to VMA's default pools (which may give them dedicated memory)
+inline constexpr std::array<vk::DeviceSize, MEMORY_CATEGORY_COUNT> MEMORY_POOL_BLOCK_SIZES{
+    128ull * 1024 * 1024,
+    64ull * 1024 * 1024,
+    64ull * 1024 * 1024,
+    64ull * 1024 * 1024,
+    64ull * 1024 * 1024,
+    16ull * 1024 * 1024,
+};
+// render targets at least this large get their own memory
+inline constexpr vk::DeviceSize RENDER_TARGET_DEDICATED_SIZE = 16ull * 1024 * 1024;
+// a single defragmentation pass moves at most this much, so the copies only
+// briefly stall the frame they run in
+inline constexpr vk::DeviceSize DEFRAGMENTATION_BYTES_PER_PASS = 16ull * 1024 * 1024;
+inline constexpr u32 DEFRAGMENTATION_MOVES_PER_PASS = 64;
+// frames between defragmentation passes (and between checks whether a pool
+// has become fragmented)
+inline constexpr usize DEFRAGMENTATION_INTERVAL = 8;
+
 template<typename T>
 concept IsAllocation = std::same_as<T, AllocatedBuffer> || std::same_as<T, AllocatedImage>;
 
@@ -49,12 +119,63 @@ public:
         VmaAllocationInfo* allocation_info = nullptr
     );
     AllocatedBuffer create_staging_buffer(vk::DeviceSize size);
+    // persistently mapped and host cached, so it can be written (and read
+    // back) through `mapped` from any thread until it is destroyed. writes
+    // must be made visible with `flush` before the device reads them.
+    AllocatedBuffer create_mapped_staging_buffer(vk::DeviceSize size, void** mapped);
     AllocatedImage create_image(
         const vk::ImageCreateInfo& info,
         VmaAllocationCreateFlags flags = {},
         VmaMemoryUsage mem_usage = VMA_MEMORY_USAGE_AUTO
     );
 
+    // pool category of a buffer or image with the given usage (and for
+    // buffers, allocation flags), buffers that fit no category are left to
+    // VMA's default pools
+    [[nodiscard]]
+    static std::optional<MemoryCategory> buffer_category(
+        vk::BufferUsageFlags usage,
+        VmaAllocationCreateFlags flags = 0
+    );
+    [[nodiscard]]
+    static MemoryCategory image_category(vk::ImageUsageFlags usage);
+
+    // summed over all device local heaps. without VK_EXT_memory_budget VMA
+    // estimates the budget as a fraction of the heap sizes.
+    [[nodiscard]]
+    MemoryBudget device_local_budget() const;
+    // one entry per memory heap of the device
+    [[nodiscard]]
+    std::vector<HeapBudget> heap_budgets() const;
+    [[nodiscard]]
+    PoolStats pool_stats(MemoryCategory category) const;
+    // true if the free space between allocations of a pool adds up to at
+    // least one whole block, which defragmentation could release. the empty
+    // block VMA keeps in reserve is not counted.
+    [[nodiscard]]
+    bool is_fragmented(MemoryCategory category) const;
+
+    // starts incremental defragmentation of the pool of `category`, which is
+    // then advanced one pass at a time. false if one is already running.
+    bool begin_defragmentation(MemoryCategory category);
+    [[nodiscard]]
+    bool is_defragmenting() const noexcept;
+    // the moves of the next pass. the owner of each `srcAllocation` has to
+    // create its resource again, bind it with `bind_image` (or `bind_buffer`)
+    // to `dstTmpAllocation` and copy its contents there, or set `operation`
+    // to ignore the move. once the copies have completed the old resources
+    // are destroyed (without freeing their allocation) and the pass is ended
+    // with `end_defragmentation_pass`, after which `srcAllocation` refers to
+    // the new memory.
+    //
+    // empty when there is nothing left to move, defragmentation is finished
+    // and `end_defragmentation_pass` must not be called.
+    [[nodiscard]]
+    std::span<VmaDefragmentationMove> begin_defragmentation_pass();
+    void end_defragmentation_pass();
+    void bind_buffer(VkBuffer buffer, VmaAllocation allocation);
+    void bind_image(VkImage image, VmaAllocation allocation);
+
     template<Allocation T>
     vk::MemoryPropertyFlags get_memory_property_flags(const T& buf) {
         VkMemoryPropertyFlags flags{};
@@ -64,16 +185,34 @@ public:
     }
 
     template<Allocation T>
-    void copy_mapped(T& buf, void* src, usize size) {
+    void copy_mapped(T& buf, const void* src, usize size, usize offset = 0) {
         void* dst{};
         VK_CHECK(
             vmaMapMemory(_allocator, buf.allocation, &dst),
             "Failed to map memory allocation"
         );
-        memcpy(dst, src, size);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        memcpy(static_cast<u8*>(dst) + offset, src, size);
         vmaUnmapMemory(_allocator, buf.allocation);
     };
 
+    template<Allocation T>
+    void flush(const T& buf, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE) {
+        VK_CHECK(
+            vmaFlushAllocation(_allocator, buf.allocation, offset, size),
+            "Failed to flush memory allocation"
+        );
+    }
+
+    // makes device writes visible to the host before reading mapped memory
+    template<Allocation T>
+    void invalidate(const T& buf, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE) {
+        VK_CHECK(
+            vmaInvalidateAllocation(_allocator, buf.allocation, offset, size),
+            "Failed to invalidate memory allocation"
+        );
+    }
+
     template<Allocation T>
     void destroy(T&) = delete;
 
@@ -88,9 +227,19 @@ public:
     }
 
 private:
+    void create_pools();
+    // the pool of `category` if it lives in `memory_type` and `size` is small
+    // enough to share a block, otherwise null (VMA's default pools)
+    [[nodiscard]]
+    VmaPool select_pool(MemoryCategory category, u32 memory_type, vk::DeviceSize size) const;
+    void end_defragmentation();
     void destroy_inner();
 
     VmaAllocator _allocator{};
+    std::array<VmaPool, MEMORY_CATEGORY_COUNT> _pools{};
+    std::array<u32, MEMORY_CATEGORY_COUNT> _pool_memory_types{};
+    VmaDefragmentationContext _defragmentation{};
+    VmaDefragmentationPassMoveInfo _defragmentation_pass{};
 };
 
 }  // namespace hvk
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "hvk/core.hpp"
+#include "hvk/thread_pool.hpp"
+
+namespace hvk {
+
+enum class BcFormat {
+    // opaque RGB, 8 bytes per 4x4 block
+    BC1,
+    // RGB (BC1) with interpolated alpha (BC4), 16 bytes per block
+    BC3,
+    // two independent channels (BC4 each), e.g. normal maps, 16 bytes per block
+    BC5,
+};
+
+[[nodiscard]]
+usize bc_block_size(BcFormat format);
+
+[[nodiscard]]
+vk::Format bc_vk_format(BcFormat format, bool srgb);
+
+// size of one compressed level, blocks are padded out to 4x4 texels
+[[nodiscard]]
+usize bc_level_size(BcFormat format, u32 width, u32 height);
+
+// compresses an RGBA8 image with a fast bounding-box endpoint fit, the
+// bounds and index fits run on the block kernels in `pixel_kernels.hpp`. rows
+// of blocks are shared with tasks on `pool` when one is given, the calling
+// thread encodes rows as well and never waits for a queued task, so this can
+// be called from a task on `pool`.
+[[nodiscard]]
+std::vector<u8> encode_bc(
+    const u8* rgba,
+    u32 width,
+    u32 height,
+    BcFormat format,
+    ThreadPool* pool = nullptr
+);
+
+}  // namespace hvk
@@ -19,19 +19,24 @@ public:
     ~Buffer();
 
     [[nodiscard]]
-    static usize pad_alignment(usize size) {
-        // https://github.com/SaschaWillems/Vulkan/tree/master/examples/dynamicuniformbuffer
-        const auto properties = VulkanContext::gpu().getProperties();
-        usize min_alignment = properties.limits.minUniformBufferOffsetAlignment;
+    static usize align_up(usize size, usize alignment) {
         usize aligned = size;
-        if (min_alignment > 0) {
-            aligned = (aligned + min_alignment - 1) & ~(min_alignment - 1);
+        if (alignment > 0) {
+            aligned = (aligned + alignment - 1) & ~(alignment - 1);
         }
         return aligned;
     }
 
+    [[nodiscard]]
+    static usize pad_alignment(usize size) {
+        // https://github.com/SaschaWillems/Vulkan/tree/master/examples/dynamicuniformbuffer
+        return align_up(size, VulkanContext::limits().minUniformBufferOffsetAlignment);
+    }
+
     [[nodiscard]]
     bool is_mapped() const;
+    [[nodiscard]]
+    void* mapped_data() const;
 
     template<typename T>
     void update(T* src, usize size = sizeof(T), usize dst_offset = 0) {
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "hvk/core.hpp"
+
+namespace hvk {
+
+// incremental 64-bit xxHash (XXH64). unlike `std::hash` the result is the
+// same across runs and standard libraries, so it can name files on disk.
+class ContentHasher {
+public:
+    explicit ContentHasher(u64 seed = 0) noexcept;
+
+    void update(std::span<const u8> data) noexcept;
+    [[nodiscard]]
+    u64 digest() const noexcept;
+
+private:
+    void consume(const u8* stripe) noexcept;
+
+    std::array<u64, 4> _acc{};
+    std::array<u8, 32> _buffer{};
+    usize _buffered{};
+    u64 _length{};
+    u64 _seed{};
+};
+
+[[nodiscard]]
+u64 content_hash(std::span<const u8> data, u64 seed = 0) noexcept;
+
+// hash of the bytes of a file, read in chunks. nullopt if it cannot be read.
+[[nodiscard]]
+std::optional<u64> hash_file(const std::filesystem::path& path);
+
+// every byte of a file, for callers that hash and decode the same bytes.
+// nullopt if it cannot be read.
+[[nodiscard]]
+std::optional<std::vector<u8>> read_file(const std::filesystem::path& path);
+
+}  // namespace hvk
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <source_location>
 #include <utility>
@@ -60,6 +61,12 @@ constexpr void panic(T&& msg, std::source_location location = std::source_locati
     abort();
 }
 
+// boost-style hash mixing for building keys out of several values
+template<typename T>
+void hash_combine(usize& seed, const T& value) {
+    seed ^= std::hash<T>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
 template<typename T>
 using Shared = std::shared_ptr<T>;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <vector>
 
 #include <vulkan/vulkan.hpp>
 
@@ -8,10 +9,14 @@
 
 namespace hvk {
 
+class DescriptorUpdateTemplate;
+
 struct DescriptorDetails {
     vk::DescriptorType type{};
     vk::ShaderStageFlags stage_flags{};
     u32 count{1};
+    // e.g. partially bound/variable count for descriptor indexing
+    vk::DescriptorBindingFlags binding_flags{};
 };
 
 class DescriptorSetBindingMap {
@@ -30,7 +35,13 @@ public:
 
     [[nodiscard]]
     const DescriptorDetails& at(u32 binding) const;
-    vk::UniqueDescriptorSetLayout build_layout();
+    // appends a binding after the last one, e.g. for optional features
+    void push_back(const DescriptorDetails& item);
+    // returns a layout owned by the context layout cache
+    [[nodiscard]]
+    vk::DescriptorSetLayout build_layout() const;
+    [[nodiscard]]
+    DescriptorUpdateTemplate build_update_template(vk::DescriptorSetLayout layout) const;
 
 private:
     Map _details{};
@@ -45,15 +56,109 @@ public:
         u32 binding,
         vk::DescriptorType type,
         vk::ShaderStageFlags stage_flags,
-        u32 descriptor_count = 1
+        u32 descriptor_count = 1,
+        vk::DescriptorBindingFlags binding_flags = {}
     );
 
-    vk::UniqueDescriptorSetLayout build();
+    [[nodiscard]]
+    vk::DescriptorSetLayout build();
 
 private:
     std::vector<vk::DescriptorSetLayoutBinding> _bindings{};
+    std::vector<vk::DescriptorBindingFlags> _binding_flags{};
+};
+
+struct DescriptorPoolRatio {
+    vk::DescriptorType type{};
+    float ratio{1.0f};
+};
+
+// allocates descriptor sets from a chain of pools, creating a new (larger)
+// pool whenever the current one is exhausted or fragmented.
+//
+// pools are never freed individually, `reset()` returns every set to its
+// pool at once, which makes a separate allocator per frame in flight a
+// cheap way to handle transient sets.
+class DescriptorAllocator {
+public:
+    DescriptorAllocator() = default;
+    DescriptorAllocator(
+        u32 initial_sets,
+        std::vector<DescriptorPoolRatio> ratios,
+        vk::DescriptorPoolCreateFlags flags = {}
+    );
+
+    [[nodiscard]]
+    vk::DescriptorSet allocate(vk::DescriptorSetLayout layout);
+    [[nodiscard]]
+    std::vector<vk::DescriptorSet> allocate(vk::DescriptorSetLayout layout, u32 count);
+    [[nodiscard]]
+    std::vector<vk::DescriptorSet> allocate(const std::vector<vk::DescriptorSetLayout>& layouts);
+    // allocates a set whose last binding has a variable descriptor count
+    [[nodiscard]]
+    vk::DescriptorSet allocate_variable(vk::DescriptorSetLayout layout, u32 descriptor_count);
+
+    void reset();
+
+private:
+    std::vector<vk::DescriptorSet> allocate_impl(
+        const std::vector<vk::DescriptorSetLayout>& layouts,
+        const std::vector<u32>& variable_counts
+    );
+    // new pools hold at least `min_descriptors` of each type, on top of the
+    // ratios, so a batch that does not fit the ratios still succeeds
+    vk::UniqueDescriptorPool next_pool(
+        u32 min_sets,
+        const std::map<vk::DescriptorType, u32>& min_descriptors = {}
+    );
+    vk::UniqueDescriptorPool create_pool(
+        u32 set_count,
+        const std::map<vk::DescriptorType, u32>& min_descriptors
+    ) const;
+
+    u32 _sets_per_pool{};
+    vk::DescriptorPoolCreateFlags _flags{};
+    std::vector<DescriptorPoolRatio> _ratios{};
+    vk::UniqueDescriptorPool _current{};
+    std::vector<vk::UniqueDescriptorPool> _full{};
+    std::vector<vk::UniqueDescriptorPool> _ready{};
+};
+
+// one element of descriptor update template data, large enough to hold the
+// info for any descriptor type
+union DescriptorInfo {
+    vk::DescriptorImageInfo image{};
+    vk::DescriptorBufferInfo buffer;
+    vk::BufferView texel_buffer;
 };
 
+// update template built from a binding map. template data is a flat array of
+// `DescriptorInfo`, the descriptors for each binding start at `offset(binding)`
+class DescriptorUpdateTemplate {
+public:
+    DescriptorUpdateTemplate() = default;
+    DescriptorUpdateTemplate(
+        const DescriptorSetBindingMap& binding_map,
+        vk::DescriptorSetLayout layout
+    );
+
+    // number of `DescriptorInfo` elements expected by `update`
+    [[nodiscard]]
+    usize size() const noexcept;
+    [[nodiscard]]
+    u32 offset(u32 binding) const;
+
+    void update(const vk::DescriptorSet& set, const std::vector<DescriptorInfo>& data) const;
+
+private:
+    vk::UniqueDescriptorUpdateTemplate _template{};
+    std::map<u32, u32> _offsets{};
+    usize _size{};
+};
+
+// accumulates descriptor writes for any number of sets and submits them with
+// a single `vkUpdateDescriptorSets` in `update`. descriptor infos are copied
+// into the writer, and its storage is reused between updates.
 class DescriptorSetWriter {
 public:
     DescriptorSetWriter& add_buffer_write(
@@ -68,31 +173,50 @@ public:
         const DescriptorDetails& details,
         const vk::DescriptorImageInfo& image_info
     );
+    DescriptorSetWriter& add_image_array_write(
+        const vk::DescriptorSet& set,
+        u32 binding,
+        const DescriptorDetails& details,
+        const std::vector<vk::DescriptorImageInfo>& image_infos,
+        u32 first_element = 0
+    );
     DescriptorSetWriter& write_buffers(
         const vk::DescriptorSet& set,
         const DescriptorSetBindingMap& binding_map,
-        vk::DescriptorBufferInfo buffer_infos
+        const vk::DescriptorBufferInfo& buffer_info
     );
     DescriptorSetWriter& write_buffers(
         const vk::DescriptorSet& set,
         const DescriptorSetBindingMap& binding_map,
-        std::vector<vk::DescriptorBufferInfo> buffer_infos
+        const std::vector<vk::DescriptorBufferInfo>& buffer_infos
     );
     DescriptorSetWriter& write_images(
         const vk::DescriptorSet& set,
         const DescriptorSetBindingMap& binding_map,
-        vk::DescriptorImageInfo image_infos
+        const vk::DescriptorImageInfo& image_info
     );
     DescriptorSetWriter& write_images(
         const vk::DescriptorSet& set,
         const DescriptorSetBindingMap& binding_map,
-        std::vector<vk::DescriptorImageInfo> image_infos
+        const std::vector<vk::DescriptorImageInfo>& image_infos
     );
 
+    void reserve(usize write_count);
+    [[nodiscard]]
+    usize size() const noexcept;
+
     void update();
 
 private:
+    struct InfoRef {
+        bool is_image{};
+        usize offset{};
+    };
+
     std::vector<vk::WriteDescriptorSet> _writes{};
+    std::vector<InfoRef> _info_refs{};
+    std::vector<vk::DescriptorImageInfo> _image_infos{};
+    std::vector<vk::DescriptorBufferInfo> _buffer_infos{};
 };
 
 }  // namespace hvk
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <mutex>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -11,10 +13,18 @@
 #include "hvk/core.hpp"
 #include "hvk/depth_buffer.hpp"
 #include "hvk/descriptor_utils.hpp"
+#include "hvk/frame_allocator.hpp"
 #include "hvk/pipeline_builder.hpp"
+#include "hvk/pipeline_registry.hpp"
+#include "hvk/render_queue.hpp"
+#include "hvk/render_snapshot.hpp"
 #include "hvk/scene.hpp"
+#include "hvk/texture_loader.hpp"
+#include "hvk/texture_streamer.hpp"
+#include "hvk/thread_pool.hpp"
 #include "hvk/timer.hpp"
 #include "hvk/ui.hpp"
+#include "hvk/virtual_texture.hpp"
 
 struct GLFWwindow;
 struct GLFWmonitor;
@@ -22,28 +32,57 @@ struct GLFWvidmode;
 
 namespace hvk {
 
-struct PushConstants {
-    glm::mat4 model{};
-    glm::mat4 normal_transform{};
-};
-
 enum class BufferingMode : usize {
     None = 1u,
     Double,
     Triple,
 };
 
+enum class UpdateMode {
+    // update and render run back to back on the main thread
+    Sequential,
+    // update for frame N+1 runs on a simulation thread while frame N renders
+    Pipelined,
+};
+
+// input gathered on the main thread (GLFW input functions may only be called
+// from there) and consumed by the simulation. movement keys reflect the
+// current state, look/zoom deltas accumulate until the next update.
+struct InputState {
+    bool focused{};
+    bool forward{};
+    bool backward{};
+    bool left{};
+    bool right{};
+    bool up{};
+    bool down{};
+    bool sprint{};
+    bool reset_camera{};
+    glm::dvec2 look{};
+    double zoom{};
+    float aspect{};
+};
+
 struct FrameData {
     vk::UniqueSemaphore present_semaphore{};
     vk::UniqueSemaphore render_semaphore{};
     vk::UniqueFence render_fence{};
     vk::UniqueCommandPool cmd_pool{};
     vk::UniqueCommandBuffer cmd{};
-    Buffer camera_ubo{};
+    FrameAllocator uniforms{};
+    Buffer objects{};
+    Buffer draws{};
     vk::DescriptorSet descriptor{};
-    // NOTE: this descriptor set is freed by the owning pool, and since we are
+    // NOTE: descriptor sets are freed by the owning pool, and since we are
     //   not using VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, we don't
     //   need to explicitly destroy them in the cleanup method
+    // textures of this frame (the bindless array, or the set bound before any
+    // material). material sets are kept per frame in the same way, so that
+    // the sets of this frame can be written while other frames use theirs.
+    vk::DescriptorSet texture_set{};
+    // textures that got a new image view since this frame was last recorded,
+    // sets referring to them are written again before it is recorded
+    std::vector<const Texture2D*> stale_textures{};
 };
 
 struct WindowData {
@@ -65,9 +104,11 @@ public:
         std::string_view title,
         i32 width,
         i32 height,
-        BufferingMode buffering = BufferingMode::None
+        BufferingMode buffering = BufferingMode::None,
+        UpdateMode update_mode = UpdateMode::Sequential
     )
         : _max_frames_in_flight(static_cast<usize>(buffering)),
+          _update_mode{update_mode},
           _window{std::string{title}, width, height},
           _frames{_max_frames_in_flight} {}
 
@@ -81,10 +122,11 @@ public:
     void init();
     void run();
     void update(double dt);
-    void render();
+    void render(const RenderSnapshot& snapshot);
     void cleanup();
 
     void cycle_pipeline();
+    void toggle_depth_prepass();
     void toggle_fullscreen();
     void toggle_mouse_capture();
     void on_resize();
@@ -96,6 +138,13 @@ public:
     void on_key_press(i32 keycode, i32 mods);
 
 private:
+    void run_sequential();
+    void run_pipelined();
+    void poll_input();
+    InputState take_input();
+    bool step_simulation(double dt);
+    bool render_next();
+    void write_snapshot(RenderSnapshot& snapshot) const;
     void init_glfw();
     void init_vulkan();
     void create_buffers();
@@ -106,6 +155,15 @@ private:
     void init_descriptors();
     void create_pipelines();
     void create_sync_obj();
+    // writes the texture and material sets of one frame in flight, or only
+    // those referring to `changed` textures
+    void write_texture_descriptors(
+        usize frame_idx,
+        const std::vector<const Texture2D*>* changed = nullptr
+    );
+    // marks sets referring to `textures` to be written again by every frame
+    // before it is recorded, e.g. after the textures got new image views
+    void invalidate_texture_descriptors(const std::vector<const Texture2D*>& textures);
     void recreate_swapchain();
     void destroy_swapchain();
     void update_ui();
@@ -114,30 +172,54 @@ private:
     bool _focused{};
     bool _resized{};
     bool _mouse_captured{};
+    bool _bindless{};
+    bool _virtual_texturing{};
+    // opaque geometry is drawn to depth first, then shaded with `eEqual`
+    bool _depth_prepass{};
+    // whether models have the position-only streams the pre-pass draws with
+    bool _position_streams{};
     usize _frame_count{};
     usize _frame_idx{};
     usize _max_frames_in_flight{2};
+    UpdateMode _update_mode{};
     WindowData _window{};
     UI _ui{};
     Timer _timer{};
     Camera _camera{};
     glm::dvec2 _cursor{};
+    InputState _input{};
+    std::mutex _input_mutex{};
+    DoubleBuffer<RenderSnapshot> _snapshots{};
+    std::thread _sim_thread{};
     Scene _scene{};
-    Buffer _scene_ubo{};
+    // placement of each model, owned by the simulation. models are not
+    // changed once the scene is built, since the render thread reads them
+    // (see `RenderSnapshot`).
+    std::vector<Transform> _transforms{};
+    // only touched by the render thread
+    RenderQueues _render_queues{};
     DescriptorSetBindingMap _frame_bindings{};
     DescriptorSetBindingMap _texture_bindings{};
 
+    ThreadPool _workers{};
+    PipelineRegistry _pipeline_registry{_workers};
     UploadContext _upload_ctx{};
+    // only touched by the render thread once the scene is created
+    TextureStreamer _streamer{_max_frames_in_flight};
+    TextureHandle _uv_test{};
+    Unique<VirtualTextureCache> _virtual_textures{};
     DepthBuffer _depth_buffer{};
     std::vector<FrameData> _frames{};
     vk::UniqueRenderPass _render_pass{};
     std::vector<vk::UniqueFramebuffer> _framebuffers{};
-    vk::UniqueDescriptorPool _desc_pool{};
-    vk::UniqueDescriptorSetLayout _global_desc_set_layout{};
-    vk::UniqueDescriptorSetLayout _texture_set_layout{};
-    vk::DescriptorSet _texture_set{};
+    DescriptorAllocator _descriptors{};
+    vk::DescriptorSetLayout _global_desc_set_layout{};
+    vk::DescriptorSetLayout _texture_set_layout{};
+    DescriptorAllocator _bindless_descriptors{};
+    Buffer _material_buffer{};
     usize _pipeline_idx{};
-    GraphicsPipeline _pipelines{};
+    AsyncGraphicsPipeline _pipelines{};
+    vk::Pipeline _fallback_pipeline{};
 };
 
 }  // namespace hvk
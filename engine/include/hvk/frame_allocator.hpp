@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstring>
+
+#include <vulkan/vulkan.hpp>
+
+#include "hvk/buffer.hpp"
+#include "hvk/core.hpp"
+
+namespace hvk {
+
+struct FrameAllocation {
+    void* data{};
+    u32 offset{};
+};
+
+// linear allocator over a persistently mapped buffer, intended to be owned
+// by a single frame in flight and reset once that frame's fence signals.
+//
+// every allocation is aligned for use as a dynamic offset, so data can be
+// bound through a single `eUniformBufferDynamic` (or storage) descriptor
+// that points at `buffer()` instead of creating buffers or sets per draw.
+class FrameAllocator {
+public:
+    FrameAllocator() = default;
+    FrameAllocator(vk::DeviceSize capacity, vk::BufferUsageFlags usage);
+
+    [[nodiscard]]
+    FrameAllocation allocate(usize size);
+
+    template<typename T>
+    FrameAllocation push(const T& value) {
+        auto allocation = allocate(sizeof(T));
+        std::memcpy(allocation.data, &value, sizeof(T));
+        return allocation;
+    }
+
+    void reset() noexcept;
+
+    [[nodiscard]]
+    vk::Buffer buffer() const;
+    [[nodiscard]]
+    vk::DescriptorBufferInfo descriptor_buffer_info(usize range) const;
+    [[nodiscard]]
+    usize capacity() const noexcept;
+    [[nodiscard]]
+    usize used() const noexcept;
+
+private:
+    Buffer _buffer{};
+    usize _alignment{};
+    usize _head{};
+};
+
+}  // namespace hvk
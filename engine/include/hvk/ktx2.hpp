@@ -0,0 +1,52 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "hvk/core.hpp"
+
+namespace hvk {
+
+struct Ktx2Level {
+    // byte range of the level in `Ktx2Image::data`
+    usize offset{};
+    usize size{};
+};
+
+// a single 2D image (one layer, one face) from a KTX2 container, without
+// supercompression. levels are ordered from the full resolution image down.
+struct Ktx2Image {
+    vk::Format format{};
+    u32 width{};
+    u32 height{};
+    std::vector<Ktx2Level> levels{};
+    std::vector<u8> data{};
+    std::unordered_map<std::string, std::string> metadata{};
+};
+
+// true for the BC formats that can be loaded from (and written to) KTX2
+[[nodiscard]]
+bool is_bc_format(vk::Format format);
+
+// bytes per 4x4 block of a BC format
+[[nodiscard]]
+usize bc_format_block_size(vk::Format format);
+
+// returns an empty optional (and logs why) if the file cannot be read or uses
+// features that are not supported
+[[nodiscard]]
+std::optional<Ktx2Image> read_ktx2(const std::filesystem::path& path);
+// same for the bytes of a file that was already read, which become the data
+// of the image. `name` is only used for logging.
+[[nodiscard]]
+std::optional<Ktx2Image> read_ktx2(std::vector<u8> bytes, const std::string& name);
+
+// returns false if the file could not be written
+bool write_ktx2(const std::filesystem::path& path, const Ktx2Image& image);
+
+}  // namespace hvk
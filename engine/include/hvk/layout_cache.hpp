@@ -0,0 +1,65 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "hvk/core.hpp"
+
+namespace hvk {
+
+struct DescriptorSetLayoutKey {
+    std::vector<vk::DescriptorSetLayoutBinding> bindings{};
+    std::vector<vk::DescriptorBindingFlags> binding_flags{};
+
+    bool operator==(const DescriptorSetLayoutKey& other) const noexcept;
+};
+
+struct PipelineLayoutKey {
+    std::vector<vk::DescriptorSetLayout> set_layouts{};
+    std::vector<vk::PushConstantRange> push_constants{};
+
+    bool operator==(const PipelineLayoutKey& other) const noexcept;
+};
+
+struct LayoutKeyHash {
+    usize operator()(const DescriptorSetLayoutKey& key) const noexcept;
+    usize operator()(const PipelineLayoutKey& key) const noexcept;
+};
+
+// deduplicates descriptor set and pipeline layouts by content. layouts are
+// owned by the cache and live until `clear` (or the cache is destroyed), so
+// callers only ever hold non-owning handles. since set layouts with the same
+// bindings share a handle, pipeline layouts built from them are shared too.
+class LayoutCache {
+public:
+    LayoutCache() = default;
+    LayoutCache(const LayoutCache&) = delete;
+    LayoutCache(LayoutCache&&) = delete;
+    LayoutCache& operator=(const LayoutCache&) = delete;
+    LayoutCache& operator=(LayoutCache&&) = delete;
+    ~LayoutCache() = default;
+
+    [[nodiscard]]
+    vk::DescriptorSetLayout descriptor_set_layout(DescriptorSetLayoutKey key);
+    [[nodiscard]]
+    vk::PipelineLayout pipeline_layout(PipelineLayoutKey key);
+    // bindings of a set layout created by this cache, in binding order
+    [[nodiscard]]
+    DescriptorSetLayoutKey descriptor_set_layout_key(vk::DescriptorSetLayout layout);
+
+    void clear();
+
+private:
+    std::mutex _mutex{};
+    std::unordered_map<DescriptorSetLayoutKey, vk::UniqueDescriptorSetLayout, LayoutKeyHash>
+        _set_layouts{};
+    // points into `_set_layouts`, whose keys stay put when it rehashes
+    std::unordered_map<VkDescriptorSetLayout, const DescriptorSetLayoutKey*> _set_layout_keys{};
+    std::unordered_map<PipelineLayoutKey, vk::UniquePipelineLayout, LayoutKeyHash>
+        _pipeline_layouts{};
+};
+
+}  // namespace hvk
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include <glm/glm.hpp>
 
 #include "hvk/core.hpp"
@@ -7,6 +9,15 @@
 
 namespace hvk {
 
+enum class AlphaMode {
+    // alpha is ignored, the fragment shader never discards (keeps early-z)
+    Opaque,
+    // fragments below the alpha cutoff are discarded
+    Mask,
+    // blended over what is behind it, drawn back-to-front without depth writes
+    Blend,
+};
+
 struct Material {
     float alpha_cutoff{1.0f};
     float metallic_factor{1.0f};
@@ -19,6 +30,7 @@ struct Material {
     Texture2D* occlusion_texture{};
     Texture2D* emissive_texture{};
     bool double_sided{false};
+    AlphaMode alpha_mode{AlphaMode::Opaque};
 
     struct TexCoordSets {
         u8 base_color = 0;
@@ -29,11 +41,24 @@ struct Material {
         u8 emissive = 0;
     } tex_coord_sets{};
 
-    vk::DescriptorSet descriptor_set{};
+    // one set per frame in flight, see `ResourceManager::prepare_materials`
+    std::vector<vk::DescriptorSet> descriptor_sets{};
+    // slot in the material storage buffer when using bindless textures
+    u32 index{};
 
     static Material none() {
         return {.base_color_factor{0.8f, 0.8f, 0.8f, 1.0f}};
     }
 };
 
+// per-material entry in the material storage buffer (std430), textures are
+// referenced by their index in the bindless texture array
+struct MaterialData {
+    glm::vec4 base_color_factor{1.0f};
+    u32 base_color_texture{};
+    // 1 + index into the virtual texture buffer, 0 if not virtual
+    u32 virtual_texture{};
+    u32 padding[2]{};  // NOLINT(*-avoid-c-arrays)
+};
+
 }  // namespace hvk
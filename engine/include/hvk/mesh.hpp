@@ -60,6 +60,41 @@ struct Vertex {
             uv_attr,
         };
     }
+
+    // tightly packed positions in a separate buffer, used by depth-only passes
+    static std::vector<vk::VertexInputBindingDescription> position_binding_desc() {
+        vk::VertexInputBindingDescription desc{
+            0,
+            sizeof(glm::vec3),
+            vk::VertexInputRate::eVertex,
+        };
+        return {desc};
+    }
+
+    static std::vector<vk::VertexInputAttributeDescription> position_attr_desc() {
+        auto pos_attr = vk::VertexInputAttributeDescription{
+            0,
+            0,
+            vk::Format::eR32G32B32Sfloat,
+            0,
+        };
+        return {pos_attr};
+    }
+};
+
+// whether a mesh keeps its vertices and indices in system memory once they
+// have been uploaded
+enum class MeshResidency : u8 {
+    // released after `upload`, only the device buffers remain
+    DeviceOnly,
+    // kept for CPU-side queries such as picking or physics
+    KeepHostCopy,
+};
+
+// bytes held by a mesh (or a set of meshes) in device and system memory
+struct MeshMemory {
+    vk::DeviceSize device{};
+    usize host{};
 };
 
 class Mesh {
@@ -357,11 +392,42 @@ public:
 
     [[nodiscard]]
     glm::mat4 transform() const;
-    void upload(const vk::Queue& queue, UploadContext& ctx);
+    // center of the local space bounding box, valid after `upload`
+    [[nodiscard]]
+    glm::vec3 center() const;
+    // radius of the sphere around `center` enclosing the bounding box
+    [[nodiscard]]
+    float radius() const;
+    // `position_stream` additionally uploads a position-only vertex buffer.
+    // the vertex and index counts used for drawing are recorded here, so the
+    // host copy can be released according to `residency`.
+    void upload(
+        const vk::Queue& queue,
+        UploadContext& ctx,
+        bool position_stream = false,
+        MeshResidency residency = MeshResidency::DeviceOnly
+    );
+    // uploads the position-only vertex buffer of a mesh that was uploaded
+    // without it. vertices are read back from the device if the host copy
+    // has been released, so this waits for the transfer.
+    void upload_positions(const vk::Queue& queue, UploadContext& ctx);
+    [[nodiscard]]
+    bool has_position_stream() const noexcept;
+    // false once the host copy has been released by `upload`
+    [[nodiscard]]
+    bool has_host_copy() const noexcept;
+    [[nodiscard]]
+    const std::vector<Vertex>& vertices() const noexcept;
+    [[nodiscard]]
+    const std::vector<u32>& indices() const noexcept;
+    [[nodiscard]]
+    MeshMemory memory() const noexcept;
     void bind(const vk::UniqueCommandBuffer& cmd) const;
     void bind(const vk::CommandBuffer& cmd) const;
-    void draw(const vk::UniqueCommandBuffer& cmd) const;
-    void draw(const vk::CommandBuffer& cmd) const;
+    // binds the position-only stream (and index buffer) instead of full vertices
+    void bind_positions(const vk::CommandBuffer& cmd) const;
+    void draw(const vk::UniqueCommandBuffer& cmd, u32 first_instance = 0) const;
+    void draw(const vk::CommandBuffer& cmd, u32 first_instance = 0) const;
     void destroy();
 
     friend class Model;
@@ -379,17 +445,35 @@ private:
         const auto size = src.size()
             * sizeof(std::remove_reference<decltype(src)>::type::value_type);
 
-        // stage buffer data for upload
-        auto staging_buf = allocator.create_staging_buffer(size);
-        allocator.copy_mapped(staging_buf, src.data(), size);
-
-        // create gpu-side buffer
-        auto gpu_buf =
-            allocator.create_buffer(size, usage | vk::BufferUsageFlagBits::eTransferDst);
+        // create gpu-side buffer. where device local memory is also host
+        // visible (integrated GPUs, resizable BAR, software renderers) VMA
+        // places it there and maps it, otherwise it falls back to memory
+        // that is only reachable with a transfer
+        VmaAllocationInfo info{};
+        auto gpu_buf = allocator.create_buffer(
+            size,
+            usage | vk::BufferUsageFlagBits::eTransferDst,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+                | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT
+                | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            VMA_MEMORY_USAGE_AUTO,
+            &info
+        );
 
-        // upload to gpu buffer
-        ctx.copy_staged(queue, staging_buf, gpu_buf, size);
-        allocator.destroy(staging_buf);
+        const auto props = allocator.get_memory_property_flags(gpu_buf);
+        if (info.pMappedData && (props & vk::MemoryPropertyFlagBits::eHostVisible)) {
+            // written in place, no staging buffer or copy submission
+            memcpy(info.pMappedData, src.data(), size);
+            allocator.flush(gpu_buf);
+        } else {
+            // stage buffer data for upload
+            auto staging_buf = allocator.create_staging_buffer(size);
+            allocator.copy_mapped(staging_buf, src.data(), size);
+
+            // upload to gpu buffer
+            ctx.copy_staged(queue, staging_buf, gpu_buf, size);
+            allocator.destroy(staging_buf);
+        }
 
         // populate destination buffer
         allocator.destroy(buffer);
@@ -398,9 +482,14 @@ private:
 
     std::vector<Vertex> _vertices{};
     std::vector<u32> _indices{};
+    u32 _vertex_count{};
+    u32 _index_count{};
+    glm::vec3 _center{};
+    float _radius{};
 
     AllocatedBuffer _vertex_buffer{};
     AllocatedBuffer _index_buffer{};
+    AllocatedBuffer _position_buffer{};
 };
 
 }  // namespace hvk
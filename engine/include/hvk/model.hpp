@@ -15,6 +15,10 @@ struct Transform {
     glm::vec3 translation{0.0f};
     glm::vec3 rotation{0.0f};
     glm::vec3 scale{1.0f};
+
+    // scale, then rotation (euler angles), then translation
+    [[nodiscard]]
+    glm::mat4 matrix() const;
 };
 
 struct Node {
@@ -167,7 +171,15 @@ public:
     [[nodiscard]]
     glm::mat4 transform() const;
     [[nodiscard]]
+    const Transform& local_transform() const noexcept;
+    [[nodiscard]]
     const std::vector<Node>& nodes() const;
+    // local space center of the node's mesh bounds
+    [[nodiscard]]
+    glm::vec3 node_center(const Node& node) const;
+    // local space radius of the node's mesh bounds around `node_center`
+    [[nodiscard]]
+    float node_radius(const Node& node) const;
 
     void translate(glm::vec3 translation);
     void set_translation(glm::vec3 position);
@@ -176,10 +188,31 @@ public:
     void scale(float scale);
     void set_scale(float scale);
 
-    void upload(const vk::Queue& queue, UploadContext& ctx);
-    void draw(const vk::UniqueCommandBuffer& cmd) const;
-    void draw(const vk::CommandBuffer& cmd) const;
-    void draw_node(const Node& node, const vk::UniqueCommandBuffer& cmd) const;
+    // see `Mesh::upload`, `residency` applies to every mesh of the model
+    void upload(
+        const vk::Queue& queue,
+        UploadContext& ctx,
+        bool position_stream = false,
+        MeshResidency residency = MeshResidency::DeviceOnly
+    );
+    // see `Mesh::upload_positions`
+    void upload_positions(const vk::Queue& queue, UploadContext& ctx);
+    // summed over the meshes of the model
+    [[nodiscard]]
+    MeshMemory memory() const noexcept;
+    void draw(const vk::UniqueCommandBuffer& cmd, u32 first_instance = 0) const;
+    void draw(const vk::CommandBuffer& cmd, u32 first_instance = 0) const;
+    void draw_node(
+        const Node& node,
+        const vk::UniqueCommandBuffer& cmd,
+        u32 first_instance = 0
+    ) const;
+    // draws the node from its position-only stream, see `Mesh::upload`
+    void draw_node_positions(
+        const Node& node,
+        const vk::UniqueCommandBuffer& cmd,
+        u32 first_instance = 0
+    ) const;
 
 private:
     static std::vector<Material*> load_obj_materials(
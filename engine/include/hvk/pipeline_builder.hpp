@@ -1,5 +1,9 @@
 #pragma once
 
+#include <optional>
+#include <utility>
+#include <vector>
+
 #include <vulkan/vulkan.hpp>
 
 #include "hvk/core.hpp"
@@ -8,13 +12,27 @@
 namespace hvk {
 
 struct GraphicsPipeline {
-    vk::UniquePipelineLayout layout;
+    // owned by the context layout cache
+    vk::PipelineLayout layout;
     std::vector<vk::UniquePipeline> pipelines;
 };
 
+// scalar specialization constant, bools are 32-bit in SPIR-V so `u32` covers
+// every type the shaders use
+struct SpecializationConstant {
+    vk::ShaderStageFlagBits stage{};
+    u32 id{};
+    u32 value{};
+};
+
 struct PipelineConfig {
     std::vector<vk::UniqueShaderModule> shaders{};
     std::vector<vk::ShaderStageFlagBits> stage_flags{};
+    // SPIR-V of each module, which identifies it for `pipeline_config_key`
+    // (handles of destroyed modules can be reused). empty for modules added
+    // without their code.
+    std::vector<std::vector<char>> shader_code{};
+    std::vector<SpecializationConstant> specialization_constants{};
     std::vector<vk::VertexInputBindingDescription> vertex_input_bindings{};
     std::vector<vk::VertexInputAttributeDescription> vertex_input_attrs{};
     vk::PipelineInputAssemblyStateCreateInfo input_assembly_state{
@@ -27,21 +45,42 @@ struct PipelineConfig {
     std::vector<vk::Rect2D> scissors{};
     vk::PipelineMultisampleStateCreateInfo multisample_state{};
     std::vector<vk::PipelineColorBlendAttachmentState> color_blend_attachments{};
+    // logic op and blend constants, the attachments are always taken from
+    // `color_blend_attachments`
+    vk::PipelineColorBlendStateCreateInfo color_blend_state{};
     vk::PipelineRasterizationStateCreateInfo rasterizer_info{};
     vk::PipelineDepthStencilStateCreateInfo depth_stencil{};
     std::vector<vk::DynamicState> dynamic_states{};
 };
 
+[[nodiscard]]
+vk::UniquePipeline create_graphics_pipeline(
+    const PipelineConfig& config,
+    vk::PipelineLayout layout,
+    vk::RenderPass render_pass
+);
+
+// everything that affects the compiled pipeline as bytes, so configs can be
+// compared in full rather than by a hash. nullopt if a shader module was
+// added without its code, since its handle does not identify it.
+[[nodiscard]]
+std::optional<std::vector<u8>> pipeline_config_key(
+    const PipelineConfig& config,
+    vk::PipelineLayout layout,
+    vk::RenderPass render_pass
+);
+
 class PipelineBuilder {
 public:
     PipelineBuilder& new_pipeline();
 
     PipelineBuilder& add_push_constant(const vk::PushConstantRange& range);
-    PipelineBuilder& add_descriptor_set_layout(const vk::UniqueDescriptorSetLayout& layout);
+    PipelineBuilder& add_descriptor_set_layout(vk::DescriptorSetLayout layout);
     PipelineBuilder& add_vertex_shader(vk::UniqueShaderModule shader);
     PipelineBuilder& add_vertex_shader(const Shader& shader);
     PipelineBuilder& add_fragment_shader(vk::UniqueShaderModule shader);
     PipelineBuilder& add_fragment_shader(const Shader& shader);
+    PipelineBuilder& add_specialization_constant(vk::ShaderStageFlagBits stage, u32 id, u32 value);
     PipelineBuilder& add_vertex_binding_description(const vk::VertexInputBindingDescription& desc);
     PipelineBuilder& add_vertex_binding_description(
         const std::vector<vk::VertexInputBindingDescription>& desc
@@ -54,10 +93,15 @@ public:
     );
     PipelineBuilder& with_flipped_viewport(const vk::Extent2D& extent);
     PipelineBuilder& with_viewport(const vk::Extent2D& extent);
+    // viewport and scissor are set with `vkCmdSetViewport`/`vkCmdSetScissor`,
+    // so the pipeline does not depend on the swapchain extent
+    PipelineBuilder& with_dynamic_viewport();
     PipelineBuilder& add_dynamic_state(vk::DynamicState state);
     PipelineBuilder& with_multisample_state(const vk::PipelineMultisampleStateCreateInfo& info);
     PipelineBuilder& with_default_color_blend_opaque();
     PipelineBuilder& with_default_color_blend_transparency();
+    // keeps the color attachment but writes no channels, e.g. depth-only passes
+    PipelineBuilder& with_color_writes_disabled();
     PipelineBuilder& with_front_face(vk::FrontFace front);
     PipelineBuilder& with_cull_mode(vk::CullModeFlagBits mode);
     PipelineBuilder& with_polygon_mode(vk::PolygonMode mode);
@@ -65,12 +109,16 @@ public:
 
     [[nodiscard]]
     GraphicsPipeline build(const vk::RenderPass& render_pass);
+    // hands over the configs and their layout instead of compiling them,
+    // e.g. to compile through a `PipelineRegistry`
+    [[nodiscard]]
+    std::pair<vk::PipelineLayout, std::vector<PipelineConfig>> take();
 
 private:
     [[nodiscard]]
     PipelineConfig& current_config();
     [[nodiscard]]
-    vk::UniquePipelineLayout create_pipeline_layout() const;
+    vk::PipelineLayout create_pipeline_layout() const;
 
     usize _idx{};
     std::vector<PipelineConfig> _config{};
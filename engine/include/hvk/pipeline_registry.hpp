@@ -0,0 +1,104 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "hvk/core.hpp"
+#include "hvk/pipeline_builder.hpp"
+#include "hvk/thread_pool.hpp"
+
+namespace hvk {
+
+// shared reference to a pipeline that may still be compiling. the pipeline
+// itself is owned by the `PipelineRegistry` that created the handle.
+class PipelineHandle {
+public:
+    friend class PipelineRegistry;
+
+    PipelineHandle() = default;
+
+    [[nodiscard]]
+    bool valid() const noexcept;
+    [[nodiscard]]
+    bool ready() const;
+    // hash of the config key, e.g. for logging
+    [[nodiscard]]
+    usize key() const noexcept;
+
+    // blocks until the pipeline has been compiled
+    [[nodiscard]]
+    vk::Pipeline wait() const;
+    // returns `fallback` instead of blocking while the pipeline compiles
+    [[nodiscard]]
+    vk::Pipeline get_or(vk::Pipeline fallback) const;
+
+private:
+    PipelineHandle(usize key, std::shared_future<vk::Pipeline> future);
+
+    usize _key{};
+    std::shared_future<vk::Pipeline> _future{};
+};
+
+struct AsyncGraphicsPipeline {
+    // owned by the context layout cache
+    vk::PipelineLayout layout;
+    std::vector<PipelineHandle> pipelines;
+};
+
+// compiles pipelines on a thread pool and deduplicates them by their full
+// config (shader code, fixed function state, layout and render pass, see
+// `pipeline_config_key`). requesting a config that is already known returns
+// the existing handle, whether or not it has finished compiling. configs with
+// shader modules that were added without their code are never shared.
+class PipelineRegistry {
+public:
+    explicit PipelineRegistry(ThreadPool& pool);
+
+    PipelineRegistry() = delete;
+    PipelineRegistry(const PipelineRegistry&) = delete;
+    PipelineRegistry(PipelineRegistry&&) = delete;
+    PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+    PipelineRegistry& operator=(PipelineRegistry&&) = delete;
+    ~PipelineRegistry();
+
+    [[nodiscard]]
+    PipelineHandle request(
+        PipelineConfig config,
+        vk::PipelineLayout layout,
+        vk::RenderPass render_pass
+    );
+    // requests every pipeline configured in `builder`, consuming its configs
+    [[nodiscard]]
+    AsyncGraphicsPipeline build(PipelineBuilder& builder, vk::RenderPass render_pass);
+
+    // blocks until every requested pipeline has been compiled
+    void wait_idle() const;
+    // destroys all pipelines, they must no longer be in use by the device
+    void clear();
+
+    [[nodiscard]]
+    usize size() const;
+
+private:
+    struct Entry {
+        std::shared_future<vk::Pipeline> future{};
+        vk::UniquePipeline pipeline{};
+    };
+
+    struct KeyHash {
+        usize operator()(const std::vector<u8>& key) const noexcept;
+    };
+
+    ThreadPool* _pool{};
+    mutable std::mutex _mutex{};
+    std::unordered_map<std::vector<u8>, std::shared_ptr<Entry>, KeyHash> _entries{};
+    // pipelines whose config has no key, owned here until `clear`
+    std::vector<std::shared_ptr<Entry>> _unkeyed{};
+};
+
+}  // namespace hvk
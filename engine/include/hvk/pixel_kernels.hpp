@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+
+#include "hvk/core.hpp"
+
+namespace hvk {
+
+// per-texel loops used when importing textures. every kernel dispatches at
+// runtime to the best instruction set the CPU supports, `*_scalar` versions
+// are the reference implementations and produce identical results.
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+// best level supported by this CPU, detected once
+[[nodiscard]]
+SimdLevel detected_simd_level();
+
+// level the dispatching kernels use, the detected level unless lowered with
+// `set_simd_level` (e.g. to compare against the scalar references)
+[[nodiscard]]
+SimdLevel simd_level();
+void set_simd_level(SimdLevel level);
+
+struct AlphaCount {
+    // texels with an alpha other than 255
+    usize non_opaque{};
+    // texels with an alpha in `[partial_min, partial_max]`
+    usize partial{};
+};
+
+[[nodiscard]]
+AlphaCount count_alpha(const u8* rgba, usize texels, u8 partial_min, u8 partial_max);
+[[nodiscard]]
+AlphaCount count_alpha_scalar(const u8* rgba, usize texels, u8 partial_min, u8 partial_max);
+
+// RGB8 to RGBA8 with opaque alpha, `rgb` and `rgba` must not overlap
+void expand_rgb_to_rgba(const u8* rgb, u8* rgba, usize texels);
+void expand_rgb_to_rgba_scalar(const u8* rgb, u8* rgba, usize texels);
+
+// multiplies the color channels by alpha in place, rounded to nearest
+void premultiply_alpha(u8* rgba, usize texels);
+void premultiply_alpha_scalar(u8* rgba, usize texels);
+
+// writes a `max(width / 2, 1) x max(height / 2, 1)` image to `dst` with a
+// 2x2 box filter (odd edges clamp). with `srgb` the color channels are
+// averaged in linear space and encoded through a lookup table.
+void downsample_2x2_rgba8(const u8* src, u32 width, u32 height, bool srgb, u8* dst);
+void downsample_2x2_rgba8_scalar(const u8* src, u32 width, u32 height, bool srgb, u8* dst);
+
+// reorders the channels of every texel in place, channel `c` of the result
+// is channel `order[c]` of the input (e.g. `{2, 1, 0, 3}` swaps RGBA/BGRA)
+void swizzle_rgba8(u8* rgba, usize texels, std::array<u8, 4> order);
+void swizzle_rgba8_scalar(u8* rgba, usize texels, std::array<u8, 4> order);
+
+// block kernels of the BC encoder, `block` is a 4x4 RGBA8 block of 64 bytes.
+// a block fits in SSE2 registers, so AVX2 uses the SSE2 versions.
+
+// per-channel minimum and maximum of the 16 texels
+void bc_block_bounds(const u8* block, std::array<u8, 4>& lo, std::array<u8, 4>& hi);
+void bc_block_bounds_scalar(const u8* block, std::array<u8, 4>& lo, std::array<u8, 4>& hi);
+
+// index of the closest `palette` color (squared RGB distance, the first one
+// on ties) for every texel, texel `i` in bits `2i` and `2i + 1`
+using BcPalette = std::array<std::array<i32, 3>, 4>;
+[[nodiscard]]
+u32 bc1_indices(const u8* block, const BcPalette& palette);
+[[nodiscard]]
+u32 bc1_indices_scalar(const u8* block, const BcPalette& palette);
+
+// index of the closest `palette` value to `channel` (the first one on ties)
+// for every texel, texel `i` in bits `3i` to `3i + 2`
+[[nodiscard]]
+u64 bc4_indices(const u8* block, usize channel, const std::array<u8, 8>& palette);
+[[nodiscard]]
+u64 bc4_indices_scalar(const u8* block, usize channel, const std::array<u8, 8>& palette);
+
+}  // namespace hvk
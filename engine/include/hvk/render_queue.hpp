@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "hvk/core.hpp"
+#include "hvk/render_snapshot.hpp"
+#include "hvk/scene.hpp"
+
+namespace hvk {
+
+enum class SortOrder {
+    FrontToBack,
+    BackToFront,
+};
+
+// queues in the order they are drawn
+enum class RenderQueueType : usize {
+    // sorted front-to-back so early depth testing rejects hidden fragments
+    Opaque,
+    // drawn after opaque geometry, their discard defeats early depth writes
+    AlphaTest,
+    // sorted back-to-front so blending composites in the right order
+    Transparent,
+};
+
+inline constexpr usize RENDER_QUEUE_COUNT = 3;
+// average number of places items may move in the incremental sort before the
+// queue is sorted from scratch instead
+inline constexpr usize RENDER_QUEUE_SHIFT_LIMIT = 8;
+// camera movement within one update (in world units) after which the
+// previous order is not worth keeping
+inline constexpr float RENDER_QUEUE_CUT_DISTANCE = 4.0f;
+
+struct RenderItem {
+    // index of the model in the scene (and its entry in the object buffer)
+    u32 model{};
+    // index of the node within the model
+    u32 node{};
+    // squared distance from the camera
+    float distance{};
+};
+
+class RenderQueue {
+public:
+    explicit RenderQueue(SortOrder order = SortOrder::FrontToBack)
+        : _order{order} {}
+
+    void clear() noexcept;
+    void push(u32 model, u32 node);
+    // sorts items by their current `distance`
+    void sort();
+    // the next `sort` does not start from the previous order
+    void invalidate() noexcept;
+
+    [[nodiscard]]
+    std::vector<RenderItem>& items() noexcept;
+    [[nodiscard]]
+    const std::vector<RenderItem>& items() const noexcept;
+
+private:
+    SortOrder _order{};
+    std::vector<RenderItem> _items{};
+    // items keep their order between frames, once sorted an insertion sort
+    // only has to move the few that changed places
+    bool _sorted{};
+};
+
+// buckets scene nodes by material alpha mode and keeps each bucket sorted by
+// distance to the camera. the buckets are only rebuilt when the scene layout
+// changes, otherwise each update refreshes distances and re-sorts in place.
+class RenderQueues {
+public:
+    void update(const Scene& scene, const RenderSnapshot& snapshot);
+
+    [[nodiscard]]
+    const RenderQueue& queue(RenderQueueType type) const;
+    [[nodiscard]]
+    const std::array<RenderQueue, RENDER_QUEUE_COUNT>& queues() const noexcept;
+
+private:
+    void rebuild(const Scene& scene);
+
+    std::array<RenderQueue, RENDER_QUEUE_COUNT> _queues{
+        RenderQueue{SortOrder::FrontToBack},
+        RenderQueue{SortOrder::FrontToBack},
+        RenderQueue{SortOrder::BackToFront},
+    };
+    usize _model_count{};
+    usize _node_count{};
+    glm::vec3 _eye{};
+};
+
+}  // namespace hvk
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "hvk/camera.hpp"
+#include "hvk/core.hpp"
+#include "hvk/scene.hpp"
+
+namespace hvk {
+
+// everything the renderer needs to draw a frame, produced by the simulation
+// so that recording commands never has to read live simulation state
+struct RenderSnapshot {
+    CameraData camera{};
+    SceneData scene{};
+    std::vector<ObjectData> objects{};
+};
+
+// two-slot handoff between exactly one producer and one consumer thread.
+//
+// the producer fills `back()` and then calls `publish()`, the consumer calls
+// `acquire()` to read the most recently published slot and `release()` when
+// it is done with it. publishing blocks until the consumer has released the
+// previous slot, so the producer never writes into memory being read and is
+// never more than one frame ahead.
+template<typename T>
+class DoubleBuffer {
+public:
+    DoubleBuffer() = default;
+    DoubleBuffer(const DoubleBuffer&) = delete;
+    DoubleBuffer(DoubleBuffer&&) = delete;
+    DoubleBuffer& operator=(const DoubleBuffer&) = delete;
+    DoubleBuffer& operator=(DoubleBuffer&&) = delete;
+    ~DoubleBuffer() = default;
+
+    [[nodiscard]]
+    T& back() noexcept {
+        return _slots[_back];
+    }
+
+    // returns false if the buffer was closed while waiting
+    bool publish() {
+        std::unique_lock lock{_mutex};
+        _cv.wait(lock, [this] { return _closed || (!_ready && !_acquired); });
+        if (_closed) {
+            return false;
+        }
+
+        std::swap(_front, _back);
+        _ready = true;
+        lock.unlock();
+        _cv.notify_all();
+        return true;
+    }
+
+    // returns nullptr if the buffer was closed while waiting
+    [[nodiscard]]
+    const T* acquire() {
+        std::unique_lock lock{_mutex};
+        _cv.wait(lock, [this] { return _closed || _ready; });
+        if (!_ready) {
+            return nullptr;
+        }
+
+        _ready = false;
+        _acquired = true;
+        return &_slots[_front];
+    }
+
+    void release() {
+        {
+            std::lock_guard lock{_mutex};
+            _acquired = false;
+        }
+        _cv.notify_all();
+    }
+
+    // wakes up and fails any pending or future `publish`/`acquire` calls
+    void close() {
+        {
+            std::lock_guard lock{_mutex};
+            _closed = true;
+        }
+        _cv.notify_all();
+    }
+
+private:
+    std::array<T, 2> _slots{};
+    usize _front{1};
+    usize _back{0};
+    bool _ready{};
+    bool _acquired{};
+    bool _closed{};
+    std::mutex _mutex{};
+    std::condition_variable _cv{};
+};
+
+}  // namespace hvk
@@ -1,20 +1,36 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <spdlog/fmt/ostr.h>
 
+#include "hvk/buffer.hpp"
+#include "hvk/content_hash.hpp"
 #include "hvk/core.hpp"
 #include "hvk/descriptor_utils.hpp"
 #include "hvk/material.hpp"
 #include "hvk/shader.hpp"
 #include "hvk/texture.hpp"
+#include "hvk/texture_loader.hpp"
+#include "hvk/texture_streamer.hpp"
+#include "hvk/thread_pool.hpp"
+#include "hvk/virtual_texture.hpp"
 #include "hvk/vk_context.hpp"
 
 namespace hvk {
 
+// textures are uploaded in submissions of about this much staging memory
+inline constexpr usize TEXTURE_BATCH_STAGING_LIMIT = 256 * 1024 * 1024;
+
 struct TextureInfo {
     // NOLINTBEGIN(misc-non-private-member-variables-in-classes)
     std::string name{};
@@ -93,6 +109,107 @@ public:
         return shader(name, ShaderType::Fragment);
     }
 
+    // starts decoding `path` on the texture pool and returns immediately, the
+    // upload happens with the next `upload_pending_textures`. a file with the
+    // same bytes as one loaded before (under any name) with the same
+    // parameters shares its texture, so it is only decoded and uploaded once.
+    // files are hashed by the decode job, so this is only known once the
+    // handle is ready.
+    static TextureHandle load_texture(
+        const TextureInfo& info,
+        const std::filesystem::path& path,
+        vk::Format format = vk::Format::eR8G8B8A8Srgb,
+        vk::ImageLayout layout = vk::ImageLayout::eReadOnlyOptimal,
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled
+    ) {
+        auto& self = get();
+        auto it = self._texture_loads.find(info);
+        if (it != self._texture_loads.end()) {
+            return TextureHandle{it->second};
+        }
+
+        const bool srgb = format == vk::Format::eR8G8B8A8Srgb;
+        const bool rgba8 = srgb || format == vk::Format::eR8G8B8A8Unorm;
+        // large color images are paged in as they are sampled instead of
+        // being compressed or streamed as a whole
+        const bool virtual_texture = srgb && self._virtual_textures
+            && path.extension() != ".ktx2" && reserve_virtual_texture(path);
+        const bool compress = !virtual_texture && self._compress_textures
+            && VulkanContext::supports_bc_compression() && rgba8;
+        // KTX2 files are streamed in whatever format they are stored in
+        const bool streamed = !virtual_texture && self._texture_streamer
+            && (rgba8 || path.extension() == ".ktx2");
+
+        // the texture is filled in place once uploaded, so its address can be
+        // handed out right away
+        auto& texture = self._textures[info];
+        texture = std::make_unique<Texture2D>();
+
+        auto load = std::make_shared<TextureLoad>();
+        load->texture = texture.get();
+        load->format = format;
+        load->layout = layout;
+        load->usage = usage;
+        load->filter = info.filter;
+        load->addr_mode = info.mode;
+        load->streamed = streamed;
+        load->path = path;
+        load->compressed = compress;
+        load->virtual_texture = virtual_texture;
+
+        // the file is read once, hashed and then decoded from the same bytes,
+        // duplicates skip decoding entirely. virtual textures
+        // keep the full mip chain in system memory, streamed textures only
+        // need their mip tail up front.
+        auto chain = MipChain::None;
+        if (virtual_texture) {
+            chain = MipChain::Full;
+        } else if (streamed) {
+            chain = MipChain::Tail;
+        }
+        TextureContent content{
+            .filter = info.filter,
+            .mode = info.mode,
+            .format = format,
+            .layout = layout,
+            .usage = usage,
+        };
+        auto* pool = self._texture_pool;
+        auto* claimant = load.get();
+        auto decode = [path, srgb, compress, chain, content, pool, claimant]() mutable {
+            auto bytes = read_file(path);
+            std::optional<u64> source_hash{};
+            if (bytes) {
+                source_hash = content_hash(*bytes);
+                content.source_hash = *source_hash;
+                content.source_size = bytes->size();
+                if (const auto* original = claim_texture_content(content, claimant)) {
+                    return DecodedTexture{.duplicate_of = original};
+                }
+            }
+            return decode_texture(
+                path,
+                srgb,
+                compress,
+                chain,
+                source_hash,
+                pool,
+                bytes ? std::move(*bytes) : std::vector<u8>{}
+            );
+        };
+        if (pool) {
+            load->decoded = pool->submit(std::move(decode));
+        } else {
+            load->decoded = std::async(std::launch::deferred, std::move(decode));
+        }
+
+        spdlog::trace("Loading texture {}", info);
+        self._pending_textures.push_back(load);
+        self._texture_loads[info] = load;
+        return TextureHandle{std::move(load)};
+    }
+
+    // loads and uploads a texture, blocking until it is ready
     static Texture2D* create_texture(
         const TextureInfo& info,
         const std::filesystem::path& path,
@@ -100,15 +217,182 @@ public:
         vk::ImageLayout layout = vk::ImageLayout::eReadOnlyOptimal,
         vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled
     ) {
-        auto& map = get()._textures;
-        if (map.find(info) != map.end()) {
-            return map[info].get();
+        auto handle = load_texture(info, path, format, layout, usage);
+        upload_pending_textures();
+        return handle.texture();
+    }
+
+    // waits for every texture requested with `load_texture` to finish
+    // decoding and uploads them in batched submissions. textures are decoded
+    // in parallel, so this takes about as long as the slowest decode.
+    static void upload_pending_textures() {
+        auto& self = get();
+        if (self._pending_textures.empty()) {
+            return;
         }
 
-        map[info] = std::make_unique<Texture2D>(
-            Texture2D::from_file(path, format, layout, usage, info.filter, info.mode)
+        const auto start = std::chrono::steady_clock::now();
+        std::optional<ImageUploadBatch> batch{};
+        for (const auto& load : self._pending_textures) {
+            auto decoded = load->decoded.get();
+            if (decoded.duplicate_of) {
+                share_texture(*load, *decoded.duplicate_of);
+                continue;
+            }
+            if (!batch) {
+                batch.emplace();
+            }
+
+            if (load->virtual_texture) {
+                self._virtual_textures->add(*load, std::move(*decoded.ktx), &*batch);
+            } else if (load->streamed) {
+                self._texture_streamer->add(*load, std::move(*decoded.ktx), &*batch);
+            } else if (decoded.ktx) {
+                *load->texture = Texture2D::from_ktx2(
+                    *decoded.ktx,
+                    load->layout,
+                    load->usage,
+                    load->filter,
+                    load->addr_mode,
+                    &*batch
+                );
+            } else {
+                *load->texture = Texture2D::from_staged(
+                    *decoded.staged,
+                    load->format,
+                    load->layout,
+                    load->usage,
+                    load->filter,
+                    load->addr_mode,
+                    &*batch
+                );
+            }
+
+            // bound the staging memory held by a single submission
+            if (batch->staging_size() >= TEXTURE_BATCH_STAGING_LIMIT) {
+                batch.reset();
+            }
+        }
+        batch.reset();
+
+        for (const auto& load : self._pending_textures) {
+            load->ready.store(true, std::memory_order_release);
+        }
+        spdlog::debug(
+            "Uploaded {} textures ({:.1f} ms), {} distinct samplers",
+            self._pending_textures.size(),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                .count(),
+            VulkanContext::sampler_cache().size()
         );
-        return map[info].get();
+        self._pending_textures.clear();
+
+        // alpha properties are only known once the images are decoded
+        for (auto& [_, material] : self._materials) {
+            update_alpha_mode(*material);
+        }
+    }
+
+    // advances incremental defragmentation of the texture pool by one pass
+    // every `DEFRAGMENTATION_INTERVAL` frames, starting it if the pool has
+    // become fragmented. textures are copied to their new memory in `cmd`,
+    // recorded before the render pass of frame number `frame`. the replaced
+    // images (and the memory they were in) are only released once the frames
+    // that may still sample them have completed, so nothing is waited on.
+    // descriptors of the returned textures have to be written again.
+    //
+    // only textures owned here are moved, other resources in the pool (the
+    // virtual texture cache, the UI font) keep their memory.
+    static std::vector<const Texture2D*> defragment_textures(
+        const vk::CommandBuffer& cmd,
+        usize frame,
+        usize frames_in_flight
+    ) {
+        auto& self = get();
+        auto& allocator = VulkanContext::allocator();
+        auto& pass = self._defragmentation_pass;
+        if (pass) {
+            // the last submission that could sample an old image is the one
+            // that recorded the copies
+            if (pass->frame + frames_in_flight > frame) {
+                return {};
+            }
+            for (auto image : pass->old_images) {
+                VulkanContext::device().destroyImage(image);
+            }
+            allocator.end_defragmentation_pass();
+            pass.reset();
+        }
+        if (frame % DEFRAGMENTATION_INTERVAL != 0) {
+            return {};
+        }
+
+        if (!allocator.is_defragmenting()) {
+            if (!allocator.is_fragmented(MemoryCategory::Texture)) {
+                return {};
+            }
+            allocator.begin_defragmentation(MemoryCategory::Texture);
+        }
+        auto moves = allocator.begin_defragmentation_pass();
+        if (moves.empty()) {
+            return {};
+        }
+
+        std::unordered_map<VmaAllocation, Texture2D*> owners{};
+        for (const auto& [_, texture] : self._textures) {
+            if (texture->allocation()) {
+                owners[texture->allocation()] = texture.get();
+            }
+        }
+
+        std::vector<std::pair<VmaDefragmentationMove*, Texture2D*>> relocations{};
+        for (auto& move : moves) {
+            const auto it = owners.find(move.srcAllocation);
+            if (it == owners.end()) {
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            } else {
+                relocations.emplace_back(&move, it->second);
+            }
+        }
+        if (relocations.empty()) {
+            allocator.end_defragmentation_pass();
+            return {};
+        }
+
+        // the pass stays open until the copies are no longer needed, so the
+        // old memory is not handed out while frames in flight sample it
+        pass.emplace(DefragmentationPass{.frame = frame});
+        std::vector<const Texture2D*> relocated{};
+        for (auto [move, texture] : relocations) {
+            pass->old_images.push_back(texture->relocate(move->dstTmpAllocation, cmd));
+            relocated.push_back(texture);
+        }
+
+        spdlog::trace("Relocated {} of {} textures", relocated.size(), moves.size());
+        return relocated;
+    }
+
+    // RGBA8 textures loaded after this are block-compressed (and cached on
+    // disk) when the device supports BC formats
+    static void set_texture_compression(bool enabled) {
+        get()._compress_textures = enabled;
+    }
+
+    // textures are decoded on `pool`, or lazily on the calling thread without one
+    static void set_texture_pool(ThreadPool* pool) {
+        get()._texture_pool = pool;
+    }
+
+    // RGBA8 and KTX2 textures loaded after this start with only their mip
+    // tail resident and have their other levels managed by `streamer`
+    static void set_texture_streamer(TextureStreamer* streamer) {
+        get()._texture_streamer = streamer;
+    }
+
+    // sRGB images loaded after this with power of two sizes of at least
+    // `VT_MIN_TEXTURE_SIZE` are paged through `cache`, until it is full
+    static void set_virtual_textures(VirtualTextureCache* cache) {
+        get()._virtual_textures = cache;
     }
 
     static Texture2D* default_texture() {
@@ -127,11 +411,16 @@ public:
         glm::vec3 ambient_base,
         const std::filesystem::path& ambient_tex
     ) {
-        auto& map = get()._materials;
+        auto& self = get();
+        auto& map = self._materials;
         if (map.find(name) != map.end()) {
             spdlog::trace("Material '{}' already exists", name);
             return map[name].get();
         }
+        if (auto alias = self._material_aliases.find(name);
+            alias != self._material_aliases.end()) {
+            return alias->second;
+        }
 
         spdlog::trace("Creating material '{}'", name);
         Material material{};
@@ -141,35 +430,328 @@ public:
         if (!ambient_tex.empty()) {
             auto ambient = base_dir / ambient_tex;
             TextureInfo tex_info{.name = ambient.stem().string()};
-            material.base_color_texture = ResourceManager::create_texture(tex_info, ambient);
+            material.base_color_texture =
+                ResourceManager::load_texture(tex_info, ambient).texture();
         }
         // if not lazy initialize empty texture and use that
         else {
             material.base_color_texture = ResourceManager::default_texture();
         }
 
+        // textures loaded under the same name share a pointer, so materials
+        // with the same parameters (e.g. from different MTL files) compare
+        // equal here. files with the same content under different names are
+        // only merged once decoded, see `share_texture`.
+        const auto key = material_content_key(material);
+        auto found = self._material_contents.find(key);
+        if (found != self._material_contents.end()
+            && found->second->base_color_factor == material.base_color_factor
+            && found->second->base_color_texture == material.base_color_texture) {
+            spdlog::trace("Material '{}' has the same content as an earlier one", name);
+            self._material_aliases[name] = found->second;
+            return found->second;
+        }
+
+        update_alpha_mode(material);
+
         map[name] = std::make_unique<Material>(material);
+        self._material_contents.try_emplace(key, map[name].get());
         return map[name].get();
     }
 
     static Material* material(const Key& name) {
-        return get()._materials.at(name).get();
+        auto& self = get();
+        auto alias = self._material_aliases.find(name);
+        if (alias != self._material_aliases.end()) {
+            return alias->second;
+        }
+        return self._materials.at(name).get();
     }
 
     static Material* default_material() {
         return ResourceManager::material({});
     }
 
+    // allocates a set per frame in flight for every material and writes its
+    // current texture into all of them
     static void prepare_materials(
-        const vk::UniqueDescriptorPool& pool,
-        const vk::UniqueDescriptorSetLayout& layout,
-        const DescriptorSetBindingMap& binding_map
+        DescriptorAllocator& allocator,
+        vk::DescriptorSetLayout layout,
+        const DescriptorSetBindingMap& binding_map,
+        u32 frames
+    ) {
+        allocate_material_descriptors(allocator, layout, frames);
+        for (u32 frame = 0; frame < frames; frame++) {
+            update_material_descriptors(binding_map, frame);
+        }
+    }
+
+    // each frame in flight has its own sets, so the sets of one frame can be
+    // written while the others are still in use
+    static void allocate_material_descriptors(
+        DescriptorAllocator& allocator,
+        vk::DescriptorSetLayout layout,
+        u32 frames
     ) {
-        allocate_material_descriptors(pool, layout);
-        update_material_descriptors(binding_map);
+        auto& materials = get()._materials;
+        auto sets = allocator.allocate(layout, static_cast<u32>(materials.size()) * frames);
+
+        auto it = sets.begin();
+        for (auto& [_, material] : materials) {
+            material->descriptor_sets.assign(it, it + frames);
+            it += frames;
+        }
+    }
+
+    // writes the current texture of every material into its set of `frame`,
+    // which must not be in use by submitted work. with `changed`, only sets of
+    // materials using one of those textures are written.
+    static void update_material_descriptors(
+        const DescriptorSetBindingMap& binding_map,
+        usize frame,
+        const std::vector<const Texture2D*>* changed = nullptr
+    ) {
+        // all material sets are written with a single descriptor update
+        auto& materials = get()._materials;
+        const auto* fallback = ResourceManager::default_texture();
+        DescriptorSetWriter writer{};
+        writer.reserve(materials.size());
+        for (auto& [_, material] : materials) {
+            const auto* tex = material->base_color_texture;
+            if (!tex) {
+                tex = fallback;
+            }
+            if (changed && std::find(changed->begin(), changed->end(), tex) == changed->end()) {
+                continue;
+            }
+            const auto& set = material->descriptor_sets.at(frame);
+            writer.write_images(set, binding_map, tex->descriptor_info());
+        }
+        writer.update();
+    }
+
+    [[nodiscard]]
+    static u32 texture_count() {
+        // the default texture always occupies the first bindless slot
+        default_texture();
+        return static_cast<u32>(get()._textures.size());
+    }
+
+    [[nodiscard]]
+    static u32 material_count() {
+        return static_cast<u32>(get()._materials.size());
+    }
+
+    // writes the material parameters into `material_buffer`, materials then
+    // only need their `index` to be selected in shaders. textures keep their
+    // slot when they are streamed or relocated, so this is done once.
+    static void prepare_bindless_materials(Buffer& material_buffer) {
+        auto& self = get();
+        HVK_ASSERT(
+            material_buffer.size() >= self._materials.size() * sizeof(MaterialData),
+            "Material buffer is too small to hold all materials"
+        );
+
+        const auto slots = bindless_slots();
+        std::vector<MaterialData> data{};
+        data.reserve(self._materials.size());
+        for (auto& [_, material] : self._materials) {
+            material->index = static_cast<u32>(data.size());
+            const auto* texture = material->base_color_texture;
+            const auto* virtual_textures = self._virtual_textures;
+            data.push_back({
+                .base_color_factor = material->base_color_factor,
+                .base_color_texture = texture ? slots.at(texture) : 0,
+                .virtual_texture =
+                    texture && virtual_textures ? virtual_textures->index_of(texture) : 0,
+            });
+        }
+        material_buffer.update(data.data(), data.size() * sizeof(MaterialData));
+    }
+
+    // writes every texture into a single sampler array (binding 1) and the
+    // material buffer (binding 0), in the slots used by `prepare_bindless_materials`.
+    // with `changed`, only the slots of those textures are written.
+    static void write_bindless_textures(
+        vk::DescriptorSet set,
+        const DescriptorSetBindingMap& binding_map,
+        const Buffer& material_buffer,
+        const std::vector<const Texture2D*>* changed = nullptr
+    ) {
+        if (changed) {
+            const auto slots = bindless_slots();
+            DescriptorSetWriter writer{};
+            writer.reserve(changed->size());
+            for (const auto* texture : *changed) {
+                const auto it = slots.find(texture);
+                if (it == slots.end()) {
+                    continue;
+                }
+                writer.add_image_array_write(
+                    set,
+                    1,
+                    binding_map.at(1),
+                    {texture->descriptor_info()},
+                    it->second
+                );
+            }
+            writer.update();
+            return;
+        }
+
+        std::vector<vk::DescriptorImageInfo> image_infos{};
+        bindless_slots(&image_infos);
+
+        auto buffer_info = material_buffer.descriptor_buffer_info();
+        DescriptorSetWriter writer{};
+        writer.add_buffer_write(set, 0, binding_map.at(0), buffer_info)
+            .add_image_array_write(set, 1, binding_map.at(1), image_infos)
+            .update();
     }
 
 private:
+    // slot of every texture in the bindless sampler array, the default texture
+    // always occupies the first one. `image_infos` receives the descriptor of
+    // each slot if given.
+    static std::unordered_map<const Texture2D*, u32> bindless_slots(
+        std::vector<vk::DescriptorImageInfo>* image_infos = nullptr
+    ) {
+        std::unordered_map<const Texture2D*, u32> slots{};
+        const auto* fallback = default_texture();
+        slots[fallback] = 0;
+        if (image_infos) {
+            image_infos->push_back(fallback->descriptor_info());
+        }
+        for (const auto& [_, texture] : get()._textures) {
+            const auto slot = static_cast<u32>(slots.size());
+            if (slots.try_emplace(texture.get(), slot).second && image_infos) {
+                image_infos->push_back(texture->descriptor_info());
+            }
+        }
+        return slots;
+    }
+
+    // images replaced by the open pass of `defragment_textures`, recorded by
+    // frame number `frame`
+    struct DefragmentationPass {
+        usize frame{};
+        std::vector<VkImage> old_images{};
+    };
+
+    // identifies a texture by its source file and everything that changes how
+    // it ends up on the device. the size is compared along with the hash, so a
+    // hash collision alone does not make two files share a texture.
+    struct TextureContent {
+        u64 source_hash{};
+        u64 source_size{};
+        vk::Filter filter{};
+        vk::SamplerAddressMode mode{};
+        vk::Format format{};
+        vk::ImageLayout layout{};
+        vk::ImageUsageFlags usage{};
+
+        bool operator==(const TextureContent& other) const noexcept = default;
+    };
+
+    struct TextureContentHash {
+        usize operator()(const TextureContent& content) const noexcept {
+            usize seed{};
+            hash_combine(seed, content.source_hash);
+            hash_combine(seed, content.source_size);
+            hash_combine(seed, content.filter);
+            hash_combine(seed, content.mode);
+            hash_combine(seed, content.format);
+            hash_combine(seed, content.layout);
+            hash_combine(seed, static_cast<vk::ImageUsageFlags::MaskType>(content.usage));
+            return seed;
+        }
+    };
+
+    // called from decode jobs: registers `load` as the first texture with
+    // `content`, or returns the load that already is
+    static const TextureLoad* claim_texture_content(
+        const TextureContent& content,
+        const TextureLoad* load
+    ) {
+        auto& self = get();
+        std::lock_guard lock{self._texture_contents_mutex};
+        auto [it, inserted] = self._texture_contents.try_emplace(content, load);
+        return inserted ? nullptr : it->second;
+    }
+
+    // points `load` at the texture of `original`, which has the same content.
+    // materials created before this was known are moved over as well, and the
+    // texture created for `load` (which was never uploaded) is dropped.
+    static void share_texture(TextureLoad& load, const TextureLoad& original) {
+        auto& self = get();
+        auto* duplicate = load.texture;
+        load.texture = original.texture;
+        if (load.virtual_texture) {
+            self._virtual_textures->release();
+        }
+
+        for (auto& [_, material] : self._materials) {
+            for (auto* slot : {
+                     &material->base_color_texture,
+                     &material->metallic_roughness_texture,
+                     &material->normal_texture,
+                     &material->occlusion_texture,
+                     &material->emissive_texture,
+                 }) {
+                if (*slot == duplicate) {
+                    *slot = original.texture;
+                }
+            }
+        }
+        for (auto it = self._textures.begin(); it != self._textures.end(); it++) {
+            if (it->second.get() == duplicate) {
+                spdlog::trace("Texture {} has the same content as an earlier one", it->first);
+                self._textures.erase(it);
+                break;
+            }
+        }
+    }
+
+    // only the parameters `make_material` sets are compared
+    static usize material_content_key(const Material& material) {
+        usize seed{};
+        for (glm::length_t i = 0; i < 4; i++) {
+            hash_combine(seed, material.base_color_factor[i]);
+        }
+        hash_combine(seed, material.base_color_texture);
+        return seed;
+    }
+
+    // reads only the image header, so this is cheap enough for the caller
+    static bool reserve_virtual_texture(const std::filesystem::path& path) {
+        i32 width{};
+        i32 height{};
+        i32 channels{};
+        if (!stbi_info(path.string().c_str(), &width, &height, &channels)) {
+            return false;
+        }
+        return get()._virtual_textures->reserve(
+            static_cast<u32>(width),
+            static_cast<u32>(height)
+        );
+    }
+
+    // select the alpha-tested/blended pipeline variants only where needed
+    static void update_alpha_mode(Material& material) {
+        const auto* texture = material.base_color_texture;
+        if (!texture) {
+            return;
+        }
+
+        if (texture->is_translucent()) {
+            material.alpha_mode = AlphaMode::Blend;
+        } else if (texture->has_alpha()) {
+            material.alpha_mode = AlphaMode::Mask;
+        } else {
+            material.alpha_mode = AlphaMode::Opaque;
+        }
+    }
+
     static Key key_from_filename(const std::filesystem::path& path) {
         // attempt to remove all extensions
         auto key = path;
@@ -187,29 +769,6 @@ private:
         return key.string();
     }
 
-    static void allocate_material_descriptors(
-        const vk::UniqueDescriptorPool& pool,
-        const vk::UniqueDescriptorSetLayout& layout
-    ) {
-        for (auto& [_, material] : get()._materials) {
-            material->descriptor_set = VulkanContext::allocate_descriptor_set(pool, layout);
-        }
-    }
-
-    static void update_material_descriptors(const DescriptorSetBindingMap& binding_map) {
-        DescriptorSetWriter writer{};
-        for (auto& [_, material] : get()._materials) {
-            std::vector<vk::DescriptorImageInfo> info{};
-            if (material->base_color_texture) {
-                info.push_back(material->base_color_texture->descriptor_info());
-            } else {
-                const auto* tex = ResourceManager::default_texture();
-                info.push_back(tex->descriptor_info());
-            }
-            writer.write_images(material->descriptor_set, binding_map, info);
-        }
-    }
-
     Map<Key, Unique<Shader>>& get_shader_map(ShaderType type);
 
     Map<Key, Unique<Shader>> _vert_shaders{};
@@ -217,7 +776,22 @@ private:
     Map<Key, Unique<Shader>> _geom_shaders{};
     Map<Key, Unique<Shader>> _comp_shaders{};
     Map<TextureInfo, Unique<Texture2D>> _textures{};
+    Map<TextureInfo, std::shared_ptr<TextureLoad>> _texture_loads{};
+    // first load of each distinct texture, filled in by the decode jobs. loads
+    // are owned by `_texture_loads`.
+    std::unordered_map<TextureContent, const TextureLoad*, TextureContentHash>
+        _texture_contents{};
+    std::mutex _texture_contents_mutex{};
+    std::vector<std::shared_ptr<TextureLoad>> _pending_textures{};
     Map<Key, Unique<Material>> _materials{};
+    // names that resolved to an existing material with the same content
+    Map<Key, Material*> _material_aliases{};
+    Map<usize, Material*> _material_contents{};
+    bool _compress_textures{};
+    ThreadPool* _texture_pool{};
+    TextureStreamer* _texture_streamer{};
+    VirtualTextureCache* _virtual_textures{};
+    std::optional<DefragmentationPass> _defragmentation_pass{};
 };
 
 }  // namespace hvk
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+#include <vulkan/vulkan.hpp>
+
+#include "hvk/core.hpp"
+
+namespace hvk {
+
+struct SamplerKeyHash {
+    usize operator()(const vk::SamplerCreateInfo& info) const noexcept;
+};
+
+// deduplicates samplers by their full create info. nearly every texture uses
+// the same few filter/address mode combinations, so thousands of textures
+// share a handful of samplers (drivers limit how many may exist). samplers
+// are owned by the cache and live until `clear` (or the cache is destroyed).
+class SamplerCache {
+public:
+    SamplerCache() = default;
+    SamplerCache(const SamplerCache&) = delete;
+    SamplerCache(SamplerCache&&) = delete;
+    SamplerCache& operator=(const SamplerCache&) = delete;
+    SamplerCache& operator=(SamplerCache&&) = delete;
+    ~SamplerCache() = default;
+
+    [[nodiscard]]
+    vk::Sampler sampler(const vk::SamplerCreateInfo& info);
+    // number of distinct samplers created
+    [[nodiscard]]
+    usize size();
+
+    void clear();
+
+private:
+    std::mutex _mutex{};
+    std::unordered_map<vk::SamplerCreateInfo, vk::UniqueSampler, SamplerKeyHash> _samplers{};
+};
+
+}  // namespace hvk
@@ -12,6 +12,23 @@ struct SceneData {
     glm::vec4 light_dir;
 };
 
+// per-object entry in the object storage buffer. only the top three rows of
+// the (affine) model matrix are stored, matching a std430 `mat3x4` in the
+// shaders; the normal matrix is derived on the GPU.
+struct ObjectData {
+    glm::mat3x4 transform{};
+
+    static ObjectData from_matrix(const glm::mat4& matrix) {
+        return {glm::mat3x4{glm::transpose(matrix)}};
+    }
+};
+
+// per-draw entry in the draw storage buffer, selected with `firstInstance`
+struct DrawData {
+    u32 object{};
+    u32 material{};
+};
+
 class Scene {
 public:
     template<typename T>
@@ -35,6 +35,12 @@ public:
     [[nodiscard]]
     vk::UniqueShaderModule module() const;
 
+    // SPIR-V code, identifies the shader independent of modules
+    [[nodiscard]]
+    const std::vector<char>& code() const noexcept {
+        return _buf;
+    }
+
 private:
     std::vector<char> _buf{};
 };
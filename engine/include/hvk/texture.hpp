@@ -1,15 +1,118 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <stb_image.h>
 #include <vulkan/vulkan.hpp>
 
 #include "hvk/core.hpp"
+#include "hvk/ktx2.hpp"
 #include "hvk/vk_context.hpp"
 
 namespace hvk {
 
+// alpha range counted as partial coverage when classifying images
+inline constexpr u8 TRANSLUCENT_ALPHA_MIN = 8;
+inline constexpr u8 TRANSLUCENT_ALPHA_MAX = 247;
+// an image is translucent if more than 1/N of its texels have partial alpha
+inline constexpr usize TRANSLUCENT_TEXEL_RATIO = 16;
+
+struct AlphaInfo {
+    // any texel has an alpha value other than 255
+    bool has_alpha{};
+    // enough texels have partial alpha that the image needs blending
+    bool translucent{};
+};
+
+[[nodiscard]]
+AlphaInfo analyze_alpha(const u8* rgba, usize size);
+
+// number of levels in a full mip chain down to 1x1
+[[nodiscard]]
+inline u32 mip_level_count(u32 width, u32 height) {
+    return static_cast<u32>(std::bit_width(std::max(width, height)));
+}
+
+// halves an RGBA8 image with a 2x2 box filter (odd edges clamp). when `srgb`
+// is set the color channels are averaged in linear space.
+[[nodiscard]]
+std::vector<u8> downsample_rgba8(const u8* src, u32 width, u32 height, bool srgb);
+
+// pixel data of one mip level, level `i` is `(width >> i) x (height >> i)`
+struct ImageLevel {
+    const void* data{};
+    usize size{};
+};
+
+// metadata key written by the texture cache, one of "opaque", "mask" or
+// "blend" so that alpha properties survive compression
+inline constexpr std::string_view KTX2_ALPHA_KEY = "hvk.alpha";
+
+[[nodiscard]]
+inline std::string ktx2_alpha_value(AlphaInfo alpha) {
+    if (alpha.translucent) {
+        return "blend";
+    }
+    return alpha.has_alpha ? "mask" : "opaque";
+}
+
+// RGBA8 image decoded straight into persistently mapped staging memory. the
+// buffer is owned by whoever holds this until it is passed to an upload.
+struct StagedImage {
+    AllocatedBuffer buffer{};
+    u8* data{};
+    u32 width{};
+    u32 height{};
+    AlphaInfo alpha{};
+};
+
+// reads the dimensions of an image file, reserves staging memory for it and
+// decodes into that memory, scanning alpha while the texels are still in
+// cache. nullopt if the file cannot be decoded. safe to call from any thread.
+[[nodiscard]]
+std::optional<StagedImage> stage_image_file(const std::filesystem::path& path);
+// same for the bytes of an image file that was already read
+[[nodiscard]]
+std::optional<StagedImage> stage_image(std::span<const u8> bytes);
+
+// records the uploads of several images into one command buffer, so that a
+// whole set of textures is submitted and waited on once. staging buffers are
+// kept alive until the batch is submitted.
+class ImageUploadBatch {
+public:
+    ImageUploadBatch();
+    ImageUploadBatch(const ImageUploadBatch&) = delete;
+    ImageUploadBatch(ImageUploadBatch&&) = delete;
+    ImageUploadBatch& operator=(const ImageUploadBatch&) = delete;
+    ImageUploadBatch& operator=(ImageUploadBatch&&) = delete;
+    ~ImageUploadBatch();
+
+    [[nodiscard]]
+    const vk::CommandBuffer& cmd() const;
+    void add_staging(AllocatedBuffer buffer);
+    // total size of the staging buffers held until submission
+    [[nodiscard]]
+    usize staging_size() const noexcept;
+    // mip blits must be submitted to a graphics queue
+    void require_graphics_queue() noexcept;
+
+    // submits all recorded uploads and blocks until they are complete
+    void submit();
+
+private:
+    vk::UniqueCommandBuffer _cmd{};
+    std::vector<AllocatedBuffer> _staging{};
+    usize _staging_size{};
+    bool _graphics{};
+};
+
 class ImageResource {
 public:
     friend class Texture;
@@ -27,6 +130,7 @@ public:
         ImageResource resource{};
         std::array<u8, 4> pixel = {r, g, b, a};
         resource._has_alpha = a != 255;
+        resource._is_translucent = a != 0 && a != 255;
 
         resource.upload(pixel.data(), pixel.size(), 1, 1);
         return resource;
@@ -36,43 +140,27 @@ public:
         const std::filesystem::path& path,
         vk::Format format = vk::Format::eR8G8B8A8Srgb,
         vk::ImageLayout layout = vk::ImageLayout::eReadOnlyOptimal,
-        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled,
+        bool mipmaps = true
     ) {
         spdlog::trace("Loading image: '{}'", path.string());
-        ImageResource resource{};
 
-        i32 width{};
-        i32 height{};
-        i32 channels{};
-
-        auto* pixels =
-            stbi_load(path.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
-        HVK_ASSERT(pixels, fmt::format("Failed to load image '{}'", path.string()));
-        HVK_ASSERT(
-            width && height && channels,
-            fmt::format(
-                "STB returned invalid image dimensions: width={}, height={}, channels={}",
-                width,
-                height,
-                channels
-            )
-        );
-        usize size = static_cast<usize>(width) * static_cast<usize>(height) * 4;
-
-        // check if image has varying alpha
-        for (usize i = 3; i < size; i += 4) {
-            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-            if (pixels[i] != 255) {
-                resource._has_alpha = true;
-                break;
-            }
-        }
-
-        resource.upload(pixels, size, width, height, format, layout, usage);
-        stbi_image_free(pixels);
-        return resource;
+        auto staged = stage_image_file(path);
+        HVK_ASSERT(staged, fmt::format("Failed to load image '{}'", path.string()));
+        return from_staged(*staged, format, layout, usage, mipmaps);
     }
 
+    // copies the base level from `staged`, taking ownership of its buffer.
+    // recorded into `batch` if given, otherwise submitted immediately.
+    static ImageResource from_staged(
+        StagedImage& staged,
+        vk::Format format = vk::Format::eR8G8B8A8Srgb,
+        vk::ImageLayout layout = vk::ImageLayout::eReadOnlyOptimal,
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled,
+        bool mipmaps = true,
+        ImageUploadBatch* batch = nullptr
+    );
+
     static ImageResource from_buffer(
         void* data,
         usize size,
@@ -88,26 +176,114 @@ public:
         return resource;
     }
 
+    // uploads the levels of a block-compressed image as stored, starting at
+    // `first_level` (which becomes the base level of the image)
+    static ImageResource from_ktx2(
+        const Ktx2Image& ktx,
+        vk::ImageLayout layout = vk::ImageLayout::eReadOnlyOptimal,
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled,
+        ImageUploadBatch* batch = nullptr,
+        u32 first_level = 0
+    );
+
+    // creates the image again with the levels of `ktx` from `first_level`,
+    // recording into `cmd` the upload of the levels sharper than those in
+    // `resident` (which holds the levels from `resident_level`) and a copy of
+    // the rest from it. `staging` receives the uploaded levels, it and
+    // `resident` must be kept until `cmd` has completed.
+    static ImageResource from_resident_levels(
+        const Ktx2Image& ktx,
+        u32 first_level,
+        const ImageResource& resident,
+        u32 resident_level,
+        const vk::CommandBuffer& cmd,
+        AllocatedBuffer& staging
+    );
+
     [[nodiscard]]
     vk::UniqueImageView create_image_view(
         vk::Format format = vk::Format::eR8G8B8A8Srgb,
         vk::ImageAspectFlags aspect_mask = vk::ImageAspectFlagBits::eColor
     ) const;
 
+    // true if any texel has an alpha value other than 255
+    [[nodiscard]]
+    bool has_alpha() const noexcept {
+        return _has_alpha;
+    }
+    // true if the image needs blending rather than an alpha test
+    [[nodiscard]]
+    bool is_translucent() const noexcept {
+        return _is_translucent;
+    }
+    [[nodiscard]]
+    u32 mip_levels() const noexcept {
+        return _mip_levels;
+    }
+    [[nodiscard]]
+    vk::Format format() const noexcept {
+        return _info.format;
+    }
+    [[nodiscard]]
+    VmaAllocation allocation() const noexcept {
+        return _image.allocation;
+    }
+
+    // creates the image again in `allocation`, the destination of a
+    // defragmentation move, and records copying every level into it. returns
+    // the old image, which must be destroyed once `cmd` has completed.
+    [[nodiscard]]
+    VkImage relocate(VmaAllocation allocation, const vk::CommandBuffer& cmd);
+
 private:
+    // with `mipmaps` the full chain is generated with linear blits if the
+    // format supports it, otherwise it is filtered on the CPU and uploaded.
+    // without a `batch` the upload is submitted and waited on immediately.
     void upload(
-        void* data,
+        const void* data,
         usize size,
         u32 width,
         u32 height,
         vk::Format format = vk::Format::eR8G8B8A8Srgb,
         vk::ImageLayout layout = vk::ImageLayout::eReadOnlyOptimal,
-        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled,
+        bool mipmaps = false,
+        ImageUploadBatch* batch = nullptr
+    );
+    // uploads the given levels, if only the base level is given and `levels`
+    // is larger the rest of the chain is generated with blits
+    void upload_levels(
+        std::span<const ImageLevel> level_data,
+        u32 levels,
+        u32 width,
+        u32 height,
+        vk::Format format,
+        vk::ImageLayout layout,
+        vk::ImageUsageFlags usage,
+        ImageUploadBatch* batch = nullptr
+    );
+    // creates the image and records copying `regions` of `staging` into it,
+    // the batch takes ownership of `staging`
+    void record_upload(
+        AllocatedBuffer staging,
+        std::span<const vk::BufferImageCopy> regions,
+        u32 levels,
+        u32 width,
+        u32 height,
+        vk::Format format,
+        vk::ImageLayout layout,
+        vk::ImageUsageFlags usage,
+        ImageUploadBatch* batch
     );
     void destroy();
 
     AllocatedImage _image{};
+    // kept to create the image again when it is relocated
+    vk::ImageCreateInfo _info{};
+    vk::ImageLayout _layout{};
+    u32 _mip_levels{1};
     bool _has_alpha{false};
+    bool _is_translucent{false};
 };
 
 class TextureBase {
@@ -127,8 +303,31 @@ public:
     const vk::Sampler& sampler() const;
     [[nodiscard]]
     const vk::ImageView& image_view() const;
+    [[nodiscard]]
+    bool has_alpha() const noexcept {
+        return _resource.has_alpha();
+    }
+    [[nodiscard]]
+    bool is_translucent() const noexcept {
+        return _resource.is_translucent();
+    }
+    [[nodiscard]]
+    VmaAllocation allocation() const noexcept {
+        return _resource.allocation();
+    }
+
+    // see `ImageResource::relocate`. the image view is created again, so
+    // descriptors referring to the texture have to be written again.
+    [[nodiscard]]
+    VkImage relocate(VmaAllocation allocation, const vk::CommandBuffer& cmd);
 
 protected:
+    // shared through the context sampler cache. the LOD range is left
+    // unclamped (the image view limits it), so textures with different mip
+    // counts still share a sampler.
+    [[nodiscard]]
+    static vk::Sampler cached_sampler(vk::Filter filter, vk::SamplerAddressMode addr_mode);
+
     // NOLINTBEGIN(cppcoreguidelines-non-private-member-variables-in-classes,misc-non-private-member-variables-in-classes)
     ImageResource _resource{};
     u32 _width{};
@@ -136,7 +335,8 @@ protected:
     u32 _mip_levels{};
     u32 _layers{};
     vk::UniqueImageView _view{};
-    vk::UniqueSampler _sampler{};
+    // owned by the sampler cache
+    vk::Sampler _sampler{};
     // NOLINTEND(cppcoreguidelines-non-private-member-variables-in-classes,misc-non-private-member-variables-in-classes)
 };
 
@@ -146,16 +346,10 @@ public:
         Texture2D tex{};
         tex._width = 1;
         tex._height = 1;
+        tex._mip_levels = 1;
         tex._resource = ImageResource::empty(r, g, b, a);
         tex._view = tex._resource.create_image_view();
-
-        vk::SamplerCreateInfo info{};
-        info.setMagFilter(vk::Filter::eNearest)
-            .setMinFilter(vk::Filter::eNearest)
-            .setAddressModeU(vk::SamplerAddressMode::eRepeat)
-            .setAddressModeV(vk::SamplerAddressMode::eRepeat)
-            .setAddressModeW(vk::SamplerAddressMode::eRepeat);
-        tex._sampler = VulkanContext::device().createSamplerUnique(info);
+        tex._sampler = cached_sampler(vk::Filter::eNearest, vk::SamplerAddressMode::eRepeat);
 
         return tex;
     }
@@ -178,14 +372,8 @@ public:
             ImageResource::from_buffer(data, size, width, height, format, layout, usage);
         tex._view = tex._resource.create_image_view(format);
 
-        // TODO(bwpge): allow configuring each of these individually
-        vk::SamplerCreateInfo info{};
-        info.setMagFilter(filter)
-            .setMinFilter(filter)
-            .setAddressModeU(addr_mode)
-            .setAddressModeV(addr_mode)
-            .setAddressModeW(addr_mode);
-        tex._sampler = VulkanContext::device().createSamplerUnique(info);
+        tex._mip_levels = tex._resource.mip_levels();
+        tex._sampler = cached_sampler(filter, addr_mode);
 
         return tex;
     }
@@ -196,29 +384,90 @@ public:
         vk::ImageLayout layout = vk::ImageLayout::eReadOnlyOptimal,
         vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled,
         vk::Filter filter = vk::Filter::eLinear,
-        vk::SamplerAddressMode addr_mode = vk::SamplerAddressMode::eRepeat
+        vk::SamplerAddressMode addr_mode = vk::SamplerAddressMode::eRepeat,
+        bool mipmaps = true
     ) {
         Texture2D tex{};
 
-        i32 w{};
-        i32 h{};
-        i32 n{};
-        HVK_ASSERT(stbi_info(path.string().c_str(), &w, &h, &n) == 1, "STB failed to open image");
-        HVK_ASSERT(w && h && n, "Failed to read image dimensions");
-        tex._width = static_cast<u32>(w);
-        tex._height = static_cast<u32>(h);
+        auto staged = stage_image_file(path);
+        HVK_ASSERT(staged, fmt::format("Failed to load image '{}'", path.string()));
+        tex._width = staged->width;
+        tex._height = staged->height;
 
-        tex._resource = ImageResource::from_file(path, format, layout, usage);
+        tex._resource = ImageResource::from_staged(*staged, format, layout, usage, mipmaps);
         tex._view = tex._resource.create_image_view(format);
 
-        // TODO(bwpge): allow configuring each of these individually
-        vk::SamplerCreateInfo info{};
-        info.setMagFilter(filter)
-            .setMinFilter(filter)
-            .setAddressModeU(addr_mode)
-            .setAddressModeV(addr_mode)
-            .setAddressModeW(addr_mode);
-        tex._sampler = VulkanContext::device().createSamplerUnique(info);
+        tex._mip_levels = tex._resource.mip_levels();
+        tex._sampler = cached_sampler(filter, addr_mode);
+
+        return tex;
+    }
+
+    static Texture2D from_staged(
+        StagedImage& staged,
+        vk::Format format = vk::Format::eR8G8B8A8Srgb,
+        vk::ImageLayout layout = vk::ImageLayout::eReadOnlyOptimal,
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled,
+        vk::Filter filter = vk::Filter::eLinear,
+        vk::SamplerAddressMode addr_mode = vk::SamplerAddressMode::eRepeat,
+        ImageUploadBatch* batch = nullptr
+    ) {
+        Texture2D tex{};
+        tex._width = staged.width;
+        tex._height = staged.height;
+        tex._resource = ImageResource::from_staged(staged, format, layout, usage, true, batch);
+        tex._view = tex._resource.create_image_view(format);
+
+        tex._mip_levels = tex._resource.mip_levels();
+        tex._sampler = cached_sampler(filter, addr_mode);
+
+        return tex;
+    }
+
+    static Texture2D from_ktx2(
+        const Ktx2Image& ktx,
+        vk::ImageLayout layout = vk::ImageLayout::eReadOnlyOptimal,
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled,
+        vk::Filter filter = vk::Filter::eLinear,
+        vk::SamplerAddressMode addr_mode = vk::SamplerAddressMode::eRepeat,
+        ImageUploadBatch* batch = nullptr,
+        u32 first_level = 0
+    ) {
+        Texture2D tex{};
+        tex._width = std::max(ktx.width >> first_level, 1u);
+        tex._height = std::max(ktx.height >> first_level, 1u);
+        tex._resource = ImageResource::from_ktx2(ktx, layout, usage, batch, first_level);
+        tex._view = tex._resource.create_image_view(ktx.format);
+        tex._mip_levels = tex._resource.mip_levels();
+        tex._sampler = cached_sampler(filter, addr_mode);
+
+        return tex;
+    }
+
+    // see `ImageResource::from_resident_levels`, the texture keeps the
+    // sampler of `resident` and gets a new image view
+    static Texture2D from_resident_levels(
+        const Ktx2Image& ktx,
+        u32 first_level,
+        const Texture2D& resident,
+        u32 resident_level,
+        const vk::CommandBuffer& cmd,
+        AllocatedBuffer& staging
+    ) {
+        Texture2D tex{};
+        tex._width = std::max(ktx.width >> first_level, 1u);
+        tex._height = std::max(ktx.height >> first_level, 1u);
+        tex._resource = ImageResource::from_resident_levels(
+            ktx,
+            first_level,
+            resident._resource,
+            resident_level,
+            cmd,
+            staging
+        );
+        tex._view = tex._resource.create_image_view(ktx.format);
+        tex._mip_levels = tex._resource.mip_levels();
+        tex._sampler = resident._sampler;
 
         return tex;
     }
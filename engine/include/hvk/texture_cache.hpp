@@ -0,0 +1,33 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "hvk/core.hpp"
+#include "hvk/ktx2.hpp"
+#include "hvk/thread_pool.hpp"
+
+namespace hvk {
+
+// relative to the working directory, like shaders and assets
+inline constexpr std::string_view TEXTURE_CACHE_DIR = "texture_cache";
+
+// loads an RGBA8 image file as a BC1 (opaque) or BC3 (alpha) image with a
+// full mip chain. the result is cached on disk as KTX2, keyed by the content
+// hash of the source file (see `hash_file`, computed here unless given), so
+// only the first load of an image pays for decoding and compression, even if
+// it is copied or renamed. compression is split across `pool` if one is given.
+// `source` holds the bytes of the file if the caller already read it, then
+// they are hashed and decoded instead of reading the file again.
+[[nodiscard]]
+Ktx2Image load_compressed_texture(
+    const std::filesystem::path& path,
+    bool srgb,
+    ThreadPool* pool = nullptr,
+    std::optional<u64> content_hash = std::nullopt,
+    std::span<const u8> source = {}
+);
+
+}  // namespace hvk
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "hvk/core.hpp"
+#include "hvk/ktx2.hpp"
+#include "hvk/texture.hpp"
+#include "hvk/thread_pool.hpp"
+
+namespace hvk {
+
+struct TextureLoad;
+
+// result of loading an image file, exactly one of the members is set
+struct DecodedTexture {
+    // KTX2 files and compressed textures
+    std::optional<Ktx2Image> ktx{};
+    // everything else, decoded as RGBA8 straight into staging memory
+    std::optional<StagedImage> staged{};
+    // another load of a file with the same content, which was not decoded
+    // again (see `ResourceManager::load_texture`)
+    const TextureLoad* duplicate_of{};
+};
+
+// levels of an RGBA8 image that `decode_texture` filters into system memory
+enum class MipChain : u8 {
+    // none, the image stays in the staging memory it was decoded into
+    None,
+    // every level, see `VirtualTextureCache`
+    Full,
+    // only the mip tail, see `TextureStreamer`
+    Tail,
+};
+
+// reads and decodes an image file without recording any commands, so it can
+// run on any thread. with `compress` the image is loaded through the texture
+// cache instead (see `load_compressed_texture`, which is given `content_hash`
+// if it is already known and splits compression across `pool`). unless
+// `chain` is `MipChain::None` the result is always a mip chain in `ktx`.
+// `source` holds the bytes of the file if the caller already read them,
+// otherwise the file is read here.
+[[nodiscard]]
+DecodedTexture decode_texture(
+    const std::filesystem::path& path,
+    bool srgb,
+    bool compress,
+    MipChain chain = MipChain::None,
+    std::optional<u64> content_hash = std::nullopt,
+    ThreadPool* pool = nullptr,
+    std::vector<u8> source = {}
+);
+
+// reads a streamed texture again, keeping only the data of levels
+// `first_level` up to (not including) `last_level`. the other levels keep
+// their size, but have no data. safe to call from any thread.
+[[nodiscard]]
+std::optional<Ktx2Image> decode_texture_levels(
+    const std::filesystem::path& path,
+    bool srgb,
+    bool compress,
+    u32 first_level,
+    u32 last_level
+);
+
+// filters the levels of `staged` into system memory (laid out like a KTX2
+// image, so RGBA8 and compressed chains are handled the same) and releases
+// its staging buffer. the base level is read from the staging memory, only
+// levels from `first_level` up to `last_level` are copied out, the others
+// keep their size but have no data.
+[[nodiscard]]
+Ktx2Image build_mip_chain(
+    StagedImage& staged,
+    vk::Format format,
+    u32 first_level = 0,
+    u32 last_level = std::numeric_limits<u32>::max()
+);
+
+// state of one texture load, shared between the resource manager and handles
+struct TextureLoad {
+    // NOLINTBEGIN(misc-non-private-member-variables-in-classes)
+    Texture2D* texture{};
+    std::future<DecodedTexture> decoded{};
+    vk::Format format{vk::Format::eR8G8B8A8Srgb};
+    vk::ImageLayout layout{vk::ImageLayout::eReadOnlyOptimal};
+    vk::ImageUsageFlags usage{vk::ImageUsageFlagBits::eSampled};
+    vk::Filter filter{vk::Filter::eLinear};
+    vk::SamplerAddressMode addr_mode{vk::SamplerAddressMode::eRepeat};
+    // handed to the texture streamer once decoded, which reads it again from
+    // `path` (and the texture cache with `compressed`), see `TextureStreamer`
+    bool streamed{};
+    std::filesystem::path path{};
+    bool compressed{};
+    // paged through the virtual texture cache, see `VirtualTextureCache`
+    bool virtual_texture{};
+    std::atomic<bool> ready{};
+    // NOLINTEND(misc-non-private-member-variables-in-classes)
+};
+
+// refers to a texture that is decoded on worker threads and uploaded with the
+// next `ResourceManager::upload_pending_textures`. the texture pointer is
+// stable from the start (so materials can hold it), but only holds an image
+// once the handle is ready.
+class TextureHandle {
+public:
+    TextureHandle() = default;
+    explicit TextureHandle(std::shared_ptr<const TextureLoad> load);
+
+    [[nodiscard]]
+    bool valid() const noexcept;
+    // true once the texture has been uploaded and can be sampled
+    [[nodiscard]]
+    bool ready() const noexcept;
+    [[nodiscard]]
+    Texture2D* texture() const noexcept;
+
+private:
+    std::shared_ptr<const TextureLoad> _load{};
+};
+
+}  // namespace hvk
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <filesystem>
+#include <future>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "hvk/core.hpp"
+#include "hvk/ktx2.hpp"
+#include "hvk/texture.hpp"
+#include "hvk/texture_loader.hpp"
+#include "hvk/thread_pool.hpp"
+
+namespace hvk {
+
+class Scene;
+struct RenderSnapshot;
+
+// levels no larger than this are uploaded as soon as a streamed texture is
+// loaded and are never evicted, so materials can be drawn right away
+inline constexpr u32 STREAMING_MIP_TAIL_SIZE = 64;
+// mip data uploaded by a single frame, it is staged and recorded into the
+// frame command buffer
+inline constexpr vk::DeviceSize STREAMING_UPLOAD_LIMIT = 16 * 1024 * 1024;
+// frames a texture has to go unseen before its levels can be evicted
+inline constexpr usize STREAMING_EVICT_FRAMES = 30;
+// levels streamed beyond what the projected size asks for, since meshes
+// usually repeat their textures across the surface
+inline constexpr u32 STREAMING_LOD_BIAS = 1;
+
+// first level of the mip tail of an image with `levels` levels, see
+// `STREAMING_MIP_TAIL_SIZE`
+[[nodiscard]]
+u32 streaming_tail_level(u32 width, u32 height, u32 levels);
+
+// decides which levels of every streamed texture are resident on the device.
+// textures start out with only their mip tail and get sharper levels in order
+// of how large the nodes using them appear on screen. when the budget would be
+// exceeded, the sharpest levels of textures that have not been seen for a
+// while are dropped.
+//
+// only the size of each level is kept in system memory. sharper levels are
+// read again from the source file (or the texture cache) in the background
+// when they are needed, and their data is released once they are uploaded.
+//
+// changes are recorded into the frame command buffer: a texture gets a new
+// image that receives only the levels it did not have, the others are copied
+// from the image it replaces. replaced images are kept until the frames that
+// may still sample them have completed, and descriptors referring to the
+// textures have to be written again afterwards.
+class TextureStreamer {
+public:
+    explicit TextureStreamer(usize frames_in_flight);
+
+    TextureStreamer() = delete;
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer(TextureStreamer&&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(TextureStreamer&&) = delete;
+    ~TextureStreamer();
+
+    // uploads the mip tail of `image` into `load.texture`, the data of the
+    // other levels is not needed
+    void add(const TextureLoad& load, Ktx2Image image, ImageUploadBatch* batch = nullptr);
+
+    // levels are read again on `pool`, or on the calling thread without one
+    void set_pool(ThreadPool* pool) noexcept;
+
+    // limits the device memory used by streamed textures, 0 uses whatever VMA
+    // reports is left in the device local heaps
+    void set_budget(vk::DeviceSize bytes) noexcept;
+    [[nodiscard]]
+    vk::DeviceSize budget() const;
+    // bytes of mip data resident on the device
+    [[nodiscard]]
+    vk::DeviceSize resident_size() const noexcept;
+
+    // selects the levels each texture should have for the frame, returns true
+    // if any texture is changed by the next `apply`
+    bool update(const Scene& scene, const RenderSnapshot& snapshot, vk::Extent2D extent);
+    // records uploading (or dropping) the levels selected by the last `update`
+    // into `cmd`, before the render pass of frame number `frame`. the fence of
+    // that frame must have been waited on, images replaced by frames that
+    // are known to be complete are destroyed. returns the textures that got a
+    // new image, their descriptors have to be written again.
+    std::vector<const Texture2D*> apply(const vk::CommandBuffer& cmd, usize frame);
+
+private:
+    struct Entry {
+        Texture2D* texture{};
+        // layout of the levels, without data
+        Ktx2Image image{};
+        // sharper levels are read again from here, see `decode_texture_levels`
+        std::filesystem::path path{};
+        bool srgb{};
+        bool compressed{};
+        // levels `load_first` up to the resident level at the time, while
+        // they are being read and until they are uploaded
+        std::future<std::optional<Ktx2Image>> loading{};
+        std::optional<Ktx2Image> loaded{};
+        u32 load_first{};
+        u32 load_last{};
+        vk::ImageLayout layout{};
+        vk::ImageUsageFlags usage{};
+        vk::Filter filter{};
+        vk::SamplerAddressMode addr_mode{};
+        // first level of the mip tail
+        u32 tail{};
+        // first level on the device, and the one `apply` will upload from
+        u32 resident{};
+        u32 target{};
+        // largest projected diameter (in pixels) of a node using the texture
+        float pixels{};
+        usize last_seen{};
+    };
+
+    // an image replaced by frame number `frame`, along with the staging memory
+    // its successor was uploaded from
+    struct Retired {
+        usize frame{};
+        Texture2D texture{};
+        AllocatedBuffer staging{};
+    };
+
+    // bytes of the levels from `first_level` down to 1x1
+    [[nodiscard]]
+    static vk::DeviceSize level_size(const Entry& entry, u32 first_level);
+    [[nodiscard]]
+    static u32 wanted_level(const Entry& entry);
+    // drops levels until `required` more bytes fit in `budget`, returns false
+    // if there is nothing left that can be evicted
+    bool evict(vk::DeviceSize& resident, vk::DeviceSize required, vk::DeviceSize budget);
+    // starts reading the levels from `first_level` that are not resident
+    void load(Entry& entry, u32 first_level);
+
+    usize _frames_in_flight{};
+    ThreadPool* _pool{};
+    std::vector<Entry> _entries{};
+    std::unordered_map<const Texture2D*, usize> _index{};
+    vk::DeviceSize _budget{};
+    vk::DeviceSize _resident{};
+    usize _frame{};
+    std::vector<Retired> _retired{};
+};
+
+}  // namespace hvk
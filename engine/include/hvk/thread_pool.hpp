@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "hvk/core.hpp"
+
+namespace hvk {
+
+// fixed-size pool of worker threads consuming a FIFO task queue. tasks still
+// queued when the pool is destroyed are run before the workers exit, so
+// futures handed out by `submit` are always fulfilled.
+class ThreadPool {
+public:
+    explicit ThreadPool(usize thread_count = default_thread_count());
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+    ~ThreadPool();
+
+    // leaves one hardware thread for the main thread
+    [[nodiscard]]
+    static usize default_thread_count();
+
+    template<typename F>
+    auto submit(F&& func) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+
+        // packaged_task is move-only, but the queue stores std::function
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        auto future = task->get_future();
+        {
+            std::lock_guard lock{_mutex};
+            HVK_ASSERT(!_stopping, "Cannot submit tasks to a stopped thread pool");
+            _tasks.emplace([task]() { (*task)(); });
+        }
+        _cv.notify_one();
+        return future;
+    }
+
+    [[nodiscard]]
+    usize size() const noexcept;
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> _workers{};
+    std::queue<std::function<void()>> _tasks{};
+    std::mutex _mutex{};
+    std::condition_variable _cv{};
+    bool _stopping{};
+};
+
+}  // namespace hvk
@@ -5,6 +5,7 @@
 #include <vulkan/vulkan.hpp>
 
 #include "hvk/buffer.hpp"
+#include "hvk/descriptor_utils.hpp"
 #include "hvk/pipeline_builder.hpp"
 #include "hvk/texture.hpp"
 
@@ -38,8 +39,8 @@ private:
 
     Texture2D _font_tex{};
     vk::RenderPass _render_pass{};
-    vk::UniqueDescriptorPool _pool{};
-    vk::UniqueDescriptorSetLayout _descriptor_set_layout{};
+    DescriptorAllocator _descriptors{};
+    vk::DescriptorSetLayout _descriptor_set_layout{};
     vk::DescriptorSet _descriptor_set{};
     GraphicsPipeline _gfx_pipeline{};
     Buffer _vertex{}, _index{};
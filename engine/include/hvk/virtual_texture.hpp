@@ -0,0 +1,183 @@
+#pragma once
+
+#include <bit>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "hvk/allocator.hpp"
+#include "hvk/buffer.hpp"
+#include "hvk/core.hpp"
+#include "hvk/ktx2.hpp"
+#include "hvk/texture.hpp"
+#include "hvk/texture_loader.hpp"
+
+namespace hvk {
+
+// texels per side of a page, and the texels copied around each page from its
+// neighbours so bilinear filtering never reads another page in the cache
+inline constexpr u32 VT_PAGE_SIZE = 128;
+inline constexpr u32 VT_PAGE_BORDER = 4;
+inline constexpr u32 VT_SLOT_SIZE = VT_PAGE_SIZE + 2 * VT_PAGE_BORDER;
+// the physical cache holds this many pages per side
+inline constexpr u32 VT_CACHE_SLOTS = 16;
+inline constexpr u32 VT_CACHE_SIZE = VT_CACHE_SLOTS * VT_SLOT_SIZE;
+// pages per side of the first page table level, which limits virtual
+// textures to 16384x16384
+inline constexpr u32 VT_PAGE_TABLE_SIZE = 128;
+inline constexpr u32 VT_PAGE_TABLE_LEVELS = std::bit_width(VT_PAGE_TABLE_SIZE);
+// one page table layer (and feedback range) per texture
+inline constexpr u32 VT_MAX_TEXTURES = 8;
+// smaller textures are cheap enough to keep resident as a whole
+inline constexpr u32 VT_MIN_TEXTURE_SIZE = 4096;
+// pages copied into the cache by a single `update`
+inline constexpr u32 VT_UPLOADS_PER_FRAME = 16;
+// frames a slot has to go unused before a prefetched page may replace it
+inline constexpr usize VT_PREFETCH_AGE = 120;
+// one bit per page table entry of every level, per texture
+inline constexpr u32 VT_FEEDBACK_BITS = ((1u << (2 * VT_PAGE_TABLE_LEVELS)) - 1) / 3;
+inline constexpr u32 VT_FEEDBACK_WORDS = (VT_FEEDBACK_BITS + 31) / 32;
+
+// per-texture entry in the virtual texture buffer (std430)
+struct VirtualTextureData {
+    glm::uvec2 size{};
+    // the first level that fits in a single page, it and every smaller level
+    // are sampled from the regular texture instead of the cache
+    u32 root_level{};
+    u32 padding{};
+};
+
+// virtual texturing without sparse residency. large textures keep their mip
+// chain in system memory and are split into pages, and the pages that are
+// actually sampled are copied into one physical cache texture. shaders find a
+// page through an indirection texture (one array layer per texture, one mip
+// level per texture level) which points at the page itself or its nearest
+// resident ancestor.
+//
+// the pages a frame needs are reported by the fragment shader as bits in a
+// per-frame feedback buffer. once that frame has finished, `update` reads them
+// back, loads missing pages (coarse levels first) and a few of their
+// neighbours, and replaces the least recently used slots. the root page of
+// every texture is pinned, so there is always something to sample.
+class VirtualTextureCache {
+public:
+    explicit VirtualTextureCache(usize frames_in_flight);
+
+    VirtualTextureCache() = delete;
+    VirtualTextureCache(const VirtualTextureCache&) = delete;
+    VirtualTextureCache(VirtualTextureCache&&) = delete;
+    VirtualTextureCache& operator=(const VirtualTextureCache&) = delete;
+    VirtualTextureCache& operator=(VirtualTextureCache&&) = delete;
+    ~VirtualTextureCache();
+
+    // claims a page table layer for a texture of the given size, false if the
+    // texture should be loaded normally instead
+    [[nodiscard]]
+    bool reserve(u32 width, u32 height);
+    // returns a reservation that will not be added, e.g. for a texture that
+    // turned out to share its content with another one
+    void release();
+    // takes the full RGBA8 mip chain of a reserved texture. `load.texture` is
+    // filled with the levels from the root level down, which are sampled when
+    // the texture is small on screen.
+    void add(const TextureLoad& load, Ktx2Image image, ImageUploadBatch* batch = nullptr);
+    // 1 + the index of the texture in the virtual texture buffer, or 0 if
+    // `texture` is not virtual
+    [[nodiscard]]
+    u32 index_of(const Texture2D* texture) const;
+
+    // reads back the feedback of `frame` (which must have finished) and
+    // records the page and page table uploads into `cmd`. must be recorded
+    // before the render pass that samples the cache.
+    void update(usize frame, const vk::CommandBuffer& cmd);
+    // makes the feedback written by the fragment shader visible to the host,
+    // recorded after the render pass
+    static void record_feedback_barrier(const vk::CommandBuffer& cmd);
+
+    [[nodiscard]]
+    vk::DescriptorBufferInfo feedback_info(usize frame) const;
+    [[nodiscard]]
+    vk::DescriptorBufferInfo texture_info() const;
+    [[nodiscard]]
+    vk::DescriptorImageInfo cache_info() const;
+    [[nodiscard]]
+    vk::DescriptorImageInfo page_table_info() const;
+
+private:
+    struct Page {
+        u32 texture{};
+        u32 level{};
+        u32 x{};
+        u32 y{};
+
+        [[nodiscard]]
+        u32 key() const noexcept {
+            return (texture << 24) | (level << 16) | (y << 8) | x;
+        }
+    };
+
+    struct Slot {
+        Page page{};
+        bool used{};
+        bool pinned{};
+        usize last_used{};
+    };
+
+    struct VirtualTexture {
+        Texture2D* texture{};
+        Ktx2Image image{};
+        u32 root{};
+        // the page table layer has to be uploaded again
+        bool dirty{};
+    };
+
+    // per frame in flight, only touched once that frame has finished
+    struct FrameResources {
+        AllocatedBuffer feedback{};
+        u32* feedback_bits{};
+        AllocatedBuffer pages{};
+        u8* page_data{};
+        AllocatedBuffer tables{};
+        u8* table_data{};
+    };
+
+    [[nodiscard]]
+    static u32 level_pages(u32 size, u32 level);
+    // first feedback bit (and page table entry) of `level`
+    [[nodiscard]]
+    static u32 level_offset(u32 level);
+
+    void read_feedback(FrameResources& frame, std::vector<Page>& pages);
+    [[nodiscard]]
+    bool is_valid(const Page& page) const;
+    // a free slot or the least recently used one, null if every slot is
+    // pinned, used this frame, or (with `prefetch`) used too recently
+    [[nodiscard]]
+    Slot* find_slot(bool prefetch);
+    // assigns `page` to `slot` and writes its texels (with borders) to `staging`
+    void load_page(const Page& page, Slot& slot, u8* staging);
+    void write_page_table(
+        u32 index,
+        FrameResources& frame,
+        std::vector<vk::BufferImageCopy>& regions
+    );
+
+    std::vector<VirtualTexture> _textures{};
+    std::unordered_map<const Texture2D*, u32> _index{};
+    u32 _reserved{};
+    std::vector<Slot> _slots{};
+    std::unordered_map<u32, usize> _resident{};
+    std::vector<FrameResources> _frames{};
+    AllocatedImage _cache{};
+    vk::UniqueImageView _cache_view{};
+    vk::Sampler _cache_sampler{};
+    AllocatedImage _page_tables{};
+    vk::UniqueImageView _page_table_view{};
+    vk::Sampler _page_table_sampler{};
+    Buffer _texture_data{};
+    usize _frame{};
+};
+
+}  // namespace hvk
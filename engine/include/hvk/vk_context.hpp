@@ -5,6 +5,8 @@
 
 #include "hvk/allocator.hpp"
 #include "hvk/core.hpp"
+#include "hvk/layout_cache.hpp"
+#include "hvk/sampler_cache.hpp"
 
 namespace hvk {
 
@@ -63,6 +65,7 @@ public:
         self.create_instance(app_info, extensions);
         self.create_surface(window);
         self.create_device();
+        self.create_pipeline_cache();
         self.create_allocator();
         self.build_swapchain(window);
 
@@ -81,11 +84,60 @@ public:
         return instance()._gpu;
     }
 
+    // queried once when the device is selected, device limits do not change
+    [[nodiscard]]
+    static const vk::PhysicalDeviceProperties& gpu_properties() {
+        return instance()._gpu_properties;
+    }
+
+    [[nodiscard]]
+    static const vk::PhysicalDeviceLimits& limits() {
+        return instance()._gpu_properties.limits;
+    }
+
+    // runtime sized, partially bound and non-uniformly indexed sampler arrays
+    // (descriptor indexing, core in vulkan 1.2) are available and enabled
+    [[nodiscard]]
+    static bool supports_bindless() {
+        return instance()._bindless;
+    }
+
+    // true if BC1-7 compressed image formats can be sampled
+    [[nodiscard]]
+    static bool supports_bc_compression() {
+        return instance()._texture_compression_bc;
+    }
+
+    // fragment shaders can write to storage buffers (and use atomics on them)
+    [[nodiscard]]
+    static bool supports_fragment_stores() {
+        return instance()._fragment_stores;
+    }
+
     [[nodiscard]]
     static const vk::Device& device() {
         return instance()._device.get();
     }
 
+    // shared by every pipeline created through `PipelineBuilder`, loaded from
+    // disk at init and written back by `save_pipeline_cache`
+    [[nodiscard]]
+    static const vk::PipelineCache& pipeline_cache() {
+        return instance()._pipeline_cache.get();
+    }
+
+    static void save_pipeline_cache();
+
+    [[nodiscard]]
+    static LayoutCache& layout_cache() {
+        return instance()._layout_cache;
+    }
+
+    [[nodiscard]]
+    static SamplerCache& sampler_cache() {
+        return instance()._sampler_cache;
+    }
+
     [[nodiscard]]
     static Allocator& allocator() {
         return instance()._allocator;
@@ -189,20 +241,6 @@ public:
         );
     }
 
-    [[nodiscard]]
-    static vk::DescriptorSet allocate_descriptor_set(
-        const vk::UniqueDescriptorPool& pool,
-        const vk::UniqueDescriptorSetLayout& layout
-    ) {
-        vk::DescriptorSetAllocateInfo alloc_info{};
-        alloc_info.setDescriptorPool(pool.get()).setSetLayouts(layout.get());
-
-        auto sets = instance()._device->allocateDescriptorSets(alloc_info);
-        HVK_ASSERT(sets.size() == 1, "Allocation should create one descriptor set");
-
-        return sets[0];
-    }
-
     static void copy_staged_buffer(
         const AllocatedBuffer& src,
         const AllocatedBuffer& dst,
@@ -223,6 +261,7 @@ private:
     void create_surface(GLFWwindow* window);
     void select_queue_families();
     void create_device();
+    void create_pipeline_cache();
     void create_allocator();
 
     VulkanContext() = default;
@@ -231,6 +270,10 @@ private:
     u32 _api_version{VK_API_VERSION_1_3};
     vk::UniqueInstance _instance{};
     vk::PhysicalDevice _gpu{};
+    vk::PhysicalDeviceProperties _gpu_properties{};
+    bool _bindless{};
+    bool _texture_compression_bc{};
+    bool _fragment_stores{};
     vk::UniqueDevice _device{};
     vk::UniqueDebugUtilsMessengerEXT _messenger{};
     vk::UniqueSurfaceKHR _surface{};
@@ -240,6 +283,10 @@ private:
     Swapchain _swapchain{};
     Allocator _allocator{};
     vk::UniqueCommandPool _oneshot_pool{};
+    vk::UniquePipelineCache _pipeline_cache{};
+    // declared last so cached layouts and samplers are destroyed before the device
+    LayoutCache _layout_cache{};
+    SamplerCache _sampler_cache{};
 };
 
 }  // namespace hvk
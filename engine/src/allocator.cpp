@@ -1,6 +1,9 @@
 #define VMA_IMPLEMENTATION
 #include "hvk/allocator.hpp"
 
+#include <array>
+#include <vector>
+
 namespace hvk {
 
 Allocator::Allocator(
@@ -17,6 +20,7 @@ Allocator::Allocator(
     vmaCreateAllocator(&info, &_allocator);
 
     HVK_ASSERT(_allocator, "VMA failed to create allocator");
+    create_pools();
 }
 
 Allocator::Allocator(Allocator&& other) noexcept {
@@ -25,6 +29,10 @@ Allocator::Allocator(Allocator&& other) noexcept {
     }
 
     std::swap(_allocator, other._allocator);
+    std::swap(_pools, other._pools);
+    std::swap(_pool_memory_types, other._pool_memory_types);
+    std::swap(_defragmentation, other._defragmentation);
+    std::swap(_defragmentation_pass, other._defragmentation_pass);
 }
 
 Allocator& Allocator::operator=(Allocator&& rhs) noexcept {
@@ -33,6 +41,10 @@ Allocator& Allocator::operator=(Allocator&& rhs) noexcept {
     }
 
     std::swap(_allocator, rhs._allocator);
+    std::swap(_pools, rhs._pools);
+    std::swap(_pool_memory_types, rhs._pool_memory_types);
+    std::swap(_defragmentation, rhs._defragmentation);
+    std::swap(_defragmentation_pass, rhs._defragmentation_pass);
     return *this;
 }
 
@@ -57,18 +69,36 @@ AllocatedBuffer Allocator::create_buffer(
     alloc_info.usage = mem_usage;
     alloc_info.flags = flags;
 
+    // explicitly dedicated allocations never come from a pool
+    const auto category = buffer_category(buf_usage, flags);
+    u32 memory_type{};
+    if (category && (flags & VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT) == 0
+        && vmaFindMemoryTypeIndexForBufferInfo(_allocator, &vk_buf_info, &alloc_info, &memory_type)
+               == VK_SUCCESS) {
+        alloc_info.pool = select_pool(*category, memory_type, size);
+    }
+
     AllocatedBuffer buf{};
-    VK_CHECK(
-        vmaCreateBuffer(
+    auto create = [&]() {
+        return vmaCreateBuffer(
             _allocator,
             &vk_buf_info,
             &alloc_info,
             &buf.buffer,
             &buf.allocation,
             allocation_info
-        ),
-        "Failed to create allocated buffer"
-    );
+        );
+    };
+    auto result = create();
+    if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && alloc_info.pool) {
+        // a pool can only grow by a whole block, which may not fit in the
+        // heap anymore. the default pools try smaller blocks and dedicated
+        // memory before giving up.
+        spdlog::debug("Memory pool is full, allocating {} byte buffer outside of it", size);
+        alloc_info.pool = nullptr;
+        result = create();
+    }
+    VK_CHECK(result, "Failed to create allocated buffer");
     buf.size = size;
 
     return buf;
@@ -82,6 +112,23 @@ AllocatedBuffer Allocator::create_staging_buffer(vk::DeviceSize size) {
     );
 }
 
+AllocatedBuffer Allocator::create_mapped_staging_buffer(vk::DeviceSize size, void** mapped) {
+    // random access selects cached memory, which is fast for decoders that
+    // read back what they wrote (e.g. PNG filters) unlike write-combined memory
+    VmaAllocationInfo info{};
+    auto buf = create_buffer(
+        size,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        VMA_MEMORY_USAGE_AUTO,
+        &info
+    );
+    HVK_ASSERT(info.pMappedData, "Staging buffer should be persistently mapped");
+    *mapped = info.pMappedData;
+
+    return buf;
+}
+
 AllocatedImage Allocator::create_image(
     const vk::ImageCreateInfo& info,
     VmaAllocationCreateFlags flags,
@@ -92,17 +139,346 @@ AllocatedImage Allocator::create_image(
     i_alloc_info.usage = mem_usage;
     i_alloc_info.flags = flags;
 
+    // estimated at 4 bytes per texel (an upper bound for the formats used
+    // here) plus a third for the mip chain, the exact size is only known once
+    // the image exists
+    vk::DeviceSize size = static_cast<vk::DeviceSize>(info.extent.width) * info.extent.height
+        * info.extent.depth * info.arrayLayers * 4;
+    if (info.mipLevels > 1) {
+        size += size / 3;
+    }
+
+    // explicitly dedicated allocations never come from a pool
+    const auto category = image_category(info.usage);
+    const bool dedicated = (flags & VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT) != 0;
+    if (!dedicated && category == MemoryCategory::RenderTarget
+        && size >= RENDER_TARGET_DEDICATED_SIZE) {
+        // large attachments are recreated on resize, and some drivers place
+        // dedicated attachments more efficiently
+        i_alloc_info.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    } else if (!dedicated) {
+        u32 memory_type{};
+        const auto found =
+            vmaFindMemoryTypeIndexForImageInfo(_allocator, &vk_info, &i_alloc_info, &memory_type);
+        if (found == VK_SUCCESS) {
+            i_alloc_info.pool = select_pool(category, memory_type, size);
+        }
+    }
+
     AllocatedImage img{};
+    auto create = [&]() {
+        return vmaCreateImage(
+            _allocator,
+            &vk_info,
+            &i_alloc_info,
+            &img.image,
+            &img.allocation,
+            nullptr
+        );
+    };
+    auto result = create();
+    if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && i_alloc_info.pool) {
+        // see `create_buffer`
+        spdlog::debug(
+            "Memory pool is full, allocating {}x{} image outside of it",
+            info.extent.width,
+            info.extent.height
+        );
+        i_alloc_info.pool = nullptr;
+        result = create();
+    }
+    VK_CHECK(result, "Failed to create allocated image");
+
+    return img;
+}
+
+MemoryBudget Allocator::device_local_budget() const {
+    MemoryBudget result{};
+    for (const auto& heap : heap_budgets()) {
+        if (heap.device_local) {
+            result.usage += heap.usage;
+            result.budget += heap.budget;
+        }
+    }
+    return result;
+}
+
+std::vector<HeapBudget> Allocator::heap_budgets() const {
+    const VkPhysicalDeviceMemoryProperties* props{};
+    vmaGetMemoryProperties(_allocator, &props);
+
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+    vmaGetHeapBudgets(_allocator, budgets.data());
+
+    std::vector<HeapBudget> result{};
+    for (u32 i = 0; i < props->memoryHeapCount; i++) {
+        const auto& budget = budgets.at(i);
+        result.push_back({
+            .reserved = budget.statistics.blockBytes,
+            .allocated = budget.statistics.allocationBytes,
+            .usage = budget.usage,
+            .budget = budget.budget,
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+            .device_local = (props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+        });
+    }
+    return result;
+}
+
+PoolStats Allocator::pool_stats(MemoryCategory category) const {
+    VmaStatistics stats{};
+    vmaGetPoolStatistics(_allocator, _pools.at(static_cast<usize>(category)), &stats);
+    return {
+        .blocks = stats.blockCount,
+        .allocations = stats.allocationCount,
+        .reserved = stats.blockBytes,
+        .allocated = stats.allocationBytes,
+    };
+}
+
+bool Allocator::is_fragmented(MemoryCategory category) const {
+    const auto i = static_cast<usize>(category);
+    const auto block_size = MEMORY_POOL_BLOCK_SIZES.at(i);
+    VmaDetailedStatistics stats{};
+    vmaCalculatePoolStatistics(_allocator, _pools.at(i), &stats);
+
+    // VMA keeps (at most) one empty block around on purpose so that freeing
+    // and allocating again does not thrash, that block is free but not
+    // fragmented and nothing can be moved out of it
+    auto free = stats.statistics.blockBytes - stats.statistics.allocationBytes;
+    auto free_ranges = stats.unusedRangeCount;
+    if (stats.unusedRangeSizeMax >= block_size) {
+        free -= block_size;
+        free_ranges--;
+    }
+    // free space spread over more than one range inside the used blocks,
+    // which adds up to a whole block that compaction could release
+    return free >= block_size && free_ranges > 1;
+}
+
+bool Allocator::begin_defragmentation(MemoryCategory category) {
+    if (_defragmentation) {
+        return false;
+    }
+
+    const auto stats = pool_stats(category);
+    constexpr double mib = 1024.0 * 1024.0;
+    spdlog::debug(
+        "Defragmenting memory pool {}: {:.1f} MiB used in {} blocks ({:.1f} MiB)",
+        static_cast<usize>(category),
+        static_cast<double>(stats.allocated) / mib,
+        stats.blocks,
+        static_cast<double>(stats.reserved) / mib
+    );
+
+    VmaDefragmentationInfo info{};
+    info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+    info.pool = _pools.at(static_cast<usize>(category));
+    info.maxBytesPerPass = DEFRAGMENTATION_BYTES_PER_PASS;
+    info.maxAllocationsPerPass = DEFRAGMENTATION_MOVES_PER_PASS;
     VK_CHECK(
-        vmaCreateImage(_allocator, &vk_info, &i_alloc_info, &img.image, &img.allocation, nullptr),
-        "Failed to allocate depth buffer image"
+        vmaBeginDefragmentation(_allocator, &info, &_defragmentation),
+        "Failed to begin defragmentation"
     );
+    return true;
+}
 
-    return img;
+bool Allocator::is_defragmenting() const noexcept {
+    return _defragmentation != nullptr;
+}
+
+std::span<VmaDefragmentationMove> Allocator::begin_defragmentation_pass() {
+    HVK_ASSERT(_defragmentation, "Defragmentation has not been started");
+
+    _defragmentation_pass = {};
+    const auto result =
+        vmaBeginDefragmentationPass(_allocator, _defragmentation, &_defragmentation_pass);
+    if (result == VK_SUCCESS) {
+        end_defragmentation();
+        return {};
+    }
+    HVK_ASSERT(result == VK_INCOMPLETE, "Failed to begin defragmentation pass");
+    return {_defragmentation_pass.pMoves, _defragmentation_pass.moveCount};
+}
+
+void Allocator::end_defragmentation_pass() {
+    HVK_ASSERT(_defragmentation, "Defragmentation has not been started");
+
+    const auto result =
+        vmaEndDefragmentationPass(_allocator, _defragmentation, &_defragmentation_pass);
+    _defragmentation_pass = {};
+    if (result == VK_SUCCESS) {
+        end_defragmentation();
+        return;
+    }
+    HVK_ASSERT(result == VK_INCOMPLETE, "Failed to end defragmentation pass");
+}
+
+void Allocator::bind_buffer(VkBuffer buffer, VmaAllocation allocation) {
+    VK_CHECK(
+        vmaBindBufferMemory(_allocator, allocation, buffer),
+        "Failed to bind buffer memory"
+    );
+}
+
+void Allocator::bind_image(VkImage image, VmaAllocation allocation) {
+    VK_CHECK(vmaBindImageMemory(_allocator, allocation, image), "Failed to bind image memory");
+}
+
+std::optional<MemoryCategory> Allocator::buffer_category(
+    vk::BufferUsageFlags usage,
+    VmaAllocationCreateFlags flags
+) {
+    if (usage & (vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer)) {
+        return MemoryCategory::Geometry;
+    }
+    if (usage
+        & (vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer)) {
+        return MemoryCategory::Uniform;
+    }
+    if (usage == vk::BufferUsageFlagBits::eTransferSrc) {
+        return flags & VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+            ? MemoryCategory::CachedStaging
+            : MemoryCategory::Staging;
+    }
+    return std::nullopt;
+}
+
+MemoryCategory Allocator::image_category(vk::ImageUsageFlags usage) {
+    const auto attachment = vk::ImageUsageFlagBits::eColorAttachment
+        | vk::ImageUsageFlagBits::eDepthStencilAttachment;
+    return usage & attachment ? MemoryCategory::RenderTarget : MemoryCategory::Texture;
+}
+
+void Allocator::create_pools() {
+    // each pool lives in the memory type VMA picks for a typical resource of
+    // its category, resources that end up in another type are not pooled
+    vk::ImageCreateInfo image{};
+    image.setImageType(vk::ImageType::e2D)
+        .setExtent({256, 256, 1})
+        .setFormat(vk::Format::eR8G8B8A8Srgb)
+        .setUsage(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setMipLevels(1)
+        .setArrayLayers(1)
+        .setTiling(vk::ImageTiling::eOptimal);
+    vk::BufferCreateInfo buffer{};
+    buffer.setSize(64 * 1024);
+
+    auto image_type = [this](const vk::ImageCreateInfo& info, VmaAllocationCreateFlags flags) {
+        auto vk_info = static_cast<VkImageCreateInfo>(info);
+        VmaAllocationCreateInfo alloc_info{};
+        alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+        alloc_info.flags = flags;
+        u32 type{};
+        VK_CHECK(
+            vmaFindMemoryTypeIndexForImageInfo(_allocator, &vk_info, &alloc_info, &type),
+            "Failed to find a memory type for image pool"
+        );
+        return type;
+    };
+    auto buffer_type = [this](const vk::BufferCreateInfo& info, VmaAllocationCreateFlags flags) {
+        auto vk_info = static_cast<VkBufferCreateInfo>(info);
+        VmaAllocationCreateInfo alloc_info{};
+        alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+        alloc_info.flags = flags;
+        u32 type{};
+        VK_CHECK(
+            vmaFindMemoryTypeIndexForBufferInfo(_allocator, &vk_info, &alloc_info, &type),
+            "Failed to find a memory type for buffer pool"
+        );
+        return type;
+    };
+
+    auto pool_type = [this](MemoryCategory category) -> u32& {
+        return _pool_memory_types.at(static_cast<usize>(category));
+    };
+    pool_type(MemoryCategory::Texture) = image_type(image, 0);
+    image.setFormat(vk::Format::eD32Sfloat)
+        .setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment);
+    pool_type(MemoryCategory::RenderTarget) = image_type(image, 0);
+    buffer.setUsage(
+        vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer
+        | vk::BufferUsageFlagBits::eTransferDst
+    );
+    // matches `Mesh`, which writes directly into host visible device memory
+    // where there is any
+    pool_type(MemoryCategory::Geometry) = buffer_type(
+        buffer,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+            | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT
+    );
+    // match `create_staging_buffer` and `create_mapped_staging_buffer`
+    buffer.setUsage(vk::BufferUsageFlagBits::eTransferSrc);
+    pool_type(MemoryCategory::Staging) =
+        buffer_type(buffer, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+    pool_type(MemoryCategory::CachedStaging) = buffer_type(
+        buffer,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT
+    );
+    // matches `Buffer`, which is used for every uniform and storage buffer
+    buffer.setUsage(
+        vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer
+    );
+    pool_type(MemoryCategory::Uniform) = buffer_type(
+        buffer,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+            | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT
+            | VMA_ALLOCATION_CREATE_MAPPED_BIT
+    );
+
+    for (usize i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+        VmaPoolCreateInfo pool_info{};
+        pool_info.memoryTypeIndex = _pool_memory_types.at(i);
+        pool_info.blockSize = MEMORY_POOL_BLOCK_SIZES.at(i);
+        VK_CHECK(
+            vmaCreatePool(_allocator, &pool_info, &_pools.at(i)),
+            "Failed to create memory pool"
+        );
+        spdlog::trace(
+            "Created memory pool {}: type={}, block size={} MiB",
+            i,
+            pool_info.memoryTypeIndex,
+            pool_info.blockSize / (1024 * 1024)
+        );
+    }
+}
+
+VmaPool Allocator::select_pool(MemoryCategory category, u32 memory_type, vk::DeviceSize size)
+    const {
+    const auto i = static_cast<usize>(category);
+    if (_pool_memory_types.at(i) != memory_type || size > MEMORY_POOL_BLOCK_SIZES.at(i) / 2) {
+        return nullptr;
+    }
+    return _pools.at(i);
+}
+
+void Allocator::end_defragmentation() {
+    VmaDefragmentationStats stats{};
+    vmaEndDefragmentation(_allocator, _defragmentation, &stats);
+    _defragmentation = nullptr;
+
+    constexpr double mib = 1024.0 * 1024.0;
+    spdlog::debug(
+        "Defragmented memory pool: moved {} allocations ({:.1f} MiB), released {} blocks "
+        "({:.1f} MiB)",
+        stats.allocationsMoved,
+        static_cast<double>(stats.bytesMoved) / mib,
+        stats.deviceMemoryBlocksFreed,
+        static_cast<double>(stats.bytesFreed) / mib
+    );
 }
 
 void Allocator::destroy_inner() {
     if (_allocator) {
+        if (_defragmentation) {
+            vmaEndDefragmentation(_allocator, _defragmentation, nullptr);
+        }
+        for (auto* pool : _pools) {
+            if (pool) {
+                vmaDestroyPool(_allocator, pool);
+            }
+        }
         vmaDestroyAllocator(_allocator);
     }
 }
@@ -0,0 +1,228 @@
+#include "hvk/bc_encoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "hvk/pixel_kernels.hpp"
+
+namespace hvk {
+
+// block rows handed to each task, small enough to balance across workers
+inline constexpr u32 BC_ROWS_PER_TASK = 8;
+
+using Block = std::array<u8, 64>;
+
+u16 pack_565(const std::array<u8, 3>& c) {
+    const auto r = static_cast<u16>((c[0] * 31 + 127) / 255);
+    const auto g = static_cast<u16>((c[1] * 63 + 127) / 255);
+    const auto b = static_cast<u16>((c[2] * 31 + 127) / 255);
+    return static_cast<u16>((r << 11) | (g << 5) | b);
+}
+
+std::array<i32, 3> unpack_565(u16 c) {
+    const auto r = (c >> 11) & 0x1f;
+    const auto g = (c >> 5) & 0x3f;
+    const auto b = c & 0x1f;
+    // replicate high bits into the low bits, matching hardware decoding
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+// gathers a 4x4 block of texels, clamping at the image edges
+Block fetch_block(const u8* rgba, u32 width, u32 height, u32 bx, u32 by) {
+    Block block{};
+    for (u32 y = 0; y < 4; y++) {
+        const auto sy = std::min(by * 4 + y, height - 1);
+        for (u32 x = 0; x < 4; x++) {
+            const auto sx = std::min(bx * 4 + x, width - 1);
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            const auto* src = rgba + (static_cast<usize>(sy) * width + sx) * 4;
+            std::copy_n(src, 4, block.begin() + (y * 4 + x) * 4);
+        }
+    }
+    return block;
+}
+
+void write_u16(u8* dst, u16 value) {
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    dst[0] = static_cast<u8>(value & 0xff);
+    dst[1] = static_cast<u8>(value >> 8);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+// 8 bytes: two RGB565 endpoints and 2-bit indices, always 4-color mode
+void encode_bc1_block(const Block& block, u8* dst) {
+    std::array<u8, 4> lo{};
+    std::array<u8, 4> hi{};
+    bc_block_bounds(block.data(), lo, hi);
+    // inset the box slightly, the extremes are rarely worth an endpoint
+    for (usize c = 0; c < 3; c++) {
+        const auto inset = static_cast<u8>((hi[c] - lo[c]) >> 4);
+        lo[c] = static_cast<u8>(lo[c] + inset);
+        hi[c] = static_cast<u8>(hi[c] - inset);
+    }
+
+    auto c0 = pack_565({hi[0], hi[1], hi[2]});
+    auto c1 = pack_565({lo[0], lo[1], lo[2]});
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+    write_u16(dst, c0);
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    write_u16(dst + 2, c1);
+
+    u32 indices{};
+    if (c0 != c1) {
+        const auto p0 = unpack_565(c0);
+        const auto p1 = unpack_565(c1);
+        BcPalette palette{p0, p1, {}, {}};
+        for (usize c = 0; c < 3; c++) {
+            palette[2][c] = (2 * p0[c] + p1[c]) / 3;
+            palette[3][c] = (p0[c] + 2 * p1[c]) / 3;
+        }
+        indices = bc1_indices(block.data(), palette);
+    }
+    for (usize i = 0; i < 4; i++) {
+        dst[4 + i] = static_cast<u8>((indices >> (i * 8)) & 0xff);
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+// 8 bytes: two 8-bit endpoints and 3-bit indices for one channel
+void encode_bc4_block(const Block& block, usize channel, u8* dst) {
+    std::array<u8, 4> bounds_lo{};
+    std::array<u8, 4> bounds_hi{};
+    bc_block_bounds(block.data(), bounds_lo, bounds_hi);
+    const auto lo = bounds_lo[channel];
+    const auto hi = bounds_hi[channel];
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    // a0 > a1 selects the 8-value interpolation mode
+    dst[0] = hi;
+    dst[1] = lo;
+
+    u64 indices{};
+    if (hi != lo) {
+        std::array<u8, 8> palette{hi, lo};
+        for (i32 i = 1; i < 7; i++) {
+            palette[static_cast<usize>(i + 1)] = static_cast<u8>(((7 - i) * hi + i * lo) / 7);
+        }
+        indices = bc4_indices(block.data(), channel, palette);
+    }
+    for (usize i = 0; i < 6; i++) {
+        dst[2 + i] = static_cast<u8>((indices >> (i * 8)) & 0xff);
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+void encode_block(const Block& block, BcFormat format, u8* dst) {
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    switch (format) {
+        case BcFormat::BC1:
+            encode_bc1_block(block, dst);
+            break;
+        case BcFormat::BC3:
+            encode_bc4_block(block, 3, dst);
+            encode_bc1_block(block, dst + 8);
+            break;
+        case BcFormat::BC5:
+            encode_bc4_block(block, 0, dst);
+            encode_bc4_block(block, 1, dst + 8);
+            break;
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+usize bc_block_size(BcFormat format) {
+    return format == BcFormat::BC1 ? 8 : 16;
+}
+
+vk::Format bc_vk_format(BcFormat format, bool srgb) {
+    switch (format) {
+        case BcFormat::BC1:
+            return srgb ? vk::Format::eBc1RgbSrgbBlock : vk::Format::eBc1RgbUnormBlock;
+        case BcFormat::BC3:
+            return srgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+        case BcFormat::BC5:
+            return vk::Format::eBc5UnormBlock;
+    }
+
+    panic("Unsupported BC format");
+}
+
+usize bc_level_size(BcFormat format, u32 width, u32 height) {
+    const usize blocks_x = (width + 3) / 4;
+    const usize blocks_y = (height + 3) / 4;
+    return blocks_x * blocks_y * bc_block_size(format);
+}
+
+std::vector<u8> encode_bc(
+    const u8* rgba,
+    u32 width,
+    u32 height,
+    BcFormat format,
+    ThreadPool* pool
+) {
+    const u32 blocks_x = (width + 3) / 4;
+    const u32 blocks_y = (height + 3) / 4;
+    const auto block_size = bc_block_size(format);
+    std::vector<u8> result(bc_level_size(format, width, height));
+
+    auto encode_rows = [&](u32 first, u32 last) {
+        for (u32 by = first; by < last; by++) {
+            for (u32 bx = 0; bx < blocks_x; bx++) {
+                const auto block = fetch_block(rgba, width, height, bx, by);
+                const auto offset = (static_cast<usize>(by) * blocks_x + bx) * block_size;
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                encode_block(block, format, result.data() + offset);
+            }
+        }
+    };
+
+    if (!pool || blocks_y <= BC_ROWS_PER_TASK) {
+        encode_rows(0, blocks_y);
+        return result;
+    }
+
+    // rows are claimed in chunks by the calling thread and by tasks on
+    // `pool`, so the caller only ever waits for rows that are being encoded.
+    // the caller may itself be a task on `pool`: it never waits for a task
+    // that is still queued, and tasks that start after every row was claimed
+    // return without touching the image.
+    struct Progress {
+        std::atomic<u32> next{};
+        std::atomic<u32> done{};
+    };
+    auto progress = std::make_shared<Progress>();
+    auto claim_rows = [progress, blocks_y, &encode_rows] {
+        while (true) {
+            const auto first = progress->next.fetch_add(BC_ROWS_PER_TASK);
+            if (first >= blocks_y) {
+                return;
+            }
+            const auto last = std::min(first + BC_ROWS_PER_TASK, blocks_y);
+            encode_rows(first, last);
+            progress->done.fetch_add(last - first, std::memory_order_release);
+            progress->done.notify_all();
+        }
+    };
+
+    const auto chunks = (blocks_y + BC_ROWS_PER_TASK - 1) / BC_ROWS_PER_TASK;
+    const auto helpers = std::min<usize>(pool->size(), chunks - 1);
+    for (usize i = 0; i < helpers; i++) {
+        // the future is not needed, completion is tracked through `progress`
+        static_cast<void>(pool->submit(claim_rows));
+    }
+    claim_rows();
+
+    auto done = progress->done.load(std::memory_order_acquire);
+    while (done < blocks_y) {
+        progress->done.wait(done, std::memory_order_acquire);
+        done = progress->done.load(std::memory_order_acquire);
+    }
+
+    return result;
+}
+
+}  // namespace hvk
@@ -20,6 +20,10 @@ bool Buffer::is_mapped() const {
         && static_cast<bool>(_mem_props & vk::MemoryPropertyFlagBits::eHostVisible);
 }
 
+void* Buffer::mapped_data() const {
+    return _data;
+}
+
 vk::Buffer Buffer::buffer() const {
     return static_cast<vk::Buffer>(_buf.buffer);
 }
@@ -0,0 +1,164 @@
+#include "hvk/content_hash.hpp"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace hvk {
+
+inline constexpr u64 XXH_PRIME_1 = 0x9e3779b185ebca87ull;
+inline constexpr u64 XXH_PRIME_2 = 0xc2b2ae3d27d4eb4full;
+inline constexpr u64 XXH_PRIME_3 = 0x165667b19e3779f9ull;
+inline constexpr u64 XXH_PRIME_4 = 0x85ebca77c2b2ae63ull;
+inline constexpr u64 XXH_PRIME_5 = 0x27d4eb2f165667c5ull;
+
+// files are hashed in chunks of this size
+inline constexpr usize HASH_FILE_CHUNK = 1024 * 1024;
+
+// inputs are read as little endian, like every platform this builds for
+u64 read_u64(const u8* data) noexcept {
+    u64 value{};
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+u32 read_u32(const u8* data) noexcept {
+    u32 value{};
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+u64 xxh_round(u64 acc, u64 input) noexcept {
+    acc += input * XXH_PRIME_2;
+    acc = std::rotl(acc, 31);
+    return acc * XXH_PRIME_1;
+}
+
+u64 xxh_merge(u64 hash, u64 acc) noexcept {
+    hash ^= xxh_round(0, acc);
+    return hash * XXH_PRIME_1 + XXH_PRIME_4;
+}
+
+ContentHasher::ContentHasher(u64 seed) noexcept
+    : _acc{seed + XXH_PRIME_1 + XXH_PRIME_2, seed + XXH_PRIME_2, seed, seed - XXH_PRIME_1},
+      _seed{seed} {}
+
+void ContentHasher::update(std::span<const u8> data) noexcept {
+    _length += data.size();
+    const auto* ptr = data.data();
+    auto remaining = data.size();
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (_buffered > 0) {
+        const auto count = std::min(remaining, _buffer.size() - _buffered);
+        std::memcpy(_buffer.data() + _buffered, ptr, count);
+        _buffered += count;
+        ptr += count;
+        remaining -= count;
+        if (_buffered < _buffer.size()) {
+            return;
+        }
+        consume(_buffer.data());
+        _buffered = 0;
+    }
+
+    for (; remaining >= _buffer.size(); ptr += _buffer.size(), remaining -= _buffer.size()) {
+        consume(ptr);
+    }
+    std::memcpy(_buffer.data(), ptr, remaining);
+    _buffered = remaining;
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+u64 ContentHasher::digest() const noexcept {
+    u64 hash{};
+    if (_length >= _buffer.size()) {
+        hash = std::rotl(_acc[0], 1) + std::rotl(_acc[1], 7) + std::rotl(_acc[2], 12)
+            + std::rotl(_acc[3], 18);
+        for (const auto acc : _acc) {
+            hash = xxh_merge(hash, acc);
+        }
+    } else {
+        hash = _seed + XXH_PRIME_5;
+    }
+    hash += _length;
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto* ptr = _buffer.data();
+    const auto* end = ptr + _buffered;
+    for (; ptr + 8 <= end; ptr += 8) {
+        hash ^= xxh_round(0, read_u64(ptr));
+        hash = std::rotl(hash, 27) * XXH_PRIME_1 + XXH_PRIME_4;
+    }
+    if (ptr + 4 <= end) {
+        hash ^= static_cast<u64>(read_u32(ptr)) * XXH_PRIME_1;
+        hash = std::rotl(hash, 23) * XXH_PRIME_2 + XXH_PRIME_3;
+        ptr += 4;
+    }
+    for (; ptr < end; ptr++) {
+        hash ^= static_cast<u64>(*ptr) * XXH_PRIME_5;
+        hash = std::rotl(hash, 11) * XXH_PRIME_1;
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+void ContentHasher::consume(const u8* stripe) noexcept {
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (usize i = 0; i < _acc.size(); i++) {
+        _acc.at(i) = xxh_round(_acc.at(i), read_u64(stripe + i * 8));
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+u64 content_hash(std::span<const u8> data, u64 seed) noexcept {
+    ContentHasher hasher{seed};
+    hasher.update(data);
+    return hasher.digest();
+}
+
+std::optional<u64> hash_file(const std::filesystem::path& path) {
+    std::ifstream file{path, std::ios::binary};
+    if (!file) {
+        return std::nullopt;
+    }
+
+    ContentHasher hasher{};
+    std::vector<char> chunk(HASH_FILE_CHUNK);
+    while (file) {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        const auto count = static_cast<usize>(file.gcount());
+        hasher.update({reinterpret_cast<const u8*>(chunk.data()), count});  // NOLINT
+    }
+    if (file.bad()) {
+        return std::nullopt;
+    }
+    return hasher.digest();
+}
+
+std::optional<std::vector<u8>> read_file(const std::filesystem::path& path) {
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file) {
+        return std::nullopt;
+    }
+
+    std::vector<u8> bytes(static_cast<usize>(file.tellg()));
+    file.seekg(0);
+    file.read(
+        reinterpret_cast<char*>(bytes.data()),  // NOLINT
+        static_cast<std::streamsize>(bytes.size())
+    );
+    if (!file) {
+        return std::nullopt;
+    }
+    return bytes;
+}
+
+}  // namespace hvk
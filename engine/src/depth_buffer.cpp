@@ -34,11 +34,7 @@ DepthBuffer::DepthBuffer(vk::Extent2D extent) {
         .setArrayLayers(1)
         .setTiling(vk::ImageTiling::eOptimal);
 
-    auto image = allocator.create_image(
-        ici,
-        VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
-        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
-    );
+    auto image = allocator.create_image(ici, {}, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
     std::swap(_image, image);
 
     vk::ImageViewCreateInfo ivci{};
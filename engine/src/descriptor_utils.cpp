@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "hvk/descriptor_utils.hpp"
 #include "hvk/vk_context.hpp"
 
@@ -26,13 +28,24 @@ const DescriptorDetails& DescriptorSetBindingMap::at(u32 binding) const {
     return _details.at(binding);
 }
 
-vk::UniqueDescriptorSetLayout DescriptorSetBindingMap::build_layout() {
+void DescriptorSetBindingMap::push_back(const DescriptorDetails& item) {
+    const auto binding = _details.empty() ? 0 : _details.rbegin()->first + 1;
+    _details.insert_or_assign(binding, item);
+}
+
+vk::DescriptorSetLayout DescriptorSetBindingMap::build_layout() const {
     return DescriptorSetLayoutBuilder{*this}.build();
 }
 
+DescriptorUpdateTemplate DescriptorSetBindingMap::build_update_template(
+    vk::DescriptorSetLayout layout
+) const {
+    return DescriptorUpdateTemplate{*this, layout};
+}
+
 DescriptorSetLayoutBuilder::DescriptorSetLayoutBuilder(const DescriptorSetBindingMap& map) {
     for (const auto& [binding, item] : map) {
-        this->add_binding(binding, item.type, item.stage_flags, item.count);
+        this->add_binding(binding, item.type, item.stage_flags, item.count, item.binding_flags);
     }
 }
 
@@ -40,7 +53,8 @@ DescriptorSetLayoutBuilder& DescriptorSetLayoutBuilder::add_binding(
     u32 binding,
     vk::DescriptorType type,
     vk::ShaderStageFlags stage_flags,
-    u32 descriptor_count
+    u32 descriptor_count,
+    vk::DescriptorBindingFlags binding_flags
 ) {
     vk::DescriptorSetLayoutBinding layout_binding{};
     layout_binding.setBinding(binding)
@@ -48,17 +62,235 @@ DescriptorSetLayoutBuilder& DescriptorSetLayoutBuilder::add_binding(
         .setDescriptorType(type)
         .setStageFlags(stage_flags);
     _bindings.push_back(layout_binding);
+    _binding_flags.push_back(binding_flags);
     return *this;
 }
 
-vk::UniqueDescriptorSetLayout DescriptorSetLayoutBuilder::build() {
-    auto layout = VulkanContext::device().createDescriptorSetLayoutUnique(
-        vk::DescriptorSetLayoutCreateInfo{{}, _bindings}
-    );
+vk::DescriptorSetLayout DescriptorSetLayoutBuilder::build() {
+    auto layout = VulkanContext::layout_cache().descriptor_set_layout({
+        std::move(_bindings),
+        std::move(_binding_flags),
+    });
     *this = {};
     return layout;
 }
 
+// hard cap on sets per pool so a single pool does not grow unbounded
+inline constexpr u32 MAX_SETS_PER_POOL = 4096;
+
+// descriptors of each type needed to allocate every set in `layouts` at once
+std::map<vk::DescriptorType, u32> required_descriptors(
+    const std::vector<vk::DescriptorSetLayout>& layouts,
+    const std::vector<u32>& variable_counts
+) {
+    auto& cache = VulkanContext::layout_cache();
+    std::map<vk::DescriptorType, u32> counts{};
+    for (usize i = 0; i < layouts.size(); i++) {
+        const auto key = cache.descriptor_set_layout_key(layouts[i]);
+        for (usize j = 0; j < key.bindings.size(); j++) {
+            const auto& binding = key.bindings[j];
+            // a variable count binding only takes what the allocation asks
+            // for, which is zero when no count is given
+            const bool is_variable = j < key.binding_flags.size()
+                && key.binding_flags[j] & vk::DescriptorBindingFlagBits::eVariableDescriptorCount;
+            if (is_variable) {
+                counts[binding.descriptorType] +=
+                    variable_counts.empty() ? 0 : variable_counts[i];
+            } else {
+                counts[binding.descriptorType] += binding.descriptorCount;
+            }
+        }
+    }
+    return counts;
+}
+
+DescriptorAllocator::DescriptorAllocator(
+    u32 initial_sets,
+    std::vector<DescriptorPoolRatio> ratios,
+    vk::DescriptorPoolCreateFlags flags
+)
+    : _sets_per_pool{std::max(initial_sets, 1u)},
+      _flags{flags},
+      _ratios{std::move(ratios)} {
+    HVK_ASSERT(!_ratios.empty(), "Descriptor allocator requires at least one pool ratio");
+}
+
+vk::DescriptorSet DescriptorAllocator::allocate(vk::DescriptorSetLayout layout) {
+    return allocate(std::vector{layout})[0];
+}
+
+std::vector<vk::DescriptorSet> DescriptorAllocator::allocate(
+    vk::DescriptorSetLayout layout,
+    u32 count
+) {
+    return allocate(std::vector<vk::DescriptorSetLayout>(count, layout));
+}
+
+std::vector<vk::DescriptorSet> DescriptorAllocator::allocate(
+    const std::vector<vk::DescriptorSetLayout>& layouts
+) {
+    return allocate_impl(layouts, {});
+}
+
+vk::DescriptorSet DescriptorAllocator::allocate_variable(
+    vk::DescriptorSetLayout layout,
+    u32 descriptor_count
+) {
+    return allocate_impl({layout}, {descriptor_count})[0];
+}
+
+std::vector<vk::DescriptorSet> DescriptorAllocator::allocate_impl(
+    const std::vector<vk::DescriptorSetLayout>& layouts,
+    const std::vector<u32>& variable_counts
+) {
+    if (layouts.empty()) {
+        return {};
+    }
+
+    const auto& device = VulkanContext::device();
+    const auto count = static_cast<u32>(layouts.size());
+    if (!_current) {
+        _current = next_pool(count);
+    }
+
+    vk::DescriptorSetAllocateInfo alloc_info{};
+    alloc_info.setSetLayouts(layouts);
+    vk::DescriptorSetVariableDescriptorCountAllocateInfo variable_info{variable_counts};
+    if (!variable_counts.empty()) {
+        HVK_ASSERT(
+            variable_counts.size() == layouts.size(),
+            "Variable descriptor counts must be provided for every set"
+        );
+        alloc_info.setPNext(&variable_info);
+    }
+
+    // when the current pool is exhausted it is retired and the batch is
+    // retried, first with recycled pools and finally with a new pool that is
+    // sized to hold the whole batch (both set count and descriptors)
+    bool is_new_pool{};
+    while (true) {
+        alloc_info.setDescriptorPool(_current.get());
+        try {
+            return device.allocateDescriptorSets(alloc_info);
+        } catch (const vk::OutOfPoolMemoryError&) {
+            spdlog::trace("Descriptor pool out of memory, switching pools");
+        } catch (const vk::FragmentedPoolError&) {
+            spdlog::trace("Descriptor pool fragmented, switching pools");
+        }
+
+        HVK_ASSERT(!is_new_pool, "Failed to allocate descriptor sets from a new pool");
+        _full.push_back(std::move(_current));
+        is_new_pool = _ready.empty();
+        _current = is_new_pool ? next_pool(count, required_descriptors(layouts, variable_counts))
+                               : next_pool(count);
+    }
+}
+
+void DescriptorAllocator::reset() {
+    const auto& device = VulkanContext::device();
+    if (_current) {
+        device.resetDescriptorPool(_current.get());
+    }
+    for (auto& pool : _full) {
+        device.resetDescriptorPool(pool.get());
+        _ready.push_back(std::move(pool));
+    }
+    _full.clear();
+}
+
+vk::UniqueDescriptorPool DescriptorAllocator::next_pool(
+    u32 min_sets,
+    const std::map<vk::DescriptorType, u32>& min_descriptors
+) {
+    // reuse a previously reset pool if one is available
+    if (!_ready.empty()) {
+        auto pool = std::move(_ready.back());
+        _ready.pop_back();
+        return pool;
+    }
+
+    auto pool = create_pool(std::max(_sets_per_pool, min_sets), min_descriptors);
+    _sets_per_pool = std::min(_sets_per_pool + _sets_per_pool / 2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+vk::UniqueDescriptorPool DescriptorAllocator::create_pool(
+    u32 set_count,
+    const std::map<vk::DescriptorType, u32>& min_descriptors
+) const {
+    auto counts = min_descriptors;
+    for (const auto& [type, ratio] : _ratios) {
+        auto count = static_cast<u32>(ratio * static_cast<float>(set_count));
+        counts[type] = std::max({counts[type], count, 1u});
+    }
+
+    std::vector<vk::DescriptorPoolSize> sizes{};
+    sizes.reserve(counts.size());
+    for (const auto& [type, count] : counts) {
+        if (count > 0) {
+            sizes.emplace_back(type, count);
+        }
+    }
+
+    spdlog::trace("Creating descriptor pool: max_sets={}", set_count);
+    vk::DescriptorPoolCreateInfo info{};
+    info.setFlags(_flags).setMaxSets(set_count).setPoolSizes(sizes);
+    return VulkanContext::device().createDescriptorPoolUnique(info);
+}
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(
+    const DescriptorSetBindingMap& binding_map,
+    vk::DescriptorSetLayout layout
+) {
+    std::vector<vk::DescriptorUpdateTemplateEntry> entries{};
+    entries.reserve(binding_map.size());
+
+    u32 offset{};
+    for (const auto& [binding, details] : binding_map) {
+        HVK_ASSERT(
+            !(details.binding_flags & vk::DescriptorBindingFlagBits::eVariableDescriptorCount),
+            "Update templates do not support variable descriptor counts"
+        );
+        entries.emplace_back(
+            binding,
+            0,
+            details.count,
+            details.type,
+            offset * sizeof(DescriptorInfo),
+            sizeof(DescriptorInfo)
+        );
+        _offsets[binding] = offset;
+        offset += details.count;
+    }
+    _size = offset;
+
+    vk::DescriptorUpdateTemplateCreateInfo info{};
+    info.setDescriptorUpdateEntries(entries)
+        .setTemplateType(vk::DescriptorUpdateTemplateType::eDescriptorSet)
+        .setDescriptorSetLayout(layout);
+    _template = VulkanContext::device().createDescriptorUpdateTemplateUnique(info);
+}
+
+usize DescriptorUpdateTemplate::size() const noexcept {
+    return _size;
+}
+
+u32 DescriptorUpdateTemplate::offset(u32 binding) const {
+    return _offsets.at(binding);
+}
+
+void DescriptorUpdateTemplate::update(
+    const vk::DescriptorSet& set,
+    const std::vector<DescriptorInfo>& data
+) const {
+    HVK_ASSERT(_template, "Cannot update descriptor set with an empty template");
+    HVK_ASSERT(
+        data.size() == _size,
+        "Template data must contain exactly one element per descriptor"
+    );
+    VulkanContext::device().updateDescriptorSetWithTemplate(set, _template.get(), data.data());
+}
+
 DescriptorSetWriter& DescriptorSetWriter::add_buffer_write(
     const vk::DescriptorSet& set,
     u32 binding,
@@ -69,8 +301,10 @@ DescriptorSetWriter& DescriptorSetWriter::add_buffer_write(
     write.setDstSet(set)
         .setDstBinding(binding)
         .setDescriptorType(details.type)
-        .setBufferInfo(buffer_info);
+        .setDescriptorCount(1);
 
+    _info_refs.push_back({false, _buffer_infos.size()});
+    _buffer_infos.push_back(buffer_info);
     _writes.push_back(write);
     return *this;
 }
@@ -85,8 +319,38 @@ DescriptorSetWriter& DescriptorSetWriter::add_image_write(
     write.setDstSet(set)
         .setDstBinding(binding)
         .setDescriptorType(details.type)
-        .setImageInfo(image_info);
+        .setDescriptorCount(1);
+
+    _info_refs.push_back({true, _image_infos.size()});
+    _image_infos.push_back(image_info);
+    _writes.push_back(write);
+    return *this;
+}
+
+DescriptorSetWriter& DescriptorSetWriter::add_image_array_write(
+    const vk::DescriptorSet& set,
+    u32 binding,
+    const DescriptorDetails& details,
+    const std::vector<vk::DescriptorImageInfo>& image_infos,
+    u32 first_element
+) {
+    HVK_ASSERT(
+        first_element + image_infos.size() <= details.count,
+        "Image array write exceeds the descriptor count of the binding"
+    );
+    if (image_infos.empty()) {
+        return *this;
+    }
+
+    vk::WriteDescriptorSet write{};
+    write.setDstSet(set)
+        .setDstBinding(binding)
+        .setDstArrayElement(first_element)
+        .setDescriptorType(details.type)
+        .setDescriptorCount(static_cast<u32>(image_infos.size()));
 
+    _info_refs.push_back({true, _image_infos.size()});
+    _image_infos.insert(_image_infos.end(), image_infos.begin(), image_infos.end());
     _writes.push_back(write);
     return *this;
 }
@@ -94,16 +358,15 @@ DescriptorSetWriter& DescriptorSetWriter::add_image_write(
 DescriptorSetWriter& DescriptorSetWriter::write_buffers(
     const vk::DescriptorSet& set,
     const DescriptorSetBindingMap& binding_map,
-    vk::DescriptorBufferInfo buffer_infos
+    const vk::DescriptorBufferInfo& buffer_info
 ) {
-    auto infos = std::vector<vk::DescriptorBufferInfo>{buffer_infos};
-    return write_buffers(set, binding_map, infos);
+    return write_buffers(set, binding_map, std::vector{buffer_info});
 }
 
 DescriptorSetWriter& DescriptorSetWriter::write_buffers(
     const vk::DescriptorSet& set,
     const DescriptorSetBindingMap& binding_map,
-    std::vector<vk::DescriptorBufferInfo> buffer_infos
+    const std::vector<vk::DescriptorBufferInfo>& buffer_infos
 ) {
     HVK_ASSERT(
         binding_map.size() == buffer_infos.size(),
@@ -112,44 +375,62 @@ DescriptorSetWriter& DescriptorSetWriter::write_buffers(
     for (u32 i = 0; i < buffer_infos.size(); i++) {
         add_buffer_write(set, i, binding_map.at(i), buffer_infos[i]);
     }
-
-    this->update();
     return *this;
 }
 
 DescriptorSetWriter& DescriptorSetWriter::write_images(
     const vk::DescriptorSet& set,
     const DescriptorSetBindingMap& binding_map,
-    vk::DescriptorImageInfo image_infos
+    const vk::DescriptorImageInfo& image_info
 ) {
-    auto infos = std::vector<vk::DescriptorImageInfo>{image_infos};
-    return write_images(set, binding_map, infos);
+    return write_images(set, binding_map, std::vector{image_info});
 }
 
 DescriptorSetWriter& DescriptorSetWriter::write_images(
     const vk::DescriptorSet& set,
     const DescriptorSetBindingMap& binding_map,
-    std::vector<vk::DescriptorImageInfo> image_infos
+    const std::vector<vk::DescriptorImageInfo>& image_infos
 ) {
     HVK_ASSERT(
         binding_map.size() == image_infos.size(),
-        "Number of buffers must be equal to number of mapped bindings"
+        "Number of images must be equal to number of mapped bindings"
     );
     for (u32 i = 0; i < image_infos.size(); i++) {
         add_image_write(set, i, binding_map.at(i), image_infos[i]);
     }
-
-    this->update();
     return *this;
 }
 
+void DescriptorSetWriter::reserve(usize write_count) {
+    _writes.reserve(write_count);
+    _info_refs.reserve(write_count);
+}
+
+usize DescriptorSetWriter::size() const noexcept {
+    return _writes.size();
+}
+
 void DescriptorSetWriter::update() {
-    HVK_ASSERT(
-        !_writes.empty(),
-        "Cannot update descriptor sets without anything to write or copy"
-    );
+    if (_writes.empty()) {
+        return;
+    }
+
+    // info vectors may have reallocated while writes were added, so pointers
+    // are only resolved right before submitting
+    for (usize i = 0; i < _writes.size(); i++) {
+        const auto& ref = _info_refs[i];
+        if (ref.is_image) {
+            _writes[i].setPImageInfo(&_image_infos[ref.offset]);
+        } else {
+            _writes[i].setPBufferInfo(&_buffer_infos[ref.offset]);
+        }
+    }
     VulkanContext::device().updateDescriptorSets(_writes, nullptr);
-    *this = {};
+
+    _writes.clear();
+    _info_refs.clear();
+    _image_infos.clear();
+    _buffer_infos.clear();
 }
 
 }  // namespace hvk
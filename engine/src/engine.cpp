@@ -1,3 +1,5 @@
+#include <algorithm>
+
 // vulkan needs to be included before glfw
 #include "hvk/engine.hpp"
 #include <GLFW/glfw3.h>
@@ -11,6 +13,27 @@
 
 namespace hvk {
 
+// size of each frame's transient uniform memory
+inline constexpr vk::DeviceSize FRAME_UNIFORM_CAPACITY = 256 * 1024;
+// number of entries in each frame's object storage buffer
+inline constexpr usize MAX_OBJECTS = 10000;
+// number of entries in each frame's draw storage buffer
+inline constexpr usize MAX_DRAWS = 16384;
+// upper bound on the bindless texture array, clamped to device limits
+inline constexpr u32 MAX_BINDLESS_TEXTURES = 4096;
+
+// pipeline indices in the order they are created in `create_pipelines`, the
+// textured variants follow the order of `RenderQueueType`
+inline constexpr usize PIPELINE_TEXTURED = 0;
+inline constexpr usize PIPELINE_TEXTURED_ALPHA_TEST = 1;
+inline constexpr usize PIPELINE_TEXTURED_TRANSPARENT = 2;
+inline constexpr usize PIPELINE_DEBUG = 3;
+inline constexpr usize PIPELINE_WIREFRAME = 4;
+inline constexpr usize PIPELINE_DEPTH_PREPASS = 5;
+inline constexpr usize PIPELINE_TEXTURED_DEPTH_EQUAL = 6;
+// fragment shader specialization constant toggling the alpha test discard
+inline constexpr u32 SPEC_ALPHA_TEST = 0;
+
 std::vector<const char*> get_extensions() {
     u32 count{};
     auto* glfw_ext = glfwGetRequiredInstanceExtensions(&count);
@@ -81,72 +104,69 @@ void Engine::init() {
 void Engine::run() {
     spdlog::info("Entering main application loop");
 
-    _timer.reset();
-    while (!glfwWindowShouldClose(_window.handle)) {
-        glfwPollEvents();
-        update(_timer.tick());
-        render();
+    switch (_update_mode) {
+        case UpdateMode::Sequential:
+            run_sequential();
+            break;
+        case UpdateMode::Pipelined:
+            run_pipelined();
+            break;
     }
 
     VulkanContext::device().waitIdle();
 }
 
 void Engine::update(double dt) {
-    if (!_is_init || !_focused) {
+    auto input = take_input();
+    if (!_is_init || !input.focused) {
         return;
     }
 
-    update_ui();
+    if (input.aspect > 0.0f) {
+        _camera.set_aspect(input.aspect);
+    }
+    if (input.reset_camera) {
+        _camera.reset();
+    }
 
     // handle keyboard controls
-    auto w = glfwGetKey(_window.handle, GLFW_KEY_W) == GLFW_PRESS;
-    auto a = glfwGetKey(_window.handle, GLFW_KEY_A) == GLFW_PRESS;
-    auto s = glfwGetKey(_window.handle, GLFW_KEY_S) == GLFW_PRESS;
-    auto d = glfwGetKey(_window.handle, GLFW_KEY_D) == GLFW_PRESS;
-    auto alt = glfwGetKey(_window.handle, GLFW_KEY_LEFT_ALT) == GLFW_PRESS;
-    auto space = glfwGetKey(_window.handle, GLFW_KEY_SPACE) == GLFW_PRESS;
-    auto shift = glfwGetKey(_window.handle, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
-
-    if (shift) {
-        _camera.set_sprint(true);
-    } else {
-        _camera.set_sprint(false);
-    }
-    if (w) {
+    _camera.set_sprint(input.sprint);
+    if (input.forward) {
         _camera.translate(CameraDirection::Forward, dt);
     }
-    if (a) {
+    if (input.left) {
         _camera.translate(CameraDirection::Left, dt);
     }
-    if (s) {
+    if (input.backward) {
         _camera.translate(CameraDirection::Backward, dt);
     }
-    if (d) {
+    if (input.right) {
         _camera.translate(CameraDirection::Right, dt);
     }
-    if (alt) {
+    if (input.down) {
         _camera.translate(CameraDirection::Down, dt);
     }
-    if (space) {
+    if (input.up) {
         _camera.translate(CameraDirection::Up, dt);
     }
 
-    // update mouse state
-    glm::dvec2 pos{};
-    glfwGetCursorPos(_window.handle, &pos.x, &pos.y);
-    if (pos != _cursor) {
-        on_mouse_move(pos);
+    // handle mouse controls
+    if (input.look != glm::dvec2{}) {
+        _camera.rotate(input.look.x, input.look.y);
+    }
+    if (input.zoom != 0.0) {
+        auto direction = input.zoom > 0.0 ? ZoomDirection::In : ZoomDirection::Out;
+        _camera.zoom(direction, dt);
     }
 
     // DEBUG: rotate some meshes
     auto t = static_cast<float>(dt);
-    auto& models = _scene.models();
-    for (u32 i = 1; i < models.size(); i++) {
-        models[i].rotate({-t, t, 0.0f});
+    for (usize i = 1; i < _transforms.size(); i++) {
+        _transforms[i].rotation += glm::vec3{-t, t, 0.0f};
     }
 }
 
-void Engine::render() {
+void Engine::render(const RenderSnapshot& snapshot) {
     // aliases to make code below a bit more readable
     const auto& device = VulkanContext::device();
     const auto& swapchain = VulkanContext::swapchain();
@@ -156,12 +176,13 @@ void Engine::render() {
     const auto& render_fence = frame.render_fence;
     const auto& render_semaphore = frame.render_semaphore;
     const auto& present_semaphore = frame.present_semaphore;
-    const auto& pipeline = _pipelines.pipelines[_pipeline_idx];
 
     if (device.waitForFences(render_fence.get(), VK_TRUE, SYNC_TIMEOUT) != vk::Result::eSuccess) {
         panic("Failed to wait for render fence");
     }
 
+    _streamer.update(_scene, snapshot, swapchain.extent);
+
     auto next = device.acquireNextImageKHR(
         swapchain.handle.get(),
         SYNC_TIMEOUT,
@@ -182,6 +203,25 @@ void Engine::render() {
     cmd->reset();
     cmd->begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 
+    // the feedback of the last submission of this frame is complete (its fence
+    // was waited on above), pages are copied before the render pass samples them
+    if (_virtual_textures) {
+        _virtual_textures->update(_frame_idx, cmd.get());
+    }
+    // textures are relocated by defragmentation passes spread out over the
+    // session, so that it never leaves the texture pool fragmented
+    invalidate_texture_descriptors(
+        ResourceManager::defragment_textures(cmd.get(), _frame_count, _max_frames_in_flight)
+    );
+    // streamed levels are uploaded the same way, replacing texture images
+    invalidate_texture_descriptors(_streamer.apply(cmd.get(), _frame_count));
+    // the sets of this frame are not in use (its fence was waited on above),
+    // other frames catch up once they are recorded again
+    if (!frame.stale_textures.empty()) {
+        write_texture_descriptors(_frame_idx, &frame.stale_textures);
+        frame.stale_textures.clear();
+    }
+
     vk::ClearValue color_clear{vk::ClearColorValue{0.1f, 0.1f, 0.1f, 1.0f}};
     vk::ClearValue depth_clear{vk::ClearDepthStencilValue{1.0f}};
     std::vector<vk::ClearValue> clear{color_clear, depth_clear};
@@ -193,60 +233,136 @@ void Engine::render() {
         clear,
     };
 
+    // per-frame uniforms are pushed into the frame's linear allocator and
+    // bound with dynamic offsets, the memory is recycled once the fence for
+    // this frame has signaled (waited on above)
+    frame.uniforms.reset();
+    auto camera = frame.uniforms.push(snapshot.camera);
+    auto scene = frame.uniforms.push(snapshot.scene);
+    std::array<u32, 2> dyn_offsets{camera.offset, scene.offset};
+
     cmd->beginRenderPass(rpinfo, vk::SubpassContents::eInline);
-    cmd->bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline.get());
+
+    // flipped viewport so that +y is up in clip space
+    vk::Viewport viewport{
+        0.0f,
+        static_cast<float>(swapchain.extent.height),
+        static_cast<float>(swapchain.extent.width),
+        -static_cast<float>(swapchain.extent.height),
+        0.0f,
+        1.0f,
+    };
+    cmd->setViewport(0, viewport);
+    cmd->setScissor(0, vk::Rect2D{{0, 0}, swapchain.extent});
 
     // bind descriptor sets
     cmd->bindDescriptorSets(
         vk::PipelineBindPoint::eGraphics,
-        _pipelines.layout.get(),
+        _pipelines.layout,
         0,
         frame.descriptor,
-        _scene_ubo.dyn_offset(_frame_idx)
+        dyn_offsets
     );
     cmd->bindDescriptorSets(
         vk::PipelineBindPoint::eGraphics,
-        _pipelines.layout.get(),
+        _pipelines.layout,
         1,
-        _texture_set,
+        frame.texture_set,
         nullptr
     );
 
-    auto camera = _camera.data();
-    frame.camera_ubo.update(&camera);
-
     Material* current_material{};
+    vk::Pipeline current_pipeline{};
+
+    // object transforms are uploaded once per frame, each draw selects its
+    // entry in the draw buffer (object and material) through `firstInstance`
+    // (gl_InstanceIndex in the shaders)
+    const auto& models = _scene.models();
+    HVK_ASSERT(
+        snapshot.objects.size() == models.size(),
+        "Render snapshot must contain object data for every model"
+    );
+    HVK_ASSERT(snapshot.objects.size() <= MAX_OBJECTS, "Scene exceeds maximum object count");
+    std::memcpy(
+        frame.objects.mapped_data(),
+        snapshot.objects.data(),
+        snapshot.objects.size() * sizeof(ObjectData)
+    );
 
-    for (const auto& model : _scene.models()) {
-        auto model_matrix = model.transform();
-        auto constants = PushConstants{
-            model_matrix,
-            glm::transpose(glm::inverse(model_matrix)),
-        };
-        cmd->pushConstants(
-            _pipelines.layout.get(),
-            vk::ShaderStageFlagBits::eVertex,
-            0,
-            sizeof(PushConstants),
-            &constants
-        );
-        for (const auto& node : model.nodes()) {
-            if (current_material != node.material) {
+    // opaque front-to-back, then alpha-tested, then transparent back-to-front
+    _render_queues.update(_scene, snapshot);
+
+    // draw entries are written up front so the depth pre-pass and the main
+    // pass select the same entries with the same `firstInstance`
+    auto* draws = static_cast<DrawData*>(frame.draws.mapped_data());
+    u32 draw_idx{};
+    for (const auto& queue : _render_queues.queues()) {
+        for (const auto& item : queue.items()) {
+            HVK_ASSERT(draw_idx < MAX_DRAWS, "Scene exceeds maximum draw count");
+            const auto& node = models[item.model].nodes()[item.node];
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            draws[draw_idx++] = {item.model, node.material->index};
+        }
+    }
+
+    // lay down depth for opaque geometry with positions only, so the main
+    // pass shades each pixel once. alpha-tested geometry needs its texture to
+    // resolve coverage and is left to the main pass. the pre-pass pipeline
+    // has a different vertex layout, so it cannot use the fallback pipeline.
+    const auto& prepass_pipeline = _pipelines.pipelines[PIPELINE_DEPTH_PREPASS];
+    const bool prepass = _depth_prepass && prepass_pipeline.ready();
+    draw_idx = 0;
+    if (prepass) {
+        cmd->bindPipeline(vk::PipelineBindPoint::eGraphics, prepass_pipeline.wait());
+        for (const auto& item : _render_queues.queue(RenderQueueType::Opaque).items()) {
+            const auto& model = models[item.model];
+            model.draw_node_positions(model.nodes()[item.node], cmd, draw_idx++);
+        }
+    }
+
+    draw_idx = 0;
+    for (usize q = 0; q < RENDER_QUEUE_COUNT; q++) {
+        // only materials with alpha pay for the discard or blending, the
+        // debug views draw everything with the same pipeline
+        auto pipeline_idx = _pipeline_idx;
+        if (pipeline_idx == PIPELINE_TEXTURED) {
+            pipeline_idx += q;
+            if (prepass && q == static_cast<usize>(RenderQueueType::Opaque)) {
+                pipeline_idx = PIPELINE_TEXTURED_DEPTH_EQUAL;
+            }
+        }
+        const auto pipeline = _pipelines.pipelines[pipeline_idx].get_or(_fallback_pipeline);
+        if (current_pipeline != pipeline) {
+            cmd->bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+            current_pipeline = pipeline;
+        }
+
+        for (const auto& item : _render_queues.queues()[q].items()) {
+            const auto& model = models[item.model];
+            const auto& node = model.nodes()[item.node];
+
+            // with bindless textures the material is selected in the shader,
+            // so there is nothing to rebind between draws
+            if (!_bindless && current_material != node.material) {
                 cmd->bindDescriptorSets(
                     vk::PipelineBindPoint::eGraphics,
-                    _pipelines.layout.get(),
+                    _pipelines.layout,
                     1,
-                    node.material->descriptor_set,
+                    node.material->descriptor_sets[_frame_idx],
                     nullptr
                 );
+                current_material = node.material;
             }
-            model.draw_node(node, cmd);
+            model.draw_node(node, cmd, draw_idx++);
         }
     }
 
     _ui.draw(cmd);
 
     cmd->endRenderPass();
+    if (_virtual_textures) {
+        VirtualTextureCache::record_feedback_barrier(cmd.get());
+    }
     cmd->end();
 
     vk::PipelineStageFlags mask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
@@ -268,6 +384,10 @@ void Engine::render() {
 void Engine::cleanup() {  // NOLINT(readability-make-member-function-const)
     spdlog::info("Shutdown requested, cleaning up");
 
+    // persist compiled pipelines so the next launch can skip most of the
+    // shader compilation
+    VulkanContext::save_pipeline_cache();
+
     // vulkan resource cleanup is handled by vulkan-hpp,
     // destructors are called in reverse order of declaration
 
@@ -280,7 +400,30 @@ void Engine::cleanup() {  // NOLINT(readability-make-member-function-const)
 }
 
 void Engine::cycle_pipeline() {
-    _pipeline_idx = (_pipeline_idx + 1) % _pipelines.pipelines.size();
+    // the alpha-tested variant is selected per material, never cycled to
+    switch (_pipeline_idx) {
+        case PIPELINE_TEXTURED:
+            _pipeline_idx = PIPELINE_DEBUG;
+            break;
+        case PIPELINE_DEBUG:
+            _pipeline_idx = PIPELINE_WIREFRAME;
+            break;
+        default:
+            _pipeline_idx = PIPELINE_TEXTURED;
+    }
+}
+
+void Engine::toggle_depth_prepass() {
+    _depth_prepass = !_depth_prepass;
+    if (_depth_prepass && !_position_streams) {
+        // models are only read while frames are recorded, which happens on
+        // this thread as well
+        for (auto& model : _scene.models()) {
+            model.upload_positions(VulkanContext::transfer_queue(), _upload_ctx);
+        }
+        _position_streams = true;
+    }
+    spdlog::info("Depth pre-pass {}", _depth_prepass ? "enabled" : "disabled");
 }
 
 void Engine::toggle_fullscreen() {
@@ -364,8 +507,8 @@ void Engine::on_scroll(double dx, double dy) {
         return;
     }
 
-    auto direction = dy > 0.0 ? ZoomDirection::In : ZoomDirection::Out;
-    _camera.zoom(direction, _timer.elapsed_secs());
+    std::lock_guard lock{_input_mutex};
+    _input.zoom += dy;
 }
 
 void Engine::on_key_press(i32 keycode, i32 mods) {
@@ -387,9 +530,14 @@ void Engine::on_key_press(i32 keycode, i32 mods) {
         case GLFW_KEY_C:
             cycle_pipeline();
             break;
-        case GLFW_KEY_R:
-            _camera.reset();
+        case GLFW_KEY_P:
+            toggle_depth_prepass();
             break;
+        case GLFW_KEY_R: {
+            std::lock_guard lock{_input_mutex};
+            _input.reset_camera = true;
+            break;
+        }
         default:
             break;
     }
@@ -412,7 +560,100 @@ void Engine::on_mouse_move(glm::dvec2 pos) {
         _ui.on_mouse_move(static_cast<glm::vec2>(pos));
         return;
     }
-    _camera.rotate(dx, dy);
+
+    std::lock_guard lock{_input_mutex};
+    _input.look += glm::dvec2{dx, dy};
+}
+
+void Engine::run_sequential() {
+    _timer.reset();
+    while (!glfwWindowShouldClose(_window.handle)) {
+        glfwPollEvents();
+        poll_input();
+        step_simulation(_timer.tick());
+        render_next();
+    }
+}
+
+void Engine::run_pipelined() {
+    // the simulation thread only ever touches the camera, scene transforms
+    // and the snapshot it is writing. the main thread keeps ownership of
+    // the window, UI and all command recording/submission.
+    spdlog::debug("Starting simulation thread");
+    _sim_thread = std::thread{[this]() {
+        Timer timer{};
+        while (step_simulation(timer.tick())) {}
+        spdlog::debug("Simulation thread finished");
+    }};
+
+    while (!glfwWindowShouldClose(_window.handle)) {
+        glfwPollEvents();
+        poll_input();
+        if (!render_next()) {
+            break;
+        }
+    }
+
+    _snapshots.close();
+    _sim_thread.join();
+}
+
+void Engine::poll_input() {
+    glm::dvec2 pos{};
+    glfwGetCursorPos(_window.handle, &pos.x, &pos.y);
+    if (pos != _cursor) {
+        on_mouse_move(pos);
+    }
+
+    auto is_down = [this](i32 key) { return glfwGetKey(_window.handle, key) == GLFW_PRESS; };
+
+    std::lock_guard lock{_input_mutex};
+    _input.focused = _focused;
+    _input.forward = is_down(GLFW_KEY_W);
+    _input.left = is_down(GLFW_KEY_A);
+    _input.backward = is_down(GLFW_KEY_S);
+    _input.right = is_down(GLFW_KEY_D);
+    _input.down = is_down(GLFW_KEY_LEFT_ALT);
+    _input.up = is_down(GLFW_KEY_SPACE);
+    _input.sprint = is_down(GLFW_KEY_LEFT_SHIFT);
+    _input.aspect = VulkanContext::aspect();
+}
+
+InputState Engine::take_input() {
+    std::lock_guard lock{_input_mutex};
+    auto input = _input;
+    _input.look = {};
+    _input.zoom = 0.0;
+    _input.reset_camera = false;
+    return input;
+}
+
+bool Engine::step_simulation(double dt) {
+    update(dt);
+    write_snapshot(_snapshots.back());
+    return _snapshots.publish();
+}
+
+bool Engine::render_next() {
+    update_ui();
+
+    const auto* snapshot = _snapshots.acquire();
+    if (!snapshot) {
+        return false;
+    }
+    render(*snapshot);
+    _snapshots.release();
+    return true;
+}
+
+void Engine::write_snapshot(RenderSnapshot& snapshot) const {
+    snapshot.camera = _camera.data();
+    snapshot.scene = _scene.data();
+
+    snapshot.objects.resize(_transforms.size());
+    for (usize i = 0; i < _transforms.size(); i++) {
+        snapshot.objects[i] = ObjectData::from_matrix(_transforms[i].matrix());
+    }
 }
 
 void Engine::init_glfw() {
@@ -470,17 +711,38 @@ void Engine::init_vulkan() {
     // lot of things much simpler, such as allocating buffers and images (which
     // require references to the device, queues, commands, and so on.)
     VulkanContext::init(_window.handle, info, get_extensions());
+    _bindless = VulkanContext::supports_bindless();
+    // fragment shaders report the pages they sample, materials find their
+    // virtual texture through the bindless material buffer
+    _virtual_texturing = _bindless && VulkanContext::supports_fragment_stores();
     spdlog::trace("Creating upload context");
     _upload_ctx = UploadContext{VulkanContext::queue_families().transfer};
 
+    // decode textures on the workers, compressing them into BC formats on
+    // first load (cached on disk)
+    ResourceManager::set_texture_compression(true);
+    ResourceManager::set_texture_pool(&_workers);
+    // only the mip tails are uploaded up front, sharper levels are streamed
+    // in by on-screen size (see `render`)
+    _streamer.set_pool(&_workers);
+    ResourceManager::set_texture_streamer(&_streamer);
+    if (_virtual_texturing) {
+        // very large textures are paged through a fixed size cache instead
+        _virtual_textures = std::make_unique<VirtualTextureCache>(_max_frames_in_flight);
+        ResourceManager::set_virtual_textures(_virtual_textures.get());
+    }
+
     // load shaders
     std::vector<std::pair<std::string_view, ShaderType>> shaders{
         {"shaders/mesh.vert.spv", ShaderType::Vertex},
         {"shaders/mesh.vert.spv", ShaderType::Vertex},
         {"shaders/mesh.frag.spv", ShaderType::Fragment},
+        {"shaders/depth_only.vert.spv", ShaderType::Vertex},
         {"shaders/wireframe.frag.spv", ShaderType::Fragment},
         {"shaders/textured_lit.vert.spv", ShaderType::Vertex},
         {"shaders/textured_lit.frag.spv", ShaderType::Fragment},
+        {"shaders/textured_lit_bindless.frag.spv", ShaderType::Fragment},
+        {"shaders/textured_lit_virtual.frag.spv", ShaderType::Fragment},
         {"shaders/ui.vert.spv", ShaderType::Vertex},
         {"shaders/ui.frag.spv", ShaderType::Fragment},
     };
@@ -505,28 +767,27 @@ void Engine::init_vulkan() {
 
 void Engine::create_buffers() {
     for (auto& frame : _frames) {
-        frame.camera_ubo = Buffer{sizeof(CameraData), vk::BufferUsageFlagBits::eUniformBuffer};
-    }
-
-    auto ubo_alignment = Buffer::pad_alignment(sizeof(SceneData));
-    auto size = ubo_alignment * _max_frames_in_flight;
-    _scene_ubo = Buffer{sizeof(SceneData), size, vk::BufferUsageFlagBits::eUniformBuffer};
-    for (u32 i = 0; i < _max_frames_in_flight; i++) {
-        auto data = _scene.data();
-        _scene_ubo.update_indexed(&data, i);
+        frame.uniforms = FrameAllocator{
+            FRAME_UNIFORM_CAPACITY,
+            vk::BufferUsageFlagBits::eUniformBuffer,
+        };
+        frame.objects = Buffer{
+            MAX_OBJECTS * sizeof(ObjectData),
+            vk::BufferUsageFlagBits::eStorageBuffer,
+        };
+        frame.draws = Buffer{
+            MAX_DRAWS * sizeof(DrawData),
+            vk::BufferUsageFlagBits::eStorageBuffer,
+        };
     }
 }
 
 void Engine::create_scene() {
-    {
-        const auto* tex = ResourceManager::create_texture(
-            {"uv-test", vk::Filter::eLinear, vk::SamplerAddressMode::eRepeat},
-            "assets/uv-test.png"
-        );
-
-        DescriptorSetWriter writer{};
-        writer.write_images(_texture_set, _texture_bindings, {tex->descriptor_info()});
-    }
+    // textures decode on the workers while the rest of the scene is built
+    _uv_test = ResourceManager::load_texture(
+        {"uv-test", vk::Filter::eLinear, vk::SamplerAddressMode::eRepeat},
+        "assets/uv-test.png"
+    );
     {
         auto model = Model::load_obj("assets/sponza.obj");
         model.set_translation({0.0f, -2.0f, 0.0f});
@@ -564,10 +825,53 @@ void Engine::create_scene() {
         }
     }
 
-    ResourceManager::prepare_materials(_desc_pool, _texture_set_layout, _texture_bindings);
+    ResourceManager::upload_pending_textures();
+    if (_bindless) {
+        // a single set per frame holds every texture, sized to what was
+        // actually loaded
+        for (auto& frame : _frames) {
+            frame.texture_set = _bindless_descriptors.allocate_variable(
+                _texture_set_layout,
+                ResourceManager::texture_count()
+            );
+        }
+        _material_buffer = Buffer{
+            std::max(ResourceManager::material_count(), 1u) * sizeof(MaterialData),
+            vk::BufferUsageFlagBits::eStorageBuffer,
+        };
+        ResourceManager::prepare_bindless_materials(_material_buffer);
+    } else {
+        ResourceManager::allocate_material_descriptors(
+            _descriptors,
+            _texture_set_layout,
+            static_cast<u32>(_frames.size())
+        );
+    }
+    for (usize i = 0; i < _frames.size(); i++) {
+        write_texture_descriptors(i);
+    }
 
+    // nothing reads the geometry on the CPU, so only the device copy is kept
+    MeshMemory geometry{};
     for (auto& model : _scene.models()) {
-        model.upload(VulkanContext::transfer_queue(), _upload_ctx);
+        // the position-only streams are only needed by the depth pre-pass,
+        // they are created when it is first enabled otherwise
+        model.upload(VulkanContext::transfer_queue(), _upload_ctx, _depth_prepass);
+        const auto memory = model.memory();
+        geometry.device += memory.device;
+        geometry.host += memory.host;
+    }
+    constexpr double mib = 1024.0 * 1024.0;
+    spdlog::debug(
+        "Uploaded {} models: {:.1f} MiB of geometry on the device, {:.1f} MiB in system memory",
+        _scene.models().size(),
+        static_cast<double>(geometry.device) / mib,
+        static_cast<double>(geometry.host) / mib
+    );
+
+    _position_streams = _depth_prepass;
+    for (const auto& model : _scene.models()) {
+        _transforms.push_back(model.local_transform());
     }
 }
 
@@ -688,46 +992,101 @@ void Engine::create_framebuffers() {
 }
 
 void Engine::init_descriptors() {
-    const auto& device = VulkanContext::device();
-
-    std::vector<vk::DescriptorPoolSize> pool_sizes{
-        {vk::DescriptorType::eUniformBuffer, 10},
-        {vk::DescriptorType::eUniformBufferDynamic, 10},
-        {vk::DescriptorType::eCombinedImageSampler, 10},
+    // ratios are descriptors per set, pools grow as more sets are allocated
+    std::vector<DescriptorPoolRatio> ratios{
+        {vk::DescriptorType::eUniformBufferDynamic, 2.0f},
+        {vk::DescriptorType::eStorageBuffer, 2.0f},
+        {vk::DescriptorType::eCombinedImageSampler, 1.0f},
     };
-    vk::DescriptorPoolCreateInfo pool_info{};
-    // TODO(bwpge): properly calculate max sets
-    pool_info.setMaxSets(1000).setPoolSizes(pool_sizes);
-    _desc_pool = device.createDescriptorPoolUnique(pool_info);
+    _descriptors = DescriptorAllocator{64, ratios};
 
     _frame_bindings = DescriptorSetBindingMap{
-        {vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eVertex},
+        {vk::DescriptorType::eUniformBufferDynamic, vk::ShaderStageFlagBits::eVertex},
         {vk::DescriptorType::eUniformBufferDynamic,
          vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment},
+        {vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eVertex},
+        {vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eVertex},
     };
-    _texture_bindings = DescriptorSetBindingMap{
-        {vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment},
-    };
+    if (_virtual_texturing) {
+        // page feedback, virtual texture sizes, page cache and page tables
+        const auto stage = vk::ShaderStageFlagBits::eFragment;
+        _frame_bindings.push_back({vk::DescriptorType::eStorageBuffer, stage});
+        _frame_bindings.push_back({vk::DescriptorType::eStorageBuffer, stage});
+        _frame_bindings.push_back({vk::DescriptorType::eCombinedImageSampler, stage});
+        _frame_bindings.push_back({vk::DescriptorType::eCombinedImageSampler, stage});
+    }
+
+    if (_bindless) {
+        // materials index into one runtime sized texture array, the sets are
+        // allocated once all textures are known (see `create_scene`)
+        const auto& limits = VulkanContext::limits();
+        u32 capacity = std::min({
+            MAX_BINDLESS_TEXTURES,
+            limits.maxPerStageDescriptorSamplers,
+            limits.maxPerStageDescriptorSampledImages,
+        });
+        _texture_bindings = DescriptorSetBindingMap{
+            {vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eFragment},
+            {
+                vk::DescriptorType::eCombinedImageSampler,
+                vk::ShaderStageFlagBits::eFragment,
+                capacity,
+                vk::DescriptorBindingFlagBits::ePartiallyBound
+                    | vk::DescriptorBindingFlagBits::eVariableDescriptorCount,
+            },
+        };
+        const auto frames = static_cast<u32>(_frames.size());
+        _bindless_descriptors = DescriptorAllocator{
+            frames,
+            {
+                {vk::DescriptorType::eStorageBuffer, 1.0f},
+                {vk::DescriptorType::eCombinedImageSampler, static_cast<float>(capacity)},
+            },
+        };
+    } else {
+        _texture_bindings = DescriptorSetBindingMap{
+            {vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment},
+        };
+    }
 
     _global_desc_set_layout = _frame_bindings.build_layout();
     _texture_set_layout = _texture_bindings.build_layout();
-    _texture_set = VulkanContext::allocate_descriptor_set(_desc_pool, _texture_set_layout);
+    if (!_bindless) {
+        auto texture_sets = _descriptors.allocate(
+            _texture_set_layout,
+            static_cast<u32>(_frames.size())
+        );
+        for (usize i = 0; i < _frames.size(); i++) {
+            _frames[i].texture_set = texture_sets[i];
+        }
+    }
 
-    for (auto& frame : _frames) {
-        // allocate the descriptor sets
-        frame.descriptor =
-            VulkanContext::allocate_descriptor_set(_desc_pool, _global_desc_set_layout);
+    auto frame_sets = _descriptors.allocate(
+        _global_desc_set_layout,
+        static_cast<u32>(_frames.size())
+    );
+    // every frame set has the same layout, so they are written through one
+    // update template instead of building individual writes
+    auto frame_template = _frame_bindings.build_update_template(_global_desc_set_layout);
+    std::vector<DescriptorInfo> data(frame_template.size());
+    for (usize i = 0; i < _frames.size(); i++) {
+        auto& frame = _frames[i];
+        frame.descriptor = frame_sets[i];
 
         // write the appropriate descriptors
-        DescriptorSetWriter writer{};
-        writer.write_buffers(
-            frame.descriptor,
-            _frame_bindings,
-            {
-                frame.camera_ubo.descriptor_buffer_info(),
-                _scene_ubo.descriptor_buffer_info(),
-            }
-        );
+        data[frame_template.offset(0)].buffer =
+            frame.uniforms.descriptor_buffer_info(sizeof(CameraData));
+        data[frame_template.offset(1)].buffer =
+            frame.uniforms.descriptor_buffer_info(sizeof(SceneData));
+        data[frame_template.offset(2)].buffer = frame.objects.descriptor_buffer_info();
+        data[frame_template.offset(3)].buffer = frame.draws.descriptor_buffer_info();
+        if (_virtual_texturing) {
+            data[frame_template.offset(4)].buffer = _virtual_textures->feedback_info(i);
+            data[frame_template.offset(5)].buffer = _virtual_textures->texture_info();
+            data[frame_template.offset(6)].image = _virtual_textures->cache_info();
+            data[frame_template.offset(7)].image = _virtual_textures->page_table_info();
+        }
+        frame_template.update(frame.descriptor, data);
     }
 }
 
@@ -746,35 +1105,54 @@ void Engine::create_sync_obj() {
 
 void Engine::create_pipelines() {
     spdlog::trace("Creating graphics pipelines");
-    const auto& swapchain = VulkanContext::swapchain();
 
-    // hardcoded push constants for matrices
-    vk::PushConstantRange push_constant{};
-    push_constant.setOffset(0)
-        .setSize(sizeof(PushConstants))
-        .setStageFlags(vk::ShaderStageFlagBits::eVertex);
+    const auto* textured_frag = _bindless ? "textured_lit_bindless" : "textured_lit";
+    if (_virtual_texturing) {
+        textured_frag = "textured_lit_virtual";
+    }
 
     PipelineBuilder builder{};
-    _pipelines =
-        builder.add_push_constant(push_constant)
-            .add_descriptor_set_layout(_global_desc_set_layout)
+    builder.add_descriptor_set_layout(_global_desc_set_layout)
             .add_descriptor_set_layout(_texture_set_layout)
-            // textured pipeline
+            // textured pipeline, opaque variant without discard so the
+            // driver can keep early depth testing enabled
             .new_pipeline()
             .add_vertex_shader(ResourceManager::vertex_shader("textured_lit"))
-            .add_fragment_shader(ResourceManager::fragment_shader("textured_lit"))
+            .add_fragment_shader(ResourceManager::fragment_shader(textured_frag))
+            .add_specialization_constant(vk::ShaderStageFlagBits::eFragment, SPEC_ALPHA_TEST, 0)
             .add_vertex_binding_description(Vertex::binding_desc())
             .add_vertex_attr_description(Vertex::attr_desc())
-            .with_default_color_blend_transparency()
-            .with_flipped_viewport(swapchain.extent)
+            .with_default_color_blend_opaque()
+            .with_dynamic_viewport()
+            .with_depth_stencil(true, true, vk::CompareOp::eLessOrEqual)
+            // textured pipeline, alpha-tested variant
+            .new_pipeline()
+            .add_vertex_shader(ResourceManager::vertex_shader("textured_lit"))
+            .add_fragment_shader(ResourceManager::fragment_shader(textured_frag))
+            .add_specialization_constant(vk::ShaderStageFlagBits::eFragment, SPEC_ALPHA_TEST, 1)
+            .add_vertex_binding_description(Vertex::binding_desc())
+            .add_vertex_attr_description(Vertex::attr_desc())
+            .with_default_color_blend_opaque()
+            .with_dynamic_viewport()
             .with_depth_stencil(true, true, vk::CompareOp::eLessOrEqual)
+            // textured pipeline, transparent variant. drawn last and sorted
+            // back-to-front, so it tests against but never writes depth
+            .new_pipeline()
+            .add_vertex_shader(ResourceManager::vertex_shader("textured_lit"))
+            .add_fragment_shader(ResourceManager::fragment_shader(textured_frag))
+            .add_specialization_constant(vk::ShaderStageFlagBits::eFragment, SPEC_ALPHA_TEST, 1)
+            .add_vertex_binding_description(Vertex::binding_desc())
+            .add_vertex_attr_description(Vertex::attr_desc())
+            .with_default_color_blend_transparency()
+            .with_dynamic_viewport()
+            .with_depth_stencil(true, false, vk::CompareOp::eLessOrEqual)
             // debug pipeline
             .new_pipeline()
             .add_vertex_shader(ResourceManager::vertex_shader("mesh"))
             .add_fragment_shader(ResourceManager::fragment_shader("mesh"))
             .add_vertex_binding_description(Vertex::binding_desc())
             .add_vertex_attr_description(Vertex::attr_desc())
-            .with_flipped_viewport(swapchain.extent)
+            .with_dynamic_viewport()
             .with_depth_stencil(true, true, vk::CompareOp::eLessOrEqual)
             // wireframe pipeline
             .new_pipeline()
@@ -782,11 +1160,62 @@ void Engine::create_pipelines() {
             .add_fragment_shader(ResourceManager::fragment_shader("wireframe"))
             .add_vertex_binding_description(Vertex::binding_desc())
             .add_vertex_attr_description(Vertex::attr_desc())
-            .with_flipped_viewport(swapchain.extent)
+            .with_dynamic_viewport()
             .with_polygon_mode(vk::PolygonMode::eLine)
             .with_cull_mode(vk::CullModeFlagBits::eNone)
-            // build all pipelines with this layout
-            .build(_render_pass.get());
+            // depth pre-pass pipeline, positions only and no fragment shader
+            .new_pipeline()
+            .add_vertex_shader(ResourceManager::vertex_shader("depth_only"))
+            .add_vertex_binding_description(Vertex::position_binding_desc())
+            .add_vertex_attr_description(Vertex::position_attr_desc())
+            .with_color_writes_disabled()
+            .with_dynamic_viewport()
+            .with_depth_stencil(true, true, vk::CompareOp::eLess)
+            // textured pipeline, opaque variant after a depth pre-pass. depth
+            // is already final, so only the visible fragment passes
+            .new_pipeline()
+            .add_vertex_shader(ResourceManager::vertex_shader("textured_lit"))
+            .add_fragment_shader(ResourceManager::fragment_shader(textured_frag))
+            .add_specialization_constant(vk::ShaderStageFlagBits::eFragment, SPEC_ALPHA_TEST, 0)
+            .add_vertex_binding_description(Vertex::binding_desc())
+            .add_vertex_attr_description(Vertex::attr_desc())
+            .with_default_color_blend_opaque()
+            .with_dynamic_viewport()
+            .with_depth_stencil(true, false, vk::CompareOp::eEqual);
+
+    // pipelines compile on worker threads, the debug pipeline is cheap and is
+    // drawn with in place of any pipeline that is not ready yet
+    _pipelines = _pipeline_registry.build(builder, _render_pass.get());
+    _fallback_pipeline = _pipelines.pipelines[PIPELINE_DEBUG].wait();
+}
+
+void Engine::write_texture_descriptors(
+    usize frame_idx,
+    const std::vector<const Texture2D*>* changed
+) {
+    const auto& set = _frames[frame_idx].texture_set;
+    if (_bindless) {
+        ResourceManager::write_bindless_textures(
+            set,
+            _texture_bindings,
+            _material_buffer,
+            changed
+        );
+        return;
+    }
+
+    const auto* uv_test = _uv_test.texture();
+    if (!changed || std::find(changed->begin(), changed->end(), uv_test) != changed->end()) {
+        DescriptorSetWriter writer{};
+        writer.write_images(set, _texture_bindings, uv_test->descriptor_info()).update();
+    }
+    ResourceManager::update_material_descriptors(_texture_bindings, frame_idx, changed);
+}
+
+void Engine::invalidate_texture_descriptors(const std::vector<const Texture2D*>& textures) {
+    for (auto& frame : _frames) {
+        frame.stale_textures.insert(frame.stale_textures.end(), textures.begin(), textures.end());
+    }
 }
 
 void Engine::recreate_swapchain() {
@@ -819,10 +1248,11 @@ void Engine::recreate_swapchain() {
     VulkanContext::instance().build_swapchain(_window.handle);
     create_framebuffers();
     create_sync_obj();
-    create_pipelines();
+    // pipelines use a dynamic viewport and the render pass is unchanged, so
+    // they remain valid for the new swapchain
 
+    // the camera aspect is picked up by the simulation through `InputState`
     _ui.on_resize();
-    _camera.set_aspect(VulkanContext::aspect());
 }
 
 void Engine::update_ui() {
@@ -0,0 +1,56 @@
+#include "hvk/frame_allocator.hpp"
+
+namespace hvk {
+
+FrameAllocator::FrameAllocator(vk::DeviceSize capacity, vk::BufferUsageFlags usage)
+    : _buffer{capacity, usage},
+      _alignment{1} {
+    const auto& limits = VulkanContext::limits();
+    if (usage & vk::BufferUsageFlagBits::eUniformBuffer) {
+        _alignment = std::max<usize>(_alignment, limits.minUniformBufferOffsetAlignment);
+    }
+    if (usage & vk::BufferUsageFlagBits::eStorageBuffer) {
+        _alignment = std::max<usize>(_alignment, limits.minStorageBufferOffsetAlignment);
+    }
+    HVK_ASSERT(_buffer.is_mapped(), "Frame allocator memory must be host visible");
+}
+
+FrameAllocation FrameAllocator::allocate(usize size) {
+    auto offset = Buffer::align_up(_head, _alignment);
+    HVK_ASSERT(
+        offset + size <= _buffer.size(),
+        fmt::format(
+            "Frame allocator out of memory (requested {} bytes, {} of {} used)",
+            size,
+            _head,
+            _buffer.size()
+        )
+    );
+    _head = offset + size;
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    auto* data = static_cast<u8*>(_buffer.mapped_data()) + offset;
+    return {data, static_cast<u32>(offset)};
+}
+
+void FrameAllocator::reset() noexcept {
+    _head = 0;
+}
+
+vk::Buffer FrameAllocator::buffer() const {
+    return _buffer.buffer();
+}
+
+vk::DescriptorBufferInfo FrameAllocator::descriptor_buffer_info(usize range) const {
+    return {_buffer.buffer(), 0, range};
+}
+
+usize FrameAllocator::capacity() const noexcept {
+    return _buffer.size();
+}
+
+usize FrameAllocator::used() const noexcept {
+    return _head;
+}
+
+}  // namespace hvk
@@ -0,0 +1,363 @@
+#include "hvk/ktx2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string_view>
+
+#include "hvk/content_hash.hpp"
+
+namespace hvk {
+
+inline constexpr std::array<u8, 12> KTX2_IDENTIFIER{
+    0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a,
+};
+
+// fixed-size part of the file: identifier, header and index
+struct Ktx2Header {
+    std::array<u8, 12> identifier{};
+    u32 vk_format{};
+    u32 type_size{};
+    u32 pixel_width{};
+    u32 pixel_height{};
+    u32 pixel_depth{};
+    u32 layer_count{};
+    u32 face_count{};
+    u32 level_count{};
+    u32 supercompression_scheme{};
+    u32 dfd_byte_offset{};
+    u32 dfd_byte_length{};
+    u32 kvd_byte_offset{};
+    u32 kvd_byte_length{};
+    u64 sgd_byte_offset{};
+    u64 sgd_byte_length{};
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must not contain padding");
+
+struct Ktx2LevelIndex {
+    u64 byte_offset{};
+    u64 byte_length{};
+    u64 uncompressed_byte_length{};
+};
+
+// data format descriptor color models for block-compressed formats
+inline constexpr u8 KHR_DF_MODEL_BC1A = 128;
+inline constexpr u8 KHR_DF_MODEL_BC3 = 130;
+inline constexpr u8 KHR_DF_MODEL_BC5 = 132;
+inline constexpr u8 KHR_DF_MODEL_BC7 = 134;
+inline constexpr u8 KHR_DF_PRIMARIES_BT709 = 1;
+inline constexpr u8 KHR_DF_TRANSFER_LINEAR = 1;
+inline constexpr u8 KHR_DF_TRANSFER_SRGB = 2;
+inline constexpr u8 KHR_DF_CHANNEL_RED = 0;
+inline constexpr u8 KHR_DF_CHANNEL_GREEN = 1;
+inline constexpr u8 KHR_DF_CHANNEL_ALPHA = 15;
+
+struct DfdSample {
+    u16 bit_offset{};
+    u8 bit_length{};
+    u8 channel{};
+};
+
+template<typename T>
+void append(std::vector<u8>& dst, const T& value) {
+    const auto* bytes = reinterpret_cast<const u8*>(&value);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    dst.insert(dst.end(), bytes, bytes + sizeof(T));
+}
+
+void pad_to(std::vector<u8>& dst, usize alignment) {
+    dst.resize((dst.size() + alignment - 1) / alignment * alignment);
+}
+
+bool is_srgb_bc(vk::Format format) {
+    switch (format) {
+        case vk::Format::eBc1RgbSrgbBlock:
+        case vk::Format::eBc1RgbaSrgbBlock:
+        case vk::Format::eBc3SrgbBlock:
+        case vk::Format::eBc7SrgbBlock:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_bc_format(vk::Format format) {
+    switch (format) {
+        case vk::Format::eBc1RgbUnormBlock:
+        case vk::Format::eBc1RgbSrgbBlock:
+        case vk::Format::eBc1RgbaUnormBlock:
+        case vk::Format::eBc1RgbaSrgbBlock:
+        case vk::Format::eBc3UnormBlock:
+        case vk::Format::eBc3SrgbBlock:
+        case vk::Format::eBc5UnormBlock:
+        case vk::Format::eBc5SnormBlock:
+        case vk::Format::eBc7UnormBlock:
+        case vk::Format::eBc7SrgbBlock:
+            return true;
+        default:
+            return false;
+    }
+}
+
+usize bc_format_block_size(vk::Format format) {
+    switch (format) {
+        case vk::Format::eBc1RgbUnormBlock:
+        case vk::Format::eBc1RgbSrgbBlock:
+        case vk::Format::eBc1RgbaUnormBlock:
+        case vk::Format::eBc1RgbaSrgbBlock:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+// basic data format descriptor (khronos data format spec, section 5)
+std::vector<u8> build_dfd(vk::Format format) {
+    u8 model{};
+    std::vector<DfdSample> samples{};
+    switch (format) {
+        case vk::Format::eBc1RgbUnormBlock:
+        case vk::Format::eBc1RgbSrgbBlock:
+        case vk::Format::eBc1RgbaUnormBlock:
+        case vk::Format::eBc1RgbaSrgbBlock:
+            model = KHR_DF_MODEL_BC1A;
+            samples = {{0, 63, KHR_DF_CHANNEL_RED}};
+            break;
+        case vk::Format::eBc3UnormBlock:
+        case vk::Format::eBc3SrgbBlock:
+            model = KHR_DF_MODEL_BC3;
+            samples = {{0, 63, KHR_DF_CHANNEL_ALPHA}, {64, 63, KHR_DF_CHANNEL_RED}};
+            break;
+        case vk::Format::eBc5UnormBlock:
+        case vk::Format::eBc5SnormBlock:
+            model = KHR_DF_MODEL_BC5;
+            samples = {{0, 63, KHR_DF_CHANNEL_RED}, {64, 63, KHR_DF_CHANNEL_GREEN}};
+            break;
+        default:
+            model = KHR_DF_MODEL_BC7;
+            samples = {{0, 127, KHR_DF_CHANNEL_RED}};
+            break;
+    }
+
+    const auto block_size = static_cast<u32>(24 + 16 * samples.size());
+    std::vector<u8> dfd{};
+    append(dfd, static_cast<u32>(4 + block_size));
+    // vendor id (khronos) and descriptor type (basic)
+    append(dfd, u32{0});
+    // version 1.3, followed by the block size
+    append(dfd, static_cast<u32>(2 | (block_size << 16)));
+    dfd.push_back(model);
+    dfd.push_back(KHR_DF_PRIMARIES_BT709);
+    dfd.push_back(is_srgb_bc(format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR);
+    dfd.push_back(0);
+    // texel block dimensions minus one (4x4x1x1)
+    append(dfd, std::array<u8, 4>{3, 3, 0, 0});
+    append(dfd, std::array<u8, 8>{static_cast<u8>(bc_format_block_size(format))});
+    for (const auto& sample : samples) {
+        append(dfd, sample.bit_offset);
+        dfd.push_back(sample.bit_length);
+        dfd.push_back(sample.channel);
+        append(dfd, u32{0});
+        append(dfd, u32{0});
+        append(dfd, u32{0xffffffff});
+    }
+
+    return dfd;
+}
+
+std::optional<Ktx2Image> read_ktx2(const std::filesystem::path& path) {
+    auto bytes = read_file(path);
+    if (!bytes) {
+        spdlog::warn("Failed to read KTX2 file '{}'", path.string());
+        return {};
+    }
+    return read_ktx2(std::move(*bytes), path.string());
+}
+
+std::optional<Ktx2Image> read_ktx2(std::vector<u8> bytes, const std::string& name) {
+    Ktx2Image image{};
+    image.data = std::move(bytes);
+    if (image.data.size() < sizeof(Ktx2Header)) {
+        spdlog::warn("Failed to read KTX2 file '{}'", name);
+        return {};
+    }
+
+    Ktx2Header header{};
+    std::memcpy(&header, image.data.data(), sizeof(header));
+    if (header.identifier != KTX2_IDENTIFIER) {
+        spdlog::warn("'{}' is not a KTX2 file", name);
+        return {};
+    }
+
+    image.format = static_cast<vk::Format>(header.vk_format);
+    image.width = header.pixel_width;
+    image.height = header.pixel_height;
+    if (!is_bc_format(image.format) || header.supercompression_scheme != 0
+        || header.pixel_depth > 1 || header.layer_count > 1 || header.face_count != 1
+        || image.width == 0 || image.height == 0) {
+        spdlog::warn(
+            "Unsupported KTX2 file '{}' (format={}, supercompression={})",
+            name,
+            vk::to_string(image.format),
+            header.supercompression_scheme
+        );
+        return {};
+    }
+
+    // more levels than the full mip chain would shift the extent by 32 or more
+    const auto level_count = std::max(header.level_count, 1u);
+    const auto max_levels = static_cast<u32>(std::bit_width(std::max(image.width, image.height)));
+    if (level_count > max_levels) {
+        spdlog::warn(
+            "Invalid KTX2 level count {} in '{}' (max={})",
+            level_count,
+            name,
+            max_levels
+        );
+        return {};
+    }
+    const auto index_end = sizeof(Ktx2Header) + level_count * sizeof(Ktx2LevelIndex);
+    if (image.data.size() < index_end) {
+        spdlog::warn("Truncated KTX2 level index in '{}'", name);
+        return {};
+    }
+
+    const auto block_size = bc_format_block_size(image.format);
+    for (u32 i = 0; i < level_count; i++) {
+        Ktx2LevelIndex level{};
+        std::memcpy(
+            &level,
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            image.data.data() + sizeof(Ktx2Header) + i * sizeof(Ktx2LevelIndex),
+            sizeof(level)
+        );
+
+        const usize blocks_x = (std::max(image.width >> i, 1u) + 3) / 4;
+        const usize blocks_y = (std::max(image.height >> i, 1u) + 3) / 4;
+        const auto expected = blocks_x * blocks_y * block_size;
+        // compared against the remaining size so offset + length cannot overflow
+        const u64 file_size = image.data.size();
+        if (level.byte_length < expected || level.byte_offset > file_size
+            || level.byte_length > file_size - level.byte_offset) {
+            spdlog::warn("Invalid KTX2 level {} in '{}'", i, name);
+            return {};
+        }
+        image.levels.push_back({static_cast<usize>(level.byte_offset), expected});
+    }
+
+    // key/value data: u32 length, then "key\0value" padded to 4 bytes
+    usize kv_offset = header.kvd_byte_offset;
+    const usize kv_end = kv_offset + header.kvd_byte_length;
+    while (kv_end <= image.data.size() && kv_offset + sizeof(u32) <= kv_end) {
+        u32 length{};
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        std::memcpy(&length, image.data.data() + kv_offset, sizeof(length));
+        kv_offset += sizeof(u32);
+        if (kv_offset + length > kv_end) {
+            break;
+        }
+
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto* entry = reinterpret_cast<const char*>(image.data.data() + kv_offset);
+        const std::string_view kv{entry, length};
+        const auto split = kv.find('\0');
+        if (split != std::string_view::npos) {
+            auto value = kv.substr(split + 1);
+            if (!value.empty() && value.back() == '\0') {
+                value.remove_suffix(1);
+            }
+            image.metadata.emplace(std::string{kv.substr(0, split)}, std::string{value});
+        }
+        kv_offset = (kv_offset + length + 3) / 4 * 4;
+    }
+
+    return image;
+}
+
+bool write_ktx2(const std::filesystem::path& path, const Ktx2Image& image) {
+    HVK_ASSERT(is_bc_format(image.format), "Only BC formats can be written to KTX2");
+    HVK_ASSERT(!image.levels.empty(), "KTX2 image must have at least one level");
+
+    const auto level_count = static_cast<u32>(image.levels.size());
+    const auto dfd = build_dfd(image.format);
+
+    // entries must be sorted by key
+    std::vector<u8> kvd{};
+    const std::map<std::string, std::string> sorted{image.metadata.begin(), image.metadata.end()};
+    for (const auto& [key, value] : sorted) {
+        append(kvd, static_cast<u32>(key.size() + value.size() + 2));
+        kvd.insert(kvd.end(), key.begin(), key.end());
+        kvd.push_back(0);
+        kvd.insert(kvd.end(), value.begin(), value.end());
+        kvd.push_back(0);
+        pad_to(kvd, 4);
+    }
+
+    Ktx2Header header{};
+    header.identifier = KTX2_IDENTIFIER;
+    header.vk_format = static_cast<u32>(image.format);
+    header.type_size = 1;
+    header.pixel_width = image.width;
+    header.pixel_height = image.height;
+    header.face_count = 1;
+    header.level_count = level_count;
+    header.dfd_byte_offset =
+        static_cast<u32>(sizeof(Ktx2Header) + level_count * sizeof(Ktx2LevelIndex));
+    header.dfd_byte_length = static_cast<u32>(dfd.size());
+    header.kvd_byte_offset = kvd.empty() ? 0 : header.dfd_byte_offset + header.dfd_byte_length;
+    header.kvd_byte_length = static_cast<u32>(kvd.size());
+
+    std::vector<u8> out{};
+    append(out, header);
+    out.resize(header.dfd_byte_offset);
+    out.insert(out.end(), dfd.begin(), dfd.end());
+    out.insert(out.end(), kvd.begin(), kvd.end());
+
+    // level data is stored smallest first, each aligned to the block size
+    std::vector<Ktx2LevelIndex> index(level_count);
+    const auto alignment = bc_format_block_size(image.format);
+    for (auto i = static_cast<i64>(level_count) - 1; i >= 0; i--) {
+        const auto& level = image.levels[static_cast<usize>(i)];
+        pad_to(out, alignment);
+        index[static_cast<usize>(i)] = {out.size(), level.size, level.size};
+        out.insert(
+            out.end(),
+            image.data.begin() + static_cast<std::ptrdiff_t>(level.offset),
+            image.data.begin() + static_cast<std::ptrdiff_t>(level.offset + level.size)
+        );
+    }
+    std::memcpy(
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        out.data() + sizeof(Ktx2Header),
+        index.data(),
+        index.size() * sizeof(Ktx2LevelIndex)
+    );
+
+    // written through a temporary file so readers never see a partial file
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream file{tmp, std::ios::binary | std::ios::trunc};
+        file.write(
+            reinterpret_cast<const char*>(out.data()),
+            static_cast<std::streamsize>(out.size())
+        );
+        if (!file) {
+            spdlog::warn("Failed to write KTX2 file '{}'", tmp.string());
+            return false;
+        }
+    }
+
+    std::error_code ec{};
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        spdlog::warn("Failed to replace KTX2 file '{}': {}", path.string(), ec.message());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace hvk
@@ -0,0 +1,143 @@
+#include <algorithm>
+
+#include "hvk/layout_cache.hpp"
+#include "hvk/vk_context.hpp"
+
+namespace hvk {
+
+bool DescriptorSetLayoutKey::operator==(const DescriptorSetLayoutKey& other) const noexcept {
+    return bindings == other.bindings && binding_flags == other.binding_flags;
+}
+
+bool PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const noexcept {
+    return set_layouts == other.set_layouts && push_constants == other.push_constants;
+}
+
+usize LayoutKeyHash::operator()(const DescriptorSetLayoutKey& key) const noexcept {
+    usize seed{};
+    for (const auto& binding : key.bindings) {
+        hash_combine(seed, binding.binding);
+        hash_combine(seed, static_cast<VkDescriptorType>(binding.descriptorType));
+        hash_combine(seed, binding.descriptorCount);
+        hash_combine(seed, static_cast<VkShaderStageFlags>(binding.stageFlags));
+    }
+    for (const auto& flags : key.binding_flags) {
+        hash_combine(seed, static_cast<VkDescriptorBindingFlags>(flags));
+    }
+    return seed;
+}
+
+usize LayoutKeyHash::operator()(const PipelineLayoutKey& key) const noexcept {
+    usize seed{};
+    for (const auto& layout : key.set_layouts) {
+        hash_combine(seed, static_cast<VkDescriptorSetLayout>(layout));
+    }
+    for (const auto& range : key.push_constants) {
+        hash_combine(seed, static_cast<VkShaderStageFlags>(range.stageFlags));
+        hash_combine(seed, range.offset);
+        hash_combine(seed, range.size);
+    }
+    return seed;
+}
+
+vk::DescriptorSetLayout LayoutCache::descriptor_set_layout(DescriptorSetLayoutKey key) {
+    HVK_ASSERT(
+        key.binding_flags.empty() || key.binding_flags.size() == key.bindings.size(),
+        "Binding flags must be empty or provided for every binding"
+    );
+    HVK_ASSERT(
+        std::all_of(
+            key.bindings.begin(),
+            key.bindings.end(),
+            [](const auto& binding) { return binding.pImmutableSamplers == nullptr; }
+        ),
+        "Immutable samplers are not supported by the layout cache"
+    );
+
+    // normalize so the same bindings declared in a different order (or with
+    // all-empty flags) produce the same key
+    std::vector<usize> order(key.bindings.size());
+    for (usize i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&key](usize a, usize b) {
+        return key.bindings[a].binding < key.bindings[b].binding;
+    });
+    bool has_flags = std::any_of(
+        key.binding_flags.begin(),
+        key.binding_flags.end(),
+        [](auto flags) { return static_cast<bool>(flags); }
+    );
+
+    DescriptorSetLayoutKey normalized{};
+    for (auto i : order) {
+        normalized.bindings.push_back(key.bindings[i]);
+        if (has_flags) {
+            normalized.binding_flags.push_back(key.binding_flags[i]);
+        }
+    }
+
+    std::lock_guard lock{_mutex};
+    auto it = _set_layouts.find(normalized);
+    if (it != _set_layouts.end()) {
+        return it->second.get();
+    }
+
+    vk::DescriptorSetLayoutCreateInfo info{{}, normalized.bindings};
+    // binding flags are only chained when used, which keeps layouts without
+    // them valid on devices that lack descriptor indexing
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo flags_info{normalized.binding_flags};
+    if (has_flags) {
+        info.setPNext(&flags_info);
+    }
+
+    spdlog::trace("Creating descriptor set layout: bindings={}", normalized.bindings.size());
+    auto layout = VulkanContext::device().createDescriptorSetLayoutUnique(info);
+    auto handle = layout.get();
+    auto inserted = _set_layouts.emplace(std::move(normalized), std::move(layout)).first;
+    _set_layout_keys.emplace(static_cast<VkDescriptorSetLayout>(handle), &inserted->first);
+    return handle;
+}
+
+vk::PipelineLayout LayoutCache::pipeline_layout(PipelineLayoutKey key) {
+    std::lock_guard lock{_mutex};
+    auto it = _pipeline_layouts.find(key);
+    if (it != _pipeline_layouts.end()) {
+        return it->second.get();
+    }
+
+    vk::PipelineLayoutCreateInfo info{};
+    if (!key.set_layouts.empty()) {
+        info.setSetLayouts(key.set_layouts);
+    }
+    if (!key.push_constants.empty()) {
+        info.setPushConstantRanges(key.push_constants);
+    }
+
+    spdlog::trace(
+        "Creating pipeline layout: sets={}, push_constants={}",
+        key.set_layouts.size(),
+        key.push_constants.size()
+    );
+    auto layout = VulkanContext::device().createPipelineLayoutUnique(info);
+    auto handle = layout.get();
+    _pipeline_layouts.emplace(std::move(key), std::move(layout));
+    return handle;
+}
+
+DescriptorSetLayoutKey LayoutCache::descriptor_set_layout_key(vk::DescriptorSetLayout layout) {
+    std::lock_guard lock{_mutex};
+    auto it = _set_layout_keys.find(static_cast<VkDescriptorSetLayout>(layout));
+    HVK_ASSERT(it != _set_layout_keys.end(), "Descriptor set layout is not owned by the cache");
+    return *it->second;
+}
+
+void LayoutCache::clear() {
+    std::lock_guard lock{_mutex};
+    // pipeline layouts reference set layouts, so they are destroyed first
+    _pipeline_layouts.clear();
+    _set_layout_keys.clear();
+    _set_layouts.clear();
+}
+
+}  // namespace hvk
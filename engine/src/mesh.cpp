@@ -1,20 +1,38 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "hvk/mesh.hpp"
 
+#include <limits>
+
 namespace hvk {
 
 Mesh::~Mesh() {
     destroy();
 }
 
-void Mesh::upload(const vk::Queue& queue, UploadContext& ctx) {
+void Mesh::upload(
+    const vk::Queue& queue,
+    UploadContext& ctx,
+    bool position_stream,
+    MeshResidency residency
+) {
     HVK_ASSERT(!_vertices.empty(), "Cannot upload mesh without vertex data");
 
+    glm::vec3 lo{std::numeric_limits<float>::max()};
+    glm::vec3 hi{std::numeric_limits<float>::lowest()};
+    for (const auto& vertex : _vertices) {
+        lo = glm::min(lo, vertex.position);
+        hi = glm::max(hi, vertex.position);
+    }
+    _center = (lo + hi) * 0.5f;
+    _radius = glm::length(hi - lo) * 0.5f;
+
+    // the vertex buffer is the source of the position stream if it is only
+    // needed later, see `upload_positions`
     create_and_upload_buffer(
         queue,
         ctx,
         _vertices,
-        vk::BufferUsageFlagBits::eVertexBuffer,
+        vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferSrc,
         _vertex_buffer
     );
     if (!_indices.empty()) {
@@ -26,6 +44,101 @@ void Mesh::upload(const vk::Queue& queue, UploadContext& ctx) {
             _index_buffer
         );
     }
+    if (position_stream) {
+        std::vector<glm::vec3> positions{};
+        positions.reserve(_vertices.size());
+        for (const auto& vertex : _vertices) {
+            positions.push_back(vertex.position);
+        }
+        create_and_upload_buffer(
+            queue,
+            ctx,
+            positions,
+            vk::BufferUsageFlagBits::eVertexBuffer,
+            _position_buffer
+        );
+    }
+
+    _vertex_count = static_cast<u32>(_vertices.size());
+    _index_count = static_cast<u32>(_indices.size());
+    if (residency == MeshResidency::DeviceOnly) {
+        // assigning empty vectors releases their storage, unlike `clear`
+        _vertices = std::vector<Vertex>{};
+        _indices = std::vector<u32>{};
+    }
+}
+
+void Mesh::upload_positions(const vk::Queue& queue, UploadContext& ctx) {
+    HVK_ASSERT(_vertex_buffer.buffer, "Cannot upload positions of a mesh that was not uploaded");
+    if (has_position_stream()) {
+        return;
+    }
+
+    std::vector<glm::vec3> positions{};
+    positions.reserve(_vertex_count);
+    if (has_host_copy()) {
+        for (const auto& vertex : _vertices) {
+            positions.push_back(vertex.position);
+        }
+    } else {
+        auto& allocator = VulkanContext::allocator();
+        const auto size = static_cast<vk::DeviceSize>(_vertex_count) * sizeof(Vertex);
+        VmaAllocationInfo info{};
+        auto readback = allocator.create_buffer(
+            size,
+            vk::BufferUsageFlagBits::eTransferDst,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            VMA_MEMORY_USAGE_AUTO,
+            &info
+        );
+        ctx.copy_staged(queue, _vertex_buffer, readback, size);
+        allocator.invalidate(readback);
+
+        const auto* vertices = static_cast<const Vertex*>(info.pMappedData);
+        for (u32 i = 0; i < _vertex_count; i++) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            positions.push_back(vertices[i].position);
+        }
+        allocator.destroy(readback);
+    }
+    create_and_upload_buffer(
+        queue,
+        ctx,
+        positions,
+        vk::BufferUsageFlagBits::eVertexBuffer,
+        _position_buffer
+    );
+}
+
+bool Mesh::has_position_stream() const noexcept {
+    return _position_buffer.buffer != nullptr;
+}
+
+bool Mesh::has_host_copy() const noexcept {
+    return !_vertices.empty();
+}
+
+const std::vector<Vertex>& Mesh::vertices() const noexcept {
+    return _vertices;
+}
+
+const std::vector<u32>& Mesh::indices() const noexcept {
+    return _indices;
+}
+
+MeshMemory Mesh::memory() const noexcept {
+    return {
+        .device = _vertex_buffer.size + _index_buffer.size + _position_buffer.size,
+        .host = _vertices.capacity() * sizeof(Vertex) + _indices.capacity() * sizeof(u32),
+    };
+}
+
+glm::vec3 Mesh::center() const {
+    return _center;
+}
+
+float Mesh::radius() const {
+    return _radius;
 }
 
 void Mesh::bind(const vk::UniqueCommandBuffer& cmd) const {
@@ -37,22 +150,34 @@ void Mesh::bind(const vk::CommandBuffer& cmd) const {
     vk::Buffer vb{_vertex_buffer.buffer};
     cmd.bindVertexBuffers(0, vb, {0});
 
-    if (!_indices.empty()) {
+    if (_index_count > 0) {
+        HVK_ASSERT(_index_buffer.buffer, "Cannot bind mesh index buffer with null handle");
+        vk::Buffer ib{_index_buffer.buffer};
+        cmd.bindIndexBuffer(ib, 0, vk::IndexType::eUint32);
+    }
+}
+
+void Mesh::bind_positions(const vk::CommandBuffer& cmd) const {
+    HVK_ASSERT(_position_buffer.buffer, "Cannot bind mesh position buffer with null handle");
+    vk::Buffer pb{_position_buffer.buffer};
+    cmd.bindVertexBuffers(0, pb, {0});
+
+    if (_index_count > 0) {
         HVK_ASSERT(_index_buffer.buffer, "Cannot bind mesh index buffer with null handle");
         vk::Buffer ib{_index_buffer.buffer};
         cmd.bindIndexBuffer(ib, 0, vk::IndexType::eUint32);
     }
 }
 
-void Mesh::draw(const vk::UniqueCommandBuffer& cmd) const {
-    draw(cmd.get());
+void Mesh::draw(const vk::UniqueCommandBuffer& cmd, u32 first_instance) const {
+    draw(cmd.get(), first_instance);
 }
 
-void Mesh::draw(const vk::CommandBuffer& cmd) const {
-    if (_indices.empty()) {
-        cmd.draw(static_cast<u32>(_vertices.size()), 1, 0, 0);
+void Mesh::draw(const vk::CommandBuffer& cmd, u32 first_instance) const {
+    if (_index_count == 0) {
+        cmd.draw(_vertex_count, 1, 0, first_instance);
     } else {
-        cmd.drawIndexed(static_cast<u32>(_indices.size()), 1, 0, 0, 0);
+        cmd.drawIndexed(_index_count, 1, 0, 0, first_instance);
     }
 }
 
@@ -60,6 +185,7 @@ void Mesh::destroy() {
     auto& allocator = VulkanContext::allocator();
     allocator.destroy(_vertex_buffer);
     allocator.destroy(_index_buffer);
+    allocator.destroy(_position_buffer);
 }
 
 }  // namespace hvk
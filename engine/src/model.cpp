@@ -2,17 +2,33 @@
 
 namespace hvk {
 
+glm::mat4 Transform::matrix() const {
+    auto translate_mat = glm::translate(glm::mat4(1.0f), translation);
+    auto rotate_mat = glm::toMat4(glm::quat(rotation));
+    auto scale_mat = glm::scale(glm::mat4(1.0f), scale);
+    return translate_mat * rotate_mat * scale_mat;
+}
+
 glm::mat4 Model::transform() const {
-    auto translate = glm::translate(glm::mat4(1.0f), _transform.translation);
-    auto rotate = glm::toMat4(glm::quat(_transform.rotation));
-    auto scale = glm::scale(glm::mat4(1.0f), _transform.scale);
-    return translate * rotate * scale;
+    return _transform.matrix();
+}
+
+const Transform& Model::local_transform() const noexcept {
+    return _transform;
 }
 
 const std::vector<Node>& Model::nodes() const {
     return _nodes;
 }
 
+glm::vec3 Model::node_center(const Node& node) const {
+    return _meshes.at(node.mesh_idx).center();
+}
+
+float Model::node_radius(const Node& node) const {
+    return _meshes.at(node.mesh_idx).radius();
+}
+
 void Model::rotate(glm::vec3 rotation) {
     _transform.rotation += rotation;
 }
@@ -37,28 +53,63 @@ void Model::set_scale(float scale) {
     _transform.scale = glm::vec3{scale};
 }
 
-void Model::upload(const vk::Queue& queue, UploadContext& ctx) {
+void Model::upload(
+    const vk::Queue& queue,
+    UploadContext& ctx,
+    bool position_stream,
+    MeshResidency residency
+) {
+    for (auto& mesh : _meshes) {
+        mesh.upload(queue, ctx, position_stream, residency);
+    }
+}
+
+void Model::upload_positions(const vk::Queue& queue, UploadContext& ctx) {
     for (auto& mesh : _meshes) {
-        mesh.upload(queue, ctx);
+        mesh.upload_positions(queue, ctx);
     }
 }
 
-void Model::draw(const vk::UniqueCommandBuffer& cmd) const {
-    draw(cmd.get());
+MeshMemory Model::memory() const noexcept {
+    MeshMemory memory{};
+    for (const auto& mesh : _meshes) {
+        const auto mesh_memory = mesh.memory();
+        memory.device += mesh_memory.device;
+        memory.host += mesh_memory.host;
+    }
+    return memory;
 }
 
-void Model::draw(const vk::CommandBuffer& cmd) const {
+void Model::draw(const vk::UniqueCommandBuffer& cmd, u32 first_instance) const {
+    draw(cmd.get(), first_instance);
+}
+
+void Model::draw(const vk::CommandBuffer& cmd, u32 first_instance) const {
     for (const auto& [_, mesh_idx] : _nodes) {
         const auto& mesh = _meshes.at(mesh_idx);
         mesh.bind(cmd);
-        mesh.draw(cmd);
+        mesh.draw(cmd, first_instance);
     }
 }
 
-void Model::draw_node(const Node& node, const vk::UniqueCommandBuffer& cmd) const {
+void Model::draw_node(
+    const Node& node,
+    const vk::UniqueCommandBuffer& cmd,
+    u32 first_instance
+) const {
     const auto& mesh = _meshes.at(node.mesh_idx);
     mesh.bind(cmd);
-    mesh.draw(cmd);
+    mesh.draw(cmd, first_instance);
+}
+
+void Model::draw_node_positions(
+    const Node& node,
+    const vk::UniqueCommandBuffer& cmd,
+    u32 first_instance
+) const {
+    const auto& mesh = _meshes.at(node.mesh_idx);
+    mesh.bind_positions(cmd.get());
+    mesh.draw(cmd, first_instance);
 }
 
 }  // namespace hvk
@@ -1,3 +1,5 @@
+#include <type_traits>
+
 #include "hvk/pipeline_builder.hpp"
 #include "hvk/vk_context.hpp"
 
@@ -9,6 +11,9 @@ struct PipelineBuilderState {
           vertex_input_states(count),
           viewport_states(count),
           shader_stages(count),
+          specialization_entries(count),
+          specialization_data(count),
+          specialization_infos(count),
           rasterizers(count),
           color_blend_states(count),
           dynamic_states(count) {}
@@ -18,6 +23,10 @@ struct PipelineBuilderState {
     std::vector<vk::PipelineVertexInputStateCreateInfo> vertex_input_states{};
     std::vector<vk::PipelineViewportStateCreateInfo> viewport_states{};
     std::vector<std::vector<vk::PipelineShaderStageCreateInfo>> shader_stages{};
+    // indexed by pipeline and then by stage
+    std::vector<std::vector<std::vector<vk::SpecializationMapEntry>>> specialization_entries{};
+    std::vector<std::vector<std::vector<u32>>> specialization_data{};
+    std::vector<std::vector<vk::SpecializationInfo>> specialization_infos{};
     std::vector<vk::PipelineRasterizationStateCreateInfo> rasterizers{};
     std::vector<vk::PipelineColorBlendStateCreateInfo> color_blend_states{};
     std::vector<vk::PipelineDynamicStateCreateInfo> dynamic_states{};
@@ -45,6 +54,265 @@ std::vector<vk::PipelineShaderStageCreateInfo> build_shader_stage_info(const Pip
     return stages;
 }
 
+void fill_specialization_info(PipelineBuilderState& state, usize i, const PipelineConfig& config) {
+    const auto stage_count = config.shaders.size();
+    auto& all_entries = state.specialization_entries[i];
+    auto& all_data = state.specialization_data[i];
+    auto& infos = state.specialization_infos[i];
+    all_entries.resize(stage_count);
+    all_data.resize(stage_count);
+    infos.resize(stage_count);
+
+    for (usize s = 0; s < stage_count; s++) {
+        auto& entries = all_entries[s];
+        auto& data = all_data[s];
+        for (const auto& constant : config.specialization_constants) {
+            if (constant.stage != config.stage_flags[s]) {
+                continue;
+            }
+            entries.emplace_back(
+                constant.id,
+                static_cast<u32>(data.size() * sizeof(u32)),
+                sizeof(u32)
+            );
+            data.push_back(constant.value);
+        }
+        if (entries.empty()) {
+            continue;
+        }
+
+        infos[s]
+            .setMapEntries(entries)
+            .setDataSize(data.size() * sizeof(u32))
+            .setPData(data.data());
+        state.shader_stages[i][s].setPSpecializationInfo(&infos[s]);
+    }
+}
+
+void fill_pipeline_info(
+    PipelineBuilderState& state,
+    usize i,
+    const PipelineConfig& config,
+    vk::PipelineLayout layout,
+    vk::RenderPass render_pass
+) {
+    state.vertex_input_states[i]
+        .setVertexBindingDescriptions(config.vertex_input_bindings)
+        .setVertexAttributeDescriptions(config.vertex_input_attrs);
+    state.viewport_states[i].setViewports(config.viewports).setScissors(config.scissors);
+    state.shader_stages[i] = build_shader_stage_info(config);
+    fill_specialization_info(state, i, config);
+    state.color_blend_states[i] = config.color_blend_state;
+    state.color_blend_states[i].setAttachments(config.color_blend_attachments);
+    if (!config.dynamic_states.empty()) {
+        state.dynamic_states[i].setDynamicStates(config.dynamic_states);
+    }
+
+    state.pipeline_infos[i]
+        .setStages(state.shader_stages[i])
+        .setPVertexInputState(&state.vertex_input_states[i])
+        .setPInputAssemblyState(&config.input_assembly_state)
+        .setPViewportState(&state.viewport_states[i])
+        .setPRasterizationState(&config.rasterizer_info)
+        .setPMultisampleState(&config.multisample_state)
+        .setPColorBlendState(&state.color_blend_states[i])
+        .setPDepthStencilState(&config.depth_stencil)
+        .setPDynamicState(&state.dynamic_states[i])
+        .setLayout(layout)
+        .setRenderPass(render_pass);
+}
+
+vk::UniquePipeline create_graphics_pipeline(
+    const PipelineConfig& config,
+    vk::PipelineLayout layout,
+    vk::RenderPass render_pass
+) {
+    PipelineBuilderState state{1};
+    fill_pipeline_info(state, 0, config, layout, render_pass);
+
+    auto pipeline = VulkanContext::device().createGraphicsPipelineUnique(
+        VulkanContext::pipeline_cache(),
+        state.pipeline_infos[0]
+    );
+    VKHPP_CHECK(pipeline.result, "Failed to create graphics pipeline");
+    return std::move(pipeline.value);
+}
+
+// appends the bytes of scalar values (so there is never padding in the key),
+// lists are prefixed with their length so neighbouring lists cannot alias
+class PipelineKeyWriter {
+public:
+    template<typename T>
+    void add(const T& value) {
+        static_assert(std::is_scalar_v<T>, "Only scalars have a well-defined key representation");
+        const auto* bytes = reinterpret_cast<const u8*>(&value);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        _key.insert(_key.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename Bits>
+    void add(vk::Flags<Bits> flags) {
+        add(static_cast<typename vk::Flags<Bits>::MaskType>(flags));
+    }
+
+    void add_bytes(const std::vector<char>& data) {
+        add(data.size());
+        _key.insert(_key.end(), data.begin(), data.end());
+    }
+
+    [[nodiscard]]
+    std::vector<u8> take() {
+        return std::move(_key);
+    }
+
+private:
+    std::vector<u8> _key{};
+};
+
+void add_stencil_op(PipelineKeyWriter& key, const vk::StencilOpState& op) {
+    key.add(op.failOp);
+    key.add(op.passOp);
+    key.add(op.depthFailOp);
+    key.add(op.compareOp);
+    key.add(op.compareMask);
+    key.add(op.writeMask);
+    key.add(op.reference);
+}
+
+std::optional<std::vector<u8>> pipeline_config_key(
+    const PipelineConfig& config,
+    vk::PipelineLayout layout,
+    vk::RenderPass render_pass
+) {
+    HVK_ASSERT(
+        config.shader_code.size() == config.shaders.size(),
+        "Every shader module should have an entry in shader_code"
+    );
+
+    // none of the states use a pNext chain, so their fields are all there is
+    PipelineKeyWriter key{};
+    key.add(static_cast<VkPipelineLayout>(layout));
+    key.add(static_cast<VkRenderPass>(render_pass));
+
+    key.add(config.shader_code.size());
+    for (usize i = 0; i < config.shader_code.size(); i++) {
+        if (config.shader_code[i].empty()) {
+            return std::nullopt;
+        }
+        key.add(config.stage_flags[i]);
+        key.add_bytes(config.shader_code[i]);
+    }
+    key.add(config.specialization_constants.size());
+    for (const auto& constant : config.specialization_constants) {
+        key.add(constant.stage);
+        key.add(constant.id);
+        key.add(constant.value);
+    }
+    key.add(config.vertex_input_bindings.size());
+    for (const auto& binding : config.vertex_input_bindings) {
+        key.add(binding.binding);
+        key.add(binding.stride);
+        key.add(binding.inputRate);
+    }
+    key.add(config.vertex_input_attrs.size());
+    for (const auto& attr : config.vertex_input_attrs) {
+        key.add(attr.location);
+        key.add(attr.binding);
+        key.add(attr.format);
+        key.add(attr.offset);
+    }
+
+    const auto& assembly = config.input_assembly_state;
+    key.add(assembly.flags);
+    key.add(assembly.topology);
+    key.add(assembly.primitiveRestartEnable);
+
+    key.add(config.viewports.size());
+    for (const auto& viewport : config.viewports) {
+        key.add(viewport.x);
+        key.add(viewport.y);
+        key.add(viewport.width);
+        key.add(viewport.height);
+        key.add(viewport.minDepth);
+        key.add(viewport.maxDepth);
+    }
+    key.add(config.scissors.size());
+    for (const auto& scissor : config.scissors) {
+        key.add(scissor.offset.x);
+        key.add(scissor.offset.y);
+        key.add(scissor.extent.width);
+        key.add(scissor.extent.height);
+    }
+
+    const auto& multisample = config.multisample_state;
+    key.add(multisample.flags);
+    key.add(multisample.rasterizationSamples);
+    key.add(multisample.sampleShadingEnable);
+    key.add(multisample.minSampleShading);
+    key.add(multisample.pSampleMask != nullptr);
+    if (multisample.pSampleMask) {
+        // one 32-bit word of the mask per 32 samples
+        const auto samples = static_cast<u32>(multisample.rasterizationSamples);
+        for (u32 i = 0; i < (samples + 31) / 32; i++) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            key.add(multisample.pSampleMask[i]);
+        }
+    }
+    key.add(multisample.alphaToCoverageEnable);
+    key.add(multisample.alphaToOneEnable);
+
+    const auto& blend_state = config.color_blend_state;
+    key.add(blend_state.flags);
+    key.add(blend_state.logicOpEnable);
+    key.add(blend_state.logicOp);
+    for (auto constant : blend_state.blendConstants) {
+        key.add(constant);
+    }
+    key.add(config.color_blend_attachments.size());
+    for (const auto& blend : config.color_blend_attachments) {
+        key.add(blend.blendEnable);
+        key.add(blend.srcColorBlendFactor);
+        key.add(blend.dstColorBlendFactor);
+        key.add(blend.colorBlendOp);
+        key.add(blend.srcAlphaBlendFactor);
+        key.add(blend.dstAlphaBlendFactor);
+        key.add(blend.alphaBlendOp);
+        key.add(blend.colorWriteMask);
+    }
+
+    const auto& raster = config.rasterizer_info;
+    key.add(raster.flags);
+    key.add(raster.depthClampEnable);
+    key.add(raster.rasterizerDiscardEnable);
+    key.add(raster.polygonMode);
+    key.add(raster.cullMode);
+    key.add(raster.frontFace);
+    key.add(raster.depthBiasEnable);
+    key.add(raster.depthBiasConstantFactor);
+    key.add(raster.depthBiasClamp);
+    key.add(raster.depthBiasSlopeFactor);
+    key.add(raster.lineWidth);
+
+    const auto& depth = config.depth_stencil;
+    key.add(depth.flags);
+    key.add(depth.depthTestEnable);
+    key.add(depth.depthWriteEnable);
+    key.add(depth.depthCompareOp);
+    key.add(depth.depthBoundsTestEnable);
+    key.add(depth.stencilTestEnable);
+    add_stencil_op(key, depth.front);
+    add_stencil_op(key, depth.back);
+    key.add(depth.minDepthBounds);
+    key.add(depth.maxDepthBounds);
+
+    key.add(config.dynamic_states.size());
+    for (auto state : config.dynamic_states) {
+        key.add(state);
+    }
+
+    return key.take();
+}
+
 vk::PipelineColorBlendAttachmentState default_color_blend_attachment(bool blend) {
     vk::PipelineColorBlendAttachmentState state{};
     state
@@ -84,32 +352,45 @@ PipelineBuilder& PipelineBuilder::add_push_constant(const vk::PushConstantRange&
     return *this;
 }
 
-PipelineBuilder& PipelineBuilder::add_descriptor_set_layout(
-    const vk::UniqueDescriptorSetLayout& layout
-) {
-    _desc_set_layouts.push_back(layout.get());
+PipelineBuilder& PipelineBuilder::add_descriptor_set_layout(vk::DescriptorSetLayout layout) {
+    _desc_set_layouts.push_back(layout);
     return *this;
 }
 
 PipelineBuilder& PipelineBuilder::add_vertex_shader(vk::UniqueShaderModule shader) {
-    current_config().shaders.push_back(std::move(shader));
-    current_config().stage_flags.push_back(vk::ShaderStageFlagBits::eVertex);
+    auto& config = current_config();
+    config.shader_code.emplace_back();
+    config.shaders.push_back(std::move(shader));
+    config.stage_flags.push_back(vk::ShaderStageFlagBits::eVertex);
     return *this;
 }
 
 PipelineBuilder& PipelineBuilder::add_vertex_shader(const Shader& shader) {
     add_vertex_shader(shader.module());
+    current_config().shader_code.back() = shader.code();
     return *this;
 }
 
 PipelineBuilder& PipelineBuilder::add_fragment_shader(vk::UniqueShaderModule shader) {
-    current_config().shaders.push_back(std::move(shader));
-    current_config().stage_flags.push_back(vk::ShaderStageFlagBits::eFragment);
+    auto& config = current_config();
+    config.shader_code.emplace_back();
+    config.shaders.push_back(std::move(shader));
+    config.stage_flags.push_back(vk::ShaderStageFlagBits::eFragment);
     return *this;
 }
 
 PipelineBuilder& PipelineBuilder::add_fragment_shader(const Shader& shader) {
     add_fragment_shader(shader.module());
+    current_config().shader_code.back() = shader.code();
+    return *this;
+}
+
+PipelineBuilder& PipelineBuilder::add_specialization_constant(
+    vk::ShaderStageFlagBits stage,
+    u32 id,
+    u32 value
+) {
+    current_config().specialization_constants.push_back({stage, id, value});
     return *this;
 }
 
@@ -180,6 +461,16 @@ PipelineBuilder& PipelineBuilder::with_viewport(const vk::Extent2D& extent) {
     return *this;
 }
 
+PipelineBuilder& PipelineBuilder::with_dynamic_viewport() {
+    auto& config = current_config();
+    // counts still come from the viewport state, the values are ignored
+    config.viewports = {vk::Viewport{}};
+    config.scissors = {vk::Rect2D{}};
+    config.dynamic_states.push_back(vk::DynamicState::eViewport);
+    config.dynamic_states.push_back(vk::DynamicState::eScissor);
+    return *this;
+}
+
 PipelineBuilder& PipelineBuilder::add_dynamic_state(vk::DynamicState state) {
     current_config().dynamic_states.push_back(state);
     return *this;
@@ -202,6 +493,13 @@ PipelineBuilder& PipelineBuilder::with_default_color_blend_transparency() {
     return *this;
 }
 
+PipelineBuilder& PipelineBuilder::with_color_writes_disabled() {
+    auto attachment = default_color_blend_attachment(false);
+    attachment.setColorWriteMask({});
+    current_config().color_blend_attachments = {attachment};
+    return *this;
+}
+
 PipelineBuilder& PipelineBuilder::with_front_face(vk::FrontFace front) {
     current_config().rasterizer_info.setFrontFace(front);
     return *this;
@@ -236,56 +534,34 @@ GraphicsPipeline PipelineBuilder::build(const vk::RenderPass& render_pass) {
     PipelineBuilderState state{count};
 
     for (u32 i = 0; i < count; i++) {
-        const auto& config = _config[i];
-
-        state.vertex_input_states[i]
-            .setVertexBindingDescriptions(config.vertex_input_bindings)
-            .setVertexAttributeDescriptions(config.vertex_input_attrs);
-        state.viewport_states[i].setViewports(config.viewports).setScissors(config.scissors);
-        state.shader_stages[i] = build_shader_stage_info(_config[i]);
-        state.color_blend_states[i].setAttachments(config.color_blend_attachments);
-        if (!config.dynamic_states.empty()) {
-            state.dynamic_states[i].setDynamicStates(config.dynamic_states);
-        }
-
-        state.pipeline_infos[i]
-            .setStages(state.shader_stages[i])
-            .setPVertexInputState(&state.vertex_input_states[i])
-            .setPInputAssemblyState(&config.input_assembly_state)
-            .setPViewportState(&state.viewport_states[i])
-            .setPRasterizationState(&config.rasterizer_info)
-            .setPMultisampleState(&config.multisample_state)
-            .setPColorBlendState(&state.color_blend_states[i])
-            .setPDepthStencilState(&config.depth_stencil)
-            .setPDynamicState(&state.dynamic_states[i])
-            .setLayout(layout.get())
-            .setRenderPass(render_pass);
+        fill_pipeline_info(state, i, _config[i], layout, render_pass);
     }
 
-    auto pipelines =
-        VulkanContext::device().createGraphicsPipelinesUnique(nullptr, state.pipeline_infos);
+    auto pipelines = VulkanContext::device().createGraphicsPipelinesUnique(
+        VulkanContext::pipeline_cache(),
+        state.pipeline_infos
+    );
     VKHPP_CHECK(pipelines.result, "Failed to create graphics pipeline");
-    GraphicsPipeline result{std::move(layout), std::move(pipelines.value)};
+    GraphicsPipeline result{layout, std::move(pipelines.value)};
 
     *this = {};
 
     return result;
 }
 
+std::pair<vk::PipelineLayout, std::vector<PipelineConfig>> PipelineBuilder::take() {
+    auto layout = create_pipeline_layout();
+    auto configs = std::move(_config);
+    *this = {};
+    return {layout, std::move(configs)};
+}
+
 PipelineConfig& PipelineBuilder::current_config() {
     return _config[_idx];
 }
 
-vk::UniquePipelineLayout PipelineBuilder::create_pipeline_layout() const {
-    vk::PipelineLayoutCreateInfo layout_info{};
-    if (!_desc_set_layouts.empty()) {
-        layout_info.setSetLayouts(_desc_set_layouts);
-    }
-    if (!_push_constants.empty()) {
-        layout_info.setPushConstantRanges(_push_constants);
-    }
-
-    return VulkanContext::device().createPipelineLayoutUnique(layout_info);
+vk::PipelineLayout PipelineBuilder::create_pipeline_layout() const {
+    return VulkanContext::layout_cache().pipeline_layout({_desc_set_layouts, _push_constants});
 }
 
 }  // namespace hvk
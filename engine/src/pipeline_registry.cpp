@@ -0,0 +1,122 @@
+#include <chrono>
+
+#include "hvk/content_hash.hpp"
+#include "hvk/pipeline_registry.hpp"
+
+namespace hvk {
+
+PipelineHandle::PipelineHandle(usize key, std::shared_future<vk::Pipeline> future)
+    : _key{key},
+      _future{std::move(future)} {}
+
+bool PipelineHandle::valid() const noexcept {
+    return _future.valid();
+}
+
+bool PipelineHandle::ready() const {
+    return valid() && _future.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+}
+
+usize PipelineHandle::key() const noexcept {
+    return _key;
+}
+
+vk::Pipeline PipelineHandle::wait() const {
+    HVK_ASSERT(valid(), "Cannot wait on an empty pipeline handle");
+    return _future.get();
+}
+
+vk::Pipeline PipelineHandle::get_or(vk::Pipeline fallback) const {
+    return ready() ? _future.get() : fallback;
+}
+
+PipelineRegistry::PipelineRegistry(ThreadPool& pool) : _pool{&pool} {}
+
+PipelineRegistry::~PipelineRegistry() {
+    // workers write into entries, so they have to finish before destruction
+    wait_idle();
+}
+
+usize PipelineRegistry::KeyHash::operator()(const std::vector<u8>& key) const noexcept {
+    return static_cast<usize>(content_hash(key));
+}
+
+PipelineHandle PipelineRegistry::request(
+    PipelineConfig config,
+    vk::PipelineLayout layout,
+    vk::RenderPass render_pass
+) {
+    auto config_key = pipeline_config_key(config, layout, render_pass);
+    const auto key = config_key ? KeyHash{}(*config_key) : 0;
+
+    // keys are compared in full, so a hash collision is only a slower lookup
+    std::lock_guard lock{_mutex};
+    if (config_key) {
+        auto it = _entries.find(*config_key);
+        if (it != _entries.end()) {
+            return PipelineHandle{key, it->second->future};
+        }
+    }
+
+    // the config owns its shader modules, which only need to live until the
+    // pipeline has been created on the worker thread
+    auto entry = std::make_shared<Entry>();
+    auto task_config = std::make_shared<PipelineConfig>(std::move(config));
+    auto task = [entry, task_config, layout, render_pass, key]() {
+        spdlog::trace("Compiling pipeline {:#018x}", key);
+        entry->pipeline = create_graphics_pipeline(*task_config, layout, render_pass);
+        return entry->pipeline.get();
+    };
+    entry->future = _pool->submit(std::move(task)).share();
+
+    if (config_key) {
+        _entries.emplace(std::move(*config_key), entry);
+    } else {
+        _unkeyed.push_back(entry);
+    }
+    return PipelineHandle{key, entry->future};
+}
+
+AsyncGraphicsPipeline PipelineRegistry::build(
+    PipelineBuilder& builder,
+    vk::RenderPass render_pass
+) {
+    auto [layout, configs] = builder.take();
+
+    AsyncGraphicsPipeline result{layout, {}};
+    result.pipelines.reserve(configs.size());
+    for (auto& config : configs) {
+        result.pipelines.push_back(request(std::move(config), layout, render_pass));
+    }
+    return result;
+}
+
+void PipelineRegistry::wait_idle() const {
+    std::vector<std::shared_future<vk::Pipeline>> pending{};
+    {
+        std::lock_guard lock{_mutex};
+        for (const auto& [_, entry] : _entries) {
+            pending.push_back(entry->future);
+        }
+        for (const auto& entry : _unkeyed) {
+            pending.push_back(entry->future);
+        }
+    }
+    for (const auto& future : pending) {
+        future.wait();
+    }
+}
+
+void PipelineRegistry::clear() {
+    wait_idle();
+    std::lock_guard lock{_mutex};
+    _entries.clear();
+    _unkeyed.clear();
+}
+
+usize PipelineRegistry::size() const {
+    std::lock_guard lock{_mutex};
+    return _entries.size() + _unkeyed.size();
+}
+
+}  // namespace hvk
@@ -0,0 +1,828 @@
+#include "hvk/pixel_kernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define HVK_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// NOLINTBEGIN(cppcoreguidelines-macro-usage)
+#if defined(__GNUC__) || defined(__clang__)
+#define HVK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HVK_TARGET_AVX2
+#endif
+// NOLINTEND(cppcoreguidelines-macro-usage)
+
+namespace hvk {
+
+// linear values are quantized to this many steps before sRGB encoding
+inline constexpr u32 SRGB_ENCODE_STEPS = 4096;
+inline constexpr float SRGB_ENCODE_SCALE = static_cast<float>(SRGB_ENCODE_STEPS - 1);
+
+const std::array<float, 256>& srgb_decode_lut() {
+    static const auto lut = [] {
+        std::array<float, 256> result{};
+        for (usize i = 0; i < result.size(); i++) {
+            const auto c = static_cast<float>(i) / 255.0f;
+            result[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return result;
+    }();
+    return lut;
+}
+
+// u32 entries so the AVX2 path can gather from it directly
+const std::array<u32, SRGB_ENCODE_STEPS>& srgb_encode_lut() {
+    static const auto lut = [] {
+        std::array<u32, SRGB_ENCODE_STEPS> result{};
+        for (usize i = 0; i < result.size(); i++) {
+            const auto c = static_cast<float>(i) / SRGB_ENCODE_SCALE;
+            const auto s =
+                c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            result[i] = static_cast<u32>(std::lround(std::clamp(s, 0.0f, 1.0f) * 255.0f));
+        }
+        return result;
+    }();
+    return lut;
+}
+
+SimdLevel detect_simd_level() {
+#if defined(HVK_SIMD_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+    // AVX2 needs the CPU feature bit and the OS saving YMM state
+    std::array<int, 4> info{};
+    __cpuid(info.data(), 0);
+    if (info[0] >= 7) {
+        __cpuid(info.data(), 1);
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        __cpuidex(info.data(), 7, 0);
+        const bool avx2 = (info[1] & (1 << 5)) != 0;
+        if (avx && osxsave && avx2 && (_xgetbv(0) & 6) == 6) {
+            return SimdLevel::AVX2;
+        }
+    }
+    return SimdLevel::SSE2;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#endif
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel detected_simd_level() {
+    static const auto level = detect_simd_level();
+    return level;
+}
+
+std::atomic<SimdLevel>& active_simd_level() {
+    static std::atomic<SimdLevel> level{detected_simd_level()};
+    return level;
+}
+
+SimdLevel simd_level() {
+    return active_simd_level().load(std::memory_order_relaxed);
+}
+
+void set_simd_level(SimdLevel level) {
+    active_simd_level().store(std::min(level, detected_simd_level()), std::memory_order_relaxed);
+}
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+// ==================
+// SCALAR REFERENCES
+// ==================
+
+AlphaCount count_alpha_scalar(const u8* rgba, usize texels, u8 partial_min, u8 partial_max) {
+    AlphaCount count{};
+    for (usize i = 0; i < texels; i++) {
+        const auto alpha = rgba[i * 4 + 3];
+        count.non_opaque += alpha != 255 ? 1 : 0;
+        count.partial += alpha >= partial_min && alpha <= partial_max ? 1 : 0;
+    }
+    return count;
+}
+
+void expand_rgb_to_rgba_scalar(const u8* rgb, u8* rgba, usize texels) {
+    for (usize i = 0; i < texels; i++) {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+void premultiply_alpha_scalar(u8* rgba, usize texels) {
+    for (usize i = 0; i < texels; i++) {
+        u8* texel = rgba + i * 4;
+        const u32 alpha = texel[3];
+        for (usize c = 0; c < 3; c++) {
+            texel[c] = static_cast<u8>((texel[c] * alpha + 127) / 255);
+        }
+    }
+}
+
+// one output texel, also used for the edges the vector paths leave over
+void downsample_texel(
+    const u8* row0,
+    const u8* row1,
+    u32 width,
+    u32 x,
+    bool srgb,
+    u8* out
+) {
+    const auto x0 = std::min(2 * x, width - 1);
+    const auto x1 = std::min(2 * x + 1, width - 1);
+    const u8* texels[] = {
+        row0 + static_cast<usize>(x0) * 4,
+        row0 + static_cast<usize>(x1) * 4,
+        row1 + static_cast<usize>(x0) * 4,
+        row1 + static_cast<usize>(x1) * 4,
+    };
+    const auto& decode = srgb_decode_lut();
+    const auto& encode = srgb_encode_lut();
+
+    for (usize c = 0; c < 4; c++) {
+        if (srgb && c < 3) {
+            float sum = decode[texels[0][c]];
+            sum += decode[texels[1][c]];
+            sum += decode[texels[2][c]];
+            sum += decode[texels[3][c]];
+            const auto index = static_cast<u32>(sum * 0.25f * SRGB_ENCODE_SCALE + 0.5f);
+            out[c] = static_cast<u8>(encode[std::min(index, SRGB_ENCODE_STEPS - 1)]);
+        } else {
+            const u32 sum = texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c];
+            out[c] = static_cast<u8>((sum + 2) / 4);
+        }
+    }
+}
+
+void downsample_2x2_rgba8_scalar(const u8* src, u32 width, u32 height, bool srgb, u8* dst) {
+    const auto dst_width = std::max(width / 2, 1u);
+    const auto dst_height = std::max(height / 2, 1u);
+    for (u32 y = 0; y < dst_height; y++) {
+        const u8* row0 = src + static_cast<usize>(std::min(2 * y, height - 1)) * width * 4;
+        const u8* row1 = src + static_cast<usize>(std::min(2 * y + 1, height - 1)) * width * 4;
+        u8* out = dst + static_cast<usize>(y) * dst_width * 4;
+        for (u32 x = 0; x < dst_width; x++) {
+            downsample_texel(row0, row1, width, x, srgb, out + static_cast<usize>(x) * 4);
+        }
+    }
+}
+
+void swizzle_rgba8_scalar(u8* rgba, usize texels, std::array<u8, 4> order) {
+    for (usize i = 0; i < texels; i++) {
+        u8* texel = rgba + i * 4;
+        const std::array<u8, 4> src = {texel[0], texel[1], texel[2], texel[3]};
+        for (usize c = 0; c < 4; c++) {
+            texel[c] = src[order[c]];
+        }
+    }
+}
+
+void bc_block_bounds_scalar(const u8* block, std::array<u8, 4>& lo, std::array<u8, 4>& hi) {
+    lo.fill(255);
+    hi.fill(0);
+    for (usize i = 0; i < 16; i++) {
+        for (usize c = 0; c < 4; c++) {
+            lo[c] = std::min(lo[c], block[i * 4 + c]);
+            hi[c] = std::max(hi[c], block[i * 4 + c]);
+        }
+    }
+}
+
+u32 bc1_indices_scalar(const u8* block, const BcPalette& palette) {
+    u32 indices{};
+    for (u32 i = 0; i < 16; i++) {
+        u32 best{};
+        i32 best_dist = std::numeric_limits<i32>::max();
+        for (u32 p = 0; p < 4; p++) {
+            i32 dist{};
+            for (usize c = 0; c < 3; c++) {
+                const auto d = static_cast<i32>(block[i * 4 + c]) - palette[p][c];
+                dist += d * d;
+            }
+            if (dist < best_dist) {
+                best_dist = dist;
+                best = p;
+            }
+        }
+        indices |= best << (i * 2);
+    }
+    return indices;
+}
+
+u64 bc4_indices_scalar(const u8* block, usize channel, const std::array<u8, 8>& palette) {
+    u64 indices{};
+    for (u32 i = 0; i < 16; i++) {
+        const auto value = static_cast<i32>(block[i * 4 + channel]);
+        u64 best{};
+        i32 best_dist = std::numeric_limits<i32>::max();
+        for (u64 p = 0; p < 8; p++) {
+            const auto dist = std::abs(value - static_cast<i32>(palette[p]));
+            if (dist < best_dist) {
+                best_dist = dist;
+                best = p;
+            }
+        }
+        indices |= best << (i * 3);
+    }
+    return indices;
+}
+
+#if defined(HVK_SIMD_X86)
+
+// =====
+// SSE2
+// =====
+
+AlphaCount count_alpha_sse2(const u8* rgba, usize texels, u8 partial_min, u8 partial_max) {
+    const auto opaque = _mm_set1_epi32(255);
+    const auto lower = _mm_set1_epi32(static_cast<i32>(partial_min) - 1);
+    const auto upper = _mm_set1_epi32(static_cast<i32>(partial_max) + 1);
+
+    // compare masks are -1, subtracting them counts per lane
+    auto opaque_count = _mm_setzero_si128();
+    auto partial_count = _mm_setzero_si128();
+    usize i = 0;
+    for (; i + 4 <= texels; i += 4) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 4));
+        const auto alpha = _mm_srli_epi32(v, 24);
+        opaque_count = _mm_sub_epi32(opaque_count, _mm_cmpeq_epi32(alpha, opaque));
+        const auto partial =
+            _mm_and_si128(_mm_cmpgt_epi32(alpha, lower), _mm_cmplt_epi32(alpha, upper));
+        partial_count = _mm_sub_epi32(partial_count, partial);
+    }
+
+    alignas(16) std::array<u32, 4> opaque_lanes{};
+    alignas(16) std::array<u32, 4> partial_lanes{};
+    _mm_store_si128(reinterpret_cast<__m128i*>(opaque_lanes.data()), opaque_count);
+    _mm_store_si128(reinterpret_cast<__m128i*>(partial_lanes.data()), partial_count);
+
+    auto count = count_alpha_scalar(rgba + i * 4, texels - i, partial_min, partial_max);
+    count.non_opaque += i;
+    for (usize lane = 0; lane < 4; lane++) {
+        count.non_opaque -= opaque_lanes[lane];
+        count.partial += partial_lanes[lane];
+    }
+    return count;
+}
+
+void expand_rgb_to_rgba_sse2(const u8* rgb, u8* rgba, usize texels) {
+    const auto rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    const auto alpha = _mm_set1_epi32(static_cast<i32>(0xFF000000));
+
+    // 16 bytes are loaded for 12 bytes of texels, stop before reading past
+    // the end of the source
+    usize i = 0;
+    for (; i + 6 <= texels; i += 4) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3));
+        const auto t01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+        const auto t23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+        const auto rgb_texels = _mm_and_si128(_mm_unpacklo_epi64(t01, t23), rgb_mask);
+        const auto out = _mm_or_si128(rgb_texels, alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), out);
+    }
+    expand_rgb_to_rgba_scalar(rgb + i * 3, rgba + i * 4, texels - i);
+}
+
+// (c * a + 127) / 255 for two texels widened to 16 bits. the alpha lane is
+// multiplied by 255, which leaves it unchanged.
+__m128i premultiply_epi16(__m128i texels) {
+    const auto color_mask = _mm_set1_epi64x(0x0000FFFFFFFFFFFF);
+    const auto alpha_one = _mm_set1_epi64x(0x00FF000000000000);
+    const auto half = _mm_set1_epi16(128);
+
+    const auto alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(texels, 0xFF), 0xFF);
+    const auto factor = _mm_or_si128(_mm_and_si128(alpha, color_mask), alpha_one);
+    const auto t = _mm_add_epi16(_mm_mullo_epi16(texels, factor), half);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+void premultiply_alpha_sse2(u8* rgba, usize texels) {
+    const auto zero = _mm_setzero_si128();
+    usize i = 0;
+    for (; i + 4 <= texels; i += 4) {
+        auto* ptr = reinterpret_cast<__m128i*>(rgba + i * 4);
+        const auto v = _mm_loadu_si128(ptr);
+        const auto lo = premultiply_epi16(_mm_unpacklo_epi8(v, zero));
+        const auto hi = premultiply_epi16(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128(ptr, _mm_packus_epi16(lo, hi));
+    }
+    premultiply_alpha_scalar(rgba + i * 4, texels - i);
+}
+
+// sums the two texels in each 64-bit half of `v` (16-bit channels)
+__m128i sum_texel_pairs(__m128i v) {
+    return _mm_add_epi16(v, _mm_srli_si128(v, 8));
+}
+
+void downsample_row_sse2(const u8* row0, const u8* row1, u32 width, u32 dst_width, u8* out) {
+    const auto zero = _mm_setzero_si128();
+    const auto round = _mm_set1_epi16(2);
+
+    // 8 texels of both rows become 4 output texels
+    u32 x = 0;
+    for (; x + 4 <= dst_width; x += 4) {
+        const auto* a = reinterpret_cast<const __m128i*>(row0 + static_cast<usize>(x) * 8);
+        const auto* b = reinterpret_cast<const __m128i*>(row1 + static_cast<usize>(x) * 8);
+        const auto a0 = _mm_loadu_si128(a);
+        const auto a1 = _mm_loadu_si128(a + 1);
+        const auto b0 = _mm_loadu_si128(b);
+        const auto b1 = _mm_loadu_si128(b + 1);
+
+        const auto s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        const auto s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        const auto s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        const auto s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+        auto lo = _mm_unpacklo_epi64(sum_texel_pairs(s01), sum_texel_pairs(s23));
+        auto hi = _mm_unpacklo_epi64(sum_texel_pairs(s45), sum_texel_pairs(s67));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 2);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 2);
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out + static_cast<usize>(x) * 4),
+            _mm_packus_epi16(lo, hi)
+        );
+    }
+    for (; x < dst_width; x++) {
+        downsample_texel(row0, row1, width, x, false, out + static_cast<usize>(x) * 4);
+    }
+}
+
+void swizzle_rgba8_sse2(u8* rgba, usize texels, std::array<u8, 4> order) {
+    const auto byte_mask = _mm_set1_epi32(0xFF);
+    // std::array drops the vector type's alignment attributes
+    __m128i shifts[4];  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    for (usize c = 0; c < 4; c++) {
+        shifts[c] = _mm_cvtsi32_si128(8 * order[c]);
+    }
+
+    // without a byte shuffle each channel is shifted down, masked and
+    // shifted into its new place
+    usize i = 0;
+    for (; i + 4 <= texels; i += 4) {
+        auto* ptr = reinterpret_cast<__m128i*>(rgba + i * 4);
+        const auto v = _mm_loadu_si128(ptr);
+        const auto c0 = _mm_and_si128(_mm_srl_epi32(v, shifts[0]), byte_mask);
+        const auto c1 = _mm_and_si128(_mm_srl_epi32(v, shifts[1]), byte_mask);
+        const auto c2 = _mm_and_si128(_mm_srl_epi32(v, shifts[2]), byte_mask);
+        const auto c3 = _mm_srl_epi32(v, shifts[3]);
+        const auto lo = _mm_or_si128(c0, _mm_slli_epi32(c1, 8));
+        const auto hi = _mm_or_si128(_mm_slli_epi32(c2, 16), _mm_slli_epi32(c3, 24));
+        _mm_storeu_si128(ptr, _mm_or_si128(lo, hi));
+    }
+    swizzle_rgba8_scalar(rgba + i * 4, texels - i, order);
+}
+
+void bc_block_bounds_sse2(const u8* block, std::array<u8, 4>& lo, std::array<u8, 4>& hi) {
+    const auto* src = reinterpret_cast<const __m128i*>(block);
+    const auto v0 = _mm_loadu_si128(src);
+    const auto v1 = _mm_loadu_si128(src + 1);
+    const auto v2 = _mm_loadu_si128(src + 2);
+    const auto v3 = _mm_loadu_si128(src + 3);
+    auto min = _mm_min_epu8(_mm_min_epu8(v0, v1), _mm_min_epu8(v2, v3));
+    auto max = _mm_max_epu8(_mm_max_epu8(v0, v1), _mm_max_epu8(v2, v3));
+
+    // fold the four texels of each register onto the first one
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 8));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 8));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 4));
+    const auto min_texel = static_cast<u32>(_mm_cvtsi128_si32(min));
+    const auto max_texel = static_cast<u32>(_mm_cvtsi128_si32(max));
+    std::memcpy(lo.data(), &min_texel, lo.size());
+    std::memcpy(hi.data(), &max_texel, hi.size());
+}
+
+u32 bc1_indices_sse2(const u8* block, const BcPalette& palette) {
+    const auto zero = _mm_setzero_si128();
+    // alpha is cleared so that it does not add to the distance
+    const auto rgb_mask = _mm_set1_epi64x(0x0000FFFFFFFFFFFF);
+    // std::array drops the vector type's alignment attributes
+    __m128i colors[4];  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    for (usize p = 0; p < 4; p++) {
+        const auto r = static_cast<i16>(palette[p][0]);
+        const auto g = static_cast<i16>(palette[p][1]);
+        const auto b = static_cast<i16>(palette[p][2]);
+        colors[p] = _mm_setr_epi16(r, g, b, 0, r, g, b, 0);
+    }
+
+    u32 indices{};
+    for (u32 i = 0; i < 16; i += 4) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 4));
+        const auto lo = _mm_and_si128(_mm_unpacklo_epi8(v, zero), rgb_mask);
+        const auto hi = _mm_and_si128(_mm_unpackhi_epi8(v, zero), rgb_mask);
+
+        // squared distances of the 4 texels to every color. madd leaves
+        // `r^2 + g^2` and `b^2` per texel, which are added pairwise.
+        __m128i dist[4];  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+        for (usize p = 0; p < 4; p++) {
+            const auto dl = _mm_sub_epi16(lo, colors[p]);
+            const auto dh = _mm_sub_epi16(hi, colors[p]);
+            auto sl = _mm_madd_epi16(dl, dl);
+            auto sh = _mm_madd_epi16(dh, dh);
+            sl = _mm_add_epi32(sl, _mm_srli_epi64(sl, 32));
+            sh = _mm_add_epi32(sh, _mm_srli_epi64(sh, 32));
+            dist[p] = _mm_castps_si128(_mm_shuffle_ps(
+                _mm_castsi128_ps(sl),
+                _mm_castsi128_ps(sh),
+                _MM_SHUFFLE(2, 0, 2, 0)
+            ));
+        }
+
+        // strictly closer colors replace the best one, like the reference
+        auto best = dist[0];
+        auto best_idx = zero;
+        for (usize p = 1; p < 4; p++) {
+            const auto closer = _mm_cmplt_epi32(dist[p], best);
+            best = _mm_or_si128(_mm_and_si128(closer, dist[p]), _mm_andnot_si128(closer, best));
+            const auto idx = _mm_and_si128(closer, _mm_set1_epi32(static_cast<i32>(p)));
+            best_idx = _mm_or_si128(idx, _mm_andnot_si128(closer, best_idx));
+        }
+
+        alignas(16) std::array<u32, 4> lanes{};
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes.data()), best_idx);
+        for (u32 lane = 0; lane < 4; lane++) {
+            indices |= lanes[lane] << ((i + lane) * 2);
+        }
+    }
+    return indices;
+}
+
+u64 bc4_indices_sse2(const u8* block, usize channel, const std::array<u8, 8>& palette) {
+    // gather the channel of all 16 texels into one register
+    const auto* src = reinterpret_cast<const __m128i*>(block);
+    const auto shift = _mm_cvtsi32_si128(static_cast<i32>(8 * channel));
+    const auto byte_mask = _mm_set1_epi32(0xFF);
+    __m128i words[4];  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    for (usize i = 0; i < 4; i++) {
+        words[i] = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(src + i), shift), byte_mask);
+    }
+    const auto values = _mm_packus_epi16(
+        _mm_packs_epi32(words[0], words[1]),
+        _mm_packs_epi32(words[2], words[3])
+    );
+
+    // |a - b| of unsigned bytes is the sum of both saturated differences. a
+    // value is strictly closer when the minimum is not the current best.
+    auto best = _mm_set1_epi8(-1);
+    auto best_idx = _mm_setzero_si128();
+    for (usize p = 0; p < 8; p++) {
+        const auto value = _mm_set1_epi8(static_cast<i8>(palette[p]));
+        const auto dist = _mm_or_si128(_mm_subs_epu8(values, value), _mm_subs_epu8(value, values));
+        const auto min = _mm_min_epu8(dist, best);
+        const auto kept = _mm_cmpeq_epi8(min, best);
+        const auto idx = _mm_andnot_si128(kept, _mm_set1_epi8(static_cast<i8>(p)));
+        best_idx = _mm_or_si128(idx, _mm_and_si128(kept, best_idx));
+        best = min;
+    }
+
+    alignas(16) std::array<u8, 16> lanes{};
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes.data()), best_idx);
+    u64 indices{};
+    for (u32 i = 0; i < 16; i++) {
+        indices |= static_cast<u64>(lanes[i]) << (i * 3);
+    }
+    return indices;
+}
+
+// =====
+// AVX2
+// =====
+
+HVK_TARGET_AVX2
+AlphaCount count_alpha_avx2(const u8* rgba, usize texels, u8 partial_min, u8 partial_max) {
+    const auto opaque = _mm256_set1_epi32(255);
+    const auto lower = _mm256_set1_epi32(static_cast<i32>(partial_min) - 1);
+    const auto upper = _mm256_set1_epi32(static_cast<i32>(partial_max) + 1);
+
+    auto opaque_count = _mm256_setzero_si256();
+    auto partial_count = _mm256_setzero_si256();
+    usize i = 0;
+    for (; i + 8 <= texels; i += 8) {
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + i * 4));
+        const auto alpha = _mm256_srli_epi32(v, 24);
+        opaque_count = _mm256_sub_epi32(opaque_count, _mm256_cmpeq_epi32(alpha, opaque));
+        const auto partial =
+            _mm256_and_si256(_mm256_cmpgt_epi32(alpha, lower), _mm256_cmpgt_epi32(upper, alpha));
+        partial_count = _mm256_sub_epi32(partial_count, partial);
+    }
+
+    alignas(32) std::array<u32, 8> opaque_lanes{};
+    alignas(32) std::array<u32, 8> partial_lanes{};
+    _mm256_store_si256(reinterpret_cast<__m256i*>(opaque_lanes.data()), opaque_count);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(partial_lanes.data()), partial_count);
+
+    auto count = count_alpha_scalar(rgba + i * 4, texels - i, partial_min, partial_max);
+    count.non_opaque += i;
+    for (usize lane = 0; lane < 8; lane++) {
+        count.non_opaque -= opaque_lanes[lane];
+        count.partial += partial_lanes[lane];
+    }
+    return count;
+}
+
+HVK_TARGET_AVX2
+void expand_rgb_to_rgba_avx2(const u8* rgb, u8* rgba, usize texels) {
+    const auto shuffle = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+    );
+    const auto alpha = _mm256_set1_epi32(static_cast<i32>(0xFF000000));
+
+    // each lane takes 4 texels from its own (overlapping) 16 byte load
+    usize i = 0;
+    for (; i + 10 <= texels; i += 8) {
+        const auto* src = rgb + i * 3;
+        const auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const auto hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12));
+        const auto v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        const auto out = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4), out);
+    }
+    expand_rgb_to_rgba_scalar(rgb + i * 3, rgba + i * 4, texels - i);
+}
+
+HVK_TARGET_AVX2
+__m256i premultiply_epi16_avx2(__m256i texels) {
+    const auto color_mask = _mm256_set1_epi64x(0x0000FFFFFFFFFFFF);
+    const auto alpha_one = _mm256_set1_epi64x(0x00FF000000000000);
+    const auto half = _mm256_set1_epi16(128);
+
+    const auto alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(texels, 0xFF), 0xFF);
+    const auto factor = _mm256_or_si256(_mm256_and_si256(alpha, color_mask), alpha_one);
+    const auto t = _mm256_add_epi16(_mm256_mullo_epi16(texels, factor), half);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+HVK_TARGET_AVX2
+void premultiply_alpha_avx2(u8* rgba, usize texels) {
+    const auto zero = _mm256_setzero_si256();
+    usize i = 0;
+    for (; i + 8 <= texels; i += 8) {
+        auto* ptr = reinterpret_cast<__m256i*>(rgba + i * 4);
+        const auto v = _mm256_loadu_si256(ptr);
+        const auto lo = premultiply_epi16_avx2(_mm256_unpacklo_epi8(v, zero));
+        const auto hi = premultiply_epi16_avx2(_mm256_unpackhi_epi8(v, zero));
+        _mm256_storeu_si256(ptr, _mm256_packus_epi16(lo, hi));
+    }
+    premultiply_alpha_scalar(rgba + i * 4, texels - i);
+}
+
+HVK_TARGET_AVX2
+__m256i sum_texel_pairs_avx2(__m256i v) {
+    return _mm256_add_epi16(v, _mm256_srli_si256(v, 8));
+}
+
+HVK_TARGET_AVX2
+void downsample_row_avx2(const u8* row0, const u8* row1, u32 width, u32 dst_width, u8* out) {
+    const auto zero = _mm256_setzero_si256();
+    const auto round = _mm256_set1_epi16(2);
+
+    // 16 texels of both rows become 8 output texels. unpacking works per
+    // 128-bit lane, so the packed result has its middle quarters swapped.
+    u32 x = 0;
+    for (; x + 8 <= dst_width; x += 8) {
+        const auto* a = reinterpret_cast<const __m256i*>(row0 + static_cast<usize>(x) * 8);
+        const auto* b = reinterpret_cast<const __m256i*>(row1 + static_cast<usize>(x) * 8);
+        const auto a0 = _mm256_loadu_si256(a);
+        const auto a1 = _mm256_loadu_si256(a + 1);
+        const auto b0 = _mm256_loadu_si256(b);
+        const auto b1 = _mm256_loadu_si256(b + 1);
+
+        const auto s0 =
+            _mm256_add_epi16(_mm256_unpacklo_epi8(a0, zero), _mm256_unpacklo_epi8(b0, zero));
+        const auto s1 =
+            _mm256_add_epi16(_mm256_unpackhi_epi8(a0, zero), _mm256_unpackhi_epi8(b0, zero));
+        const auto s2 =
+            _mm256_add_epi16(_mm256_unpacklo_epi8(a1, zero), _mm256_unpacklo_epi8(b1, zero));
+        const auto s3 =
+            _mm256_add_epi16(_mm256_unpackhi_epi8(a1, zero), _mm256_unpackhi_epi8(b1, zero));
+
+        auto lo = _mm256_unpacklo_epi64(sum_texel_pairs_avx2(s0), sum_texel_pairs_avx2(s1));
+        auto hi = _mm256_unpacklo_epi64(sum_texel_pairs_avx2(s2), sum_texel_pairs_avx2(s3));
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 2);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 2);
+        const auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + static_cast<usize>(x) * 4), packed);
+    }
+    for (; x < dst_width; x++) {
+        downsample_texel(row0, row1, width, x, false, out + static_cast<usize>(x) * 4);
+    }
+}
+
+// decodes with gathers from the sRGB table, accumulating in the same order
+// as `downsample_texel` so the results match it exactly
+HVK_TARGET_AVX2
+void downsample_row_srgb_avx2(
+    const u8* row0,
+    const u8* row1,
+    u32 width,
+    u32 dst_width,
+    u8* out
+) {
+    const auto* decode = srgb_decode_lut().data();
+    const auto* encode = reinterpret_cast<const i32*>(srgb_encode_lut().data());
+    const auto quarter = _mm256_set1_ps(0.25f);
+    const auto scale = _mm256_set1_ps(SRGB_ENCODE_SCALE);
+    const auto half = _mm256_set1_ps(0.5f);
+    const auto max_index = _mm256_set1_epi32(static_cast<i32>(SRGB_ENCODE_STEPS - 1));
+    const auto round = _mm256_set1_epi32(2);
+
+    // 4 texels of both rows become 2 output texels, one per 128-bit lane
+    u32 x = 0;
+    for (; x + 2 <= dst_width; x += 2) {
+        // even texels in the low half, odd texels in the high half
+        const auto split = [&](const u8* row) {
+            const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 8));
+            return _mm_shuffle_epi32(v, 0xD8);
+        };
+        const auto r0 = split(row0);
+        const auto r1 = split(row1);
+        const __m256i texels[] = {  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+            _mm256_cvtepu8_epi32(r0),
+            _mm256_cvtepu8_epi32(_mm_srli_si128(r0, 8)),
+            _mm256_cvtepu8_epi32(r1),
+            _mm256_cvtepu8_epi32(_mm_srli_si128(r1, 8)),
+        };
+
+        auto sum = _mm256_i32gather_ps(decode, texels[0], 4);
+        auto alpha = texels[0];
+        for (usize t = 1; t < std::size(texels); t++) {
+            sum = _mm256_add_ps(sum, _mm256_i32gather_ps(decode, texels[t], 4));
+            alpha = _mm256_add_epi32(alpha, texels[t]);
+        }
+        const auto average = _mm256_mul_ps(sum, quarter);
+        const auto scaled = _mm256_add_ps(_mm256_mul_ps(average, scale), half);
+        const auto index = _mm256_min_epi32(_mm256_cvttps_epi32(scaled), max_index);
+        const auto color = _mm256_i32gather_epi32(encode, index, 4);
+        alpha = _mm256_srli_epi32(_mm256_add_epi32(alpha, round), 2);
+
+        const auto result = _mm256_blend_epi32(color, alpha, 0x88);
+        const auto packed = _mm256_packus_epi16(_mm256_packus_epi32(result, result), result);
+        const auto lo = _mm_cvtsi128_si32(_mm256_castsi256_si128(packed));
+        const auto hi = _mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1));
+        std::memcpy(out + static_cast<usize>(x) * 4, &lo, 4);
+        std::memcpy(out + static_cast<usize>(x) * 4 + 4, &hi, 4);
+    }
+    for (; x < dst_width; x++) {
+        downsample_texel(row0, row1, width, x, true, out + static_cast<usize>(x) * 4);
+    }
+}
+
+HVK_TARGET_AVX2
+void swizzle_rgba8_avx2(u8* rgba, usize texels, std::array<u8, 4> order) {
+    alignas(32) std::array<i8, 32> indices{};
+    for (usize i = 0; i < indices.size(); i++) {
+        indices[i] = static_cast<i8>((i % 16) / 4 * 4 + order[i % 4]);
+    }
+    const auto shuffle = _mm256_load_si256(reinterpret_cast<const __m256i*>(indices.data()));
+
+    usize i = 0;
+    for (; i + 8 <= texels; i += 8) {
+        auto* ptr = reinterpret_cast<__m256i*>(rgba + i * 4);
+        _mm256_storeu_si256(ptr, _mm256_shuffle_epi8(_mm256_loadu_si256(ptr), shuffle));
+    }
+    swizzle_rgba8_scalar(rgba + i * 4, texels - i, order);
+}
+
+#endif
+
+// ============
+// DISPATCHING
+// ============
+
+AlphaCount count_alpha(const u8* rgba, usize texels, u8 partial_min, u8 partial_max) {
+    switch (simd_level()) {
+#if defined(HVK_SIMD_X86)
+        case SimdLevel::AVX2:
+            return count_alpha_avx2(rgba, texels, partial_min, partial_max);
+        case SimdLevel::SSE2:
+            return count_alpha_sse2(rgba, texels, partial_min, partial_max);
+#endif
+        default:
+            return count_alpha_scalar(rgba, texels, partial_min, partial_max);
+    }
+}
+
+void expand_rgb_to_rgba(const u8* rgb, u8* rgba, usize texels) {
+    switch (simd_level()) {
+#if defined(HVK_SIMD_X86)
+        case SimdLevel::AVX2:
+            expand_rgb_to_rgba_avx2(rgb, rgba, texels);
+            return;
+        case SimdLevel::SSE2:
+            expand_rgb_to_rgba_sse2(rgb, rgba, texels);
+            return;
+#endif
+        default:
+            expand_rgb_to_rgba_scalar(rgb, rgba, texels);
+    }
+}
+
+void premultiply_alpha(u8* rgba, usize texels) {
+    switch (simd_level()) {
+#if defined(HVK_SIMD_X86)
+        case SimdLevel::AVX2:
+            premultiply_alpha_avx2(rgba, texels);
+            return;
+        case SimdLevel::SSE2:
+            premultiply_alpha_sse2(rgba, texels);
+            return;
+#endif
+        default:
+            premultiply_alpha_scalar(rgba, texels);
+    }
+}
+
+void downsample_2x2_rgba8(const u8* src, u32 width, u32 height, bool srgb, u8* dst) {
+    const auto level = simd_level();
+    // sRGB needs gathers to vectorize, SSE2 falls back to the reference
+    if (level == SimdLevel::Scalar || width < 2 || (srgb && level != SimdLevel::AVX2)) {
+        downsample_2x2_rgba8_scalar(src, width, height, srgb, dst);
+        return;
+    }
+
+#if defined(HVK_SIMD_X86)
+    const auto dst_width = width / 2;
+    const auto dst_height = std::max(height / 2, 1u);
+    for (u32 y = 0; y < dst_height; y++) {
+        const u8* row0 = src + static_cast<usize>(std::min(2 * y, height - 1)) * width * 4;
+        const u8* row1 = src + static_cast<usize>(std::min(2 * y + 1, height - 1)) * width * 4;
+        u8* out = dst + static_cast<usize>(y) * dst_width * 4;
+        if (srgb) {
+            downsample_row_srgb_avx2(row0, row1, width, dst_width, out);
+        } else if (level == SimdLevel::AVX2) {
+            downsample_row_avx2(row0, row1, width, dst_width, out);
+        } else {
+            downsample_row_sse2(row0, row1, width, dst_width, out);
+        }
+    }
+#endif
+}
+
+void swizzle_rgba8(u8* rgba, usize texels, std::array<u8, 4> order) {
+    HVK_ASSERT(
+        std::all_of(order.begin(), order.end(), [](u8 c) { return c < 4; }),
+        "Swizzle channels must be in the range [0, 3]"
+    );
+    switch (simd_level()) {
+#if defined(HVK_SIMD_X86)
+        case SimdLevel::AVX2:
+            swizzle_rgba8_avx2(rgba, texels, order);
+            return;
+        case SimdLevel::SSE2:
+            swizzle_rgba8_sse2(rgba, texels, order);
+            return;
+#endif
+        default:
+            swizzle_rgba8_scalar(rgba, texels, order);
+    }
+}
+
+void bc_block_bounds(const u8* block, std::array<u8, 4>& lo, std::array<u8, 4>& hi) {
+#if defined(HVK_SIMD_X86)
+    if (simd_level() != SimdLevel::Scalar) {
+        bc_block_bounds_sse2(block, lo, hi);
+        return;
+    }
+#endif
+    bc_block_bounds_scalar(block, lo, hi);
+}
+
+u32 bc1_indices(const u8* block, const BcPalette& palette) {
+#if defined(HVK_SIMD_X86)
+    if (simd_level() != SimdLevel::Scalar) {
+        return bc1_indices_sse2(block, palette);
+    }
+#endif
+    return bc1_indices_scalar(block, palette);
+}
+
+u64 bc4_indices(const u8* block, usize channel, const std::array<u8, 8>& palette) {
+#if defined(HVK_SIMD_X86)
+    if (simd_level() != SimdLevel::Scalar) {
+        return bc4_indices_sse2(block, channel, palette);
+    }
+#endif
+    return bc4_indices_scalar(block, channel, palette);
+}
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+}  // namespace hvk
@@ -0,0 +1,134 @@
+#include <algorithm>
+
+#include "hvk/render_queue.hpp"
+
+namespace hvk {
+
+RenderQueueType queue_type(AlphaMode mode) {
+    switch (mode) {
+        case AlphaMode::Mask:
+            return RenderQueueType::AlphaTest;
+        case AlphaMode::Blend:
+            return RenderQueueType::Transparent;
+        default:
+            return RenderQueueType::Opaque;
+    }
+}
+
+void RenderQueue::clear() noexcept {
+    _items.clear();
+    _sorted = false;
+}
+
+void RenderQueue::push(u32 model, u32 node) {
+    _items.push_back({model, node, 0.0f});
+    _sorted = false;
+}
+
+void RenderQueue::sort() {
+    const auto order = _order;
+    auto before = [order](const RenderItem& a, const RenderItem& b) {
+        return order == SortOrder::FrontToBack ? a.distance < b.distance
+                                               : a.distance > b.distance;
+    };
+
+    if (!_sorted) {
+        std::stable_sort(_items.begin(), _items.end(), before);
+        _sorted = true;
+        return;
+    }
+
+    // close to linear when the previous order is nearly correct, which is the
+    // common case for a camera that moves a little each frame. every shift
+    // fixes one inversion, so the work is bounded and a badly shuffled queue
+    // is sorted from scratch instead of going quadratic.
+    const usize budget = _items.size() * RENDER_QUEUE_SHIFT_LIMIT;
+    usize shifts{};
+    for (usize i = 1; i < _items.size(); i++) {
+        auto item = _items[i];
+        auto j = i;
+        while (j > 0 && before(item, _items[j - 1])) {
+            _items[j] = _items[j - 1];
+            j--;
+        }
+        _items[j] = item;
+
+        shifts += i - j;
+        if (shifts > budget) {
+            std::sort(_items.begin(), _items.end(), before);
+            return;
+        }
+    }
+}
+
+void RenderQueue::invalidate() noexcept {
+    _sorted = false;
+}
+
+std::vector<RenderItem>& RenderQueue::items() noexcept {
+    return _items;
+}
+
+const std::vector<RenderItem>& RenderQueue::items() const noexcept {
+    return _items;
+}
+
+void RenderQueues::update(const Scene& scene, const RenderSnapshot& snapshot) {
+    const auto& models = scene.models();
+    usize node_count{};
+    for (const auto& model : models) {
+        node_count += model.nodes().size();
+    }
+    if (models.size() != _model_count || node_count != _node_count) {
+        rebuild(scene);
+    }
+
+    // after a camera cut nearly every item changes places
+    const auto eye = snapshot.camera.pos;
+    const bool cut = glm::distance(eye, _eye) > RENDER_QUEUE_CUT_DISTANCE;
+    _eye = eye;
+    for (auto& queue : _queues) {
+        if (cut) {
+            queue.invalidate();
+        }
+        for (auto& item : queue.items()) {
+            const auto& model = models[item.model];
+            const auto center = model.node_center(model.nodes()[item.node]);
+            // object transforms are stored as the top rows of the model matrix
+            const auto world = glm::vec4{center, 1.0f} * snapshot.objects[item.model].transform;
+            const auto offset = glm::vec3{world} - eye;
+            item.distance = glm::dot(offset, offset);
+        }
+        queue.sort();
+    }
+}
+
+const RenderQueue& RenderQueues::queue(RenderQueueType type) const {
+    return _queues.at(static_cast<usize>(type));
+}
+
+const std::array<RenderQueue, RENDER_QUEUE_COUNT>& RenderQueues::queues() const noexcept {
+    return _queues;
+}
+
+void RenderQueues::rebuild(const Scene& scene) {
+    spdlog::trace("Rebuilding render queues");
+
+    for (auto& queue : _queues) {
+        queue.clear();
+    }
+
+    const auto& models = scene.models();
+    _node_count = 0;
+    for (u32 i = 0; i < static_cast<u32>(models.size()); i++) {
+        const auto& nodes = models[i].nodes();
+        for (u32 j = 0; j < static_cast<u32>(nodes.size()); j++) {
+            const auto type = queue_type(nodes[j].material->alpha_mode);
+            _queues.at(static_cast<usize>(type)).push(i, j);
+        }
+        _node_count += nodes.size();
+    }
+    _model_count = models.size();
+}
+
+}  // namespace hvk
@@ -0,0 +1,62 @@
+#include "hvk/sampler_cache.hpp"
+#include "hvk/vk_context.hpp"
+
+namespace hvk {
+
+usize SamplerKeyHash::operator()(const vk::SamplerCreateInfo& info) const noexcept {
+    usize seed{};
+    hash_combine(seed, static_cast<VkSamplerCreateFlags>(info.flags));
+    hash_combine(seed, static_cast<VkFilter>(info.magFilter));
+    hash_combine(seed, static_cast<VkFilter>(info.minFilter));
+    hash_combine(seed, static_cast<VkSamplerMipmapMode>(info.mipmapMode));
+    hash_combine(seed, static_cast<VkSamplerAddressMode>(info.addressModeU));
+    hash_combine(seed, static_cast<VkSamplerAddressMode>(info.addressModeV));
+    hash_combine(seed, static_cast<VkSamplerAddressMode>(info.addressModeW));
+    hash_combine(seed, info.mipLodBias);
+    hash_combine(seed, info.anisotropyEnable);
+    hash_combine(seed, info.maxAnisotropy);
+    hash_combine(seed, info.compareEnable);
+    hash_combine(seed, static_cast<VkCompareOp>(info.compareOp));
+    hash_combine(seed, info.minLod);
+    hash_combine(seed, info.maxLod);
+    hash_combine(seed, static_cast<VkBorderColor>(info.borderColor));
+    hash_combine(seed, info.unnormalizedCoordinates);
+    return seed;
+}
+
+vk::Sampler SamplerCache::sampler(const vk::SamplerCreateInfo& info) {
+    // chained structs would have to be compared by content, not by pointer
+    HVK_ASSERT(
+        info.pNext == nullptr,
+        "Extended sampler create info is not supported by the sampler cache"
+    );
+
+    std::lock_guard lock{_mutex};
+    auto it = _samplers.find(info);
+    if (it != _samplers.end()) {
+        return it->second.get();
+    }
+
+    spdlog::trace(
+        "Creating sampler: filter={}, mode={}, samplers={}",
+        vk::to_string(info.minFilter),
+        vk::to_string(info.addressModeU),
+        _samplers.size() + 1
+    );
+    auto sampler = VulkanContext::device().createSamplerUnique(info);
+    auto handle = sampler.get();
+    _samplers.emplace(info, std::move(sampler));
+    return handle;
+}
+
+usize SamplerCache::size() {
+    std::lock_guard lock{_mutex};
+    return _samplers.size();
+}
+
+void SamplerCache::clear() {
+    std::lock_guard lock{_mutex};
+    _samplers.clear();
+}
+
+}  // namespace hvk
@@ -1,31 +1,438 @@
+#include <cstddef>
+
+namespace hvk {
+
+void* stbi_hook_malloc(std::size_t size);
+void* stbi_hook_realloc(void* ptr, std::size_t size);
+void stbi_hook_free(void* ptr);
+
+}  // namespace hvk
+
+// stb allocates its own output buffer, these hooks let `stage_image`
+// offer it staging memory to decode into instead
+#define STBI_MALLOC(size) hvk::stbi_hook_malloc(size)
+#define STBI_REALLOC(ptr, size) hvk::stbi_hook_realloc(ptr, size)
+#define STBI_FREE(ptr) hvk::stbi_hook_free(ptr)
 #define STB_IMAGE_IMPLEMENTATION
 #include "hvk/texture.hpp"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include "hvk/content_hash.hpp"
+#include "hvk/pixel_kernels.hpp"
 #include "hvk/vk_context.hpp"
 
 namespace hvk {
 
+bool is_srgb(vk::Format format) {
+    return format == vk::Format::eR8G8B8A8Srgb || format == vk::Format::eB8G8R8A8Srgb;
+}
+
+bool is_bgra8(vk::Format format) {
+    return format == vk::Format::eB8G8R8A8Srgb || format == vk::Format::eB8G8R8A8Unorm;
+}
+
+bool is_rgba8(vk::Format format) {
+    switch (format) {
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eB8G8R8A8Srgb:
+        case vk::Format::eB8G8R8A8Unorm:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// blitting between mip levels needs linear filtering on the source format
+bool supports_linear_blit(vk::Format format) {
+    const auto features = VulkanContext::gpu().getFormatProperties(format).optimalTilingFeatures;
+    const auto required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst
+        | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    return (features & required) == required;
+}
+
+// output buffer offered to stb on this thread, handed out for the first
+// allocation of exactly its size
+struct StbiTarget {
+    u8* data{};
+    usize size{};
+    bool taken{};
+};
+
+thread_local StbiTarget stbi_target{};
+
+// NOLINTBEGIN(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory)
+void* stbi_hook_malloc(std::size_t size) {
+    auto& target = stbi_target;
+    if (target.data && !target.taken && size == target.size) {
+        target.taken = true;
+        return target.data;
+    }
+    return std::malloc(size);
+}
+
+void* stbi_hook_realloc(void* ptr, std::size_t size) {
+    auto& target = stbi_target;
+    if (!ptr || ptr != target.data) {
+        return std::realloc(ptr, size);
+    }
+    if (size <= target.size) {
+        return ptr;
+    }
+
+    // stb is growing the buffer it was given, move it out of staging memory
+    auto* moved = std::malloc(size);
+    if (moved) {
+        std::memcpy(moved, ptr, target.size);
+        target.taken = false;
+    }
+    return moved;
+}
+
+void stbi_hook_free(void* ptr) {
+    auto& target = stbi_target;
+    if (ptr && ptr == target.data) {
+        target.taken = false;
+        return;
+    }
+    std::free(ptr);
+}
+// NOLINTEND(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory)
+
+AlphaInfo alpha_info(AlphaCount count, usize texels) {
+    // filtered cutout edges have some partial alpha, only count the image as
+    // translucent when a noticeable fraction of it is
+    return {count.non_opaque > 0, count.partial > texels / TRANSLUCENT_TEXEL_RATIO};
+}
+
+AlphaInfo analyze_alpha(const u8* rgba, usize size) {
+    // check if image has varying alpha, and whether it is mostly binary
+    // (cutout) or has a significant amount of partial coverage
+    const auto texels = size / 4;
+    return alpha_info(
+        count_alpha(rgba, texels, TRANSLUCENT_ALPHA_MIN, TRANSLUCENT_ALPHA_MAX),
+        texels
+    );
+}
+
+// copies RGBA8 texels and analyzes their alpha, in chunks small enough to
+// still be in cache when they are scanned
+AlphaInfo copy_analyze_alpha(const u8* src, u8* dst, usize size) {
+    constexpr usize chunk_texels = 16 * 1024;
+    const auto texels = size / 4;
+
+    AlphaCount total{};
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (usize i = 0; i < texels; i += chunk_texels) {
+        const auto count = std::min(chunk_texels, texels - i);
+        std::memcpy(dst + i * 4, src + i * 4, count * 4);
+        const auto chunk =
+            count_alpha(dst + i * 4, count, TRANSLUCENT_ALPHA_MIN, TRANSLUCENT_ALPHA_MAX);
+        total.non_opaque += chunk.non_opaque;
+        total.partial += chunk.partial;
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return alpha_info(total, texels);
+}
+
+bool is_png(std::span<const u8> bytes) {
+    constexpr std::array<u8, 8> signature = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    return bytes.size() >= signature.size()
+        && std::memcmp(bytes.data(), signature.data(), signature.size()) == 0;
+}
+
+// stb expands RGB to RGBA with a scalar loop, decoding 3 channels and
+// expanding them into staging memory is faster. PNGs are left to stb since
+// a color key (tRNS) can add alpha that the header does not report.
+bool stage_rgb_image(std::span<const u8> bytes, StagedImage& staged) {
+    i32 width{};
+    i32 height{};
+    i32 channels{};
+    auto* pixels = stbi_load_from_memory(
+        bytes.data(),
+        static_cast<i32>(bytes.size()),
+        &width,
+        &height,
+        &channels,
+        STBI_rgb
+    );
+    if (!pixels || static_cast<u32>(width) != staged.width
+        || static_cast<u32>(height) != staged.height) {
+        stbi_image_free(pixels);
+        return false;
+    }
+
+    expand_rgb_to_rgba(pixels, staged.data, static_cast<usize>(staged.width) * staged.height);
+    staged.alpha = {};
+    stbi_image_free(pixels);
+    return true;
+}
+
+std::optional<StagedImage> stage_image_file(const std::filesystem::path& path) {
+    const auto bytes = read_file(path);
+    if (!bytes) {
+        return std::nullopt;
+    }
+    return stage_image(*bytes);
+}
+
+std::optional<StagedImage> stage_image(std::span<const u8> bytes) {
+    // stb takes the length as an int
+    if (bytes.size() > static_cast<usize>(std::numeric_limits<i32>::max())) {
+        return std::nullopt;
+    }
+    const auto length = static_cast<i32>(bytes.size());
+    i32 width{};
+    i32 height{};
+    i32 channels{};
+    if (stbi_info_from_memory(bytes.data(), length, &width, &height, &channels) != 1
+        || width <= 0 || height <= 0) {
+        return std::nullopt;
+    }
+
+    StagedImage staged{};
+    staged.width = static_cast<u32>(width);
+    staged.height = static_cast<u32>(height);
+    const usize size = static_cast<usize>(staged.width) * staged.height * 4;
+
+    auto& allocator = VulkanContext::allocator();
+    void* mapped{};
+    staged.buffer = allocator.create_mapped_staging_buffer(size, &mapped);
+    staged.data = static_cast<u8*>(mapped);
+
+    if (channels == 3 && !is_png(bytes)) {
+        if (!stage_rgb_image(bytes, staged)) {
+            allocator.destroy(staged.buffer);
+            return std::nullopt;
+        }
+        allocator.flush(staged.buffer);
+        return staged;
+    }
+
+    stbi_target = {staged.data, size, false};
+    auto* pixels =
+        stbi_load_from_memory(bytes.data(), length, &width, &height, &channels, STBI_rgb_alpha);
+    stbi_target = {};
+
+    if (!pixels || static_cast<u32>(width) != staged.width
+        || static_cast<u32>(height) != staged.height) {
+        if (pixels && pixels != staged.data) {
+            stbi_image_free(pixels);
+        }
+        allocator.destroy(staged.buffer);
+        return std::nullopt;
+    }
+
+    if (pixels == staged.data) {
+        staged.alpha = analyze_alpha(staged.data, size);
+    } else {
+        // an intermediate buffer of the same size took the staging memory,
+        // move the result over while scanning it
+        staged.alpha = copy_analyze_alpha(pixels, staged.data, size);
+        stbi_image_free(pixels);
+    }
+    allocator.flush(staged.buffer);
+
+    return staged;
+}
+
+std::vector<u8> downsample_rgba8(const u8* src, u32 width, u32 height, bool srgb) {
+    const auto dst_width = std::max(width / 2, 1u);
+    const auto dst_height = std::max(height / 2, 1u);
+    std::vector<u8> dst(static_cast<usize>(dst_width) * dst_height * 4);
+    downsample_2x2_rgba8(src, width, height, srgb, dst.data());
+    return dst;
+}
+
+// expects every level in `eTransferDstOptimal`, leaves every level in `layout`
+void generate_mips_blit(
+    const vk::CommandBuffer& cmd,
+    VkImage image,
+    u32 width,
+    u32 height,
+    u32 levels,
+    vk::ImageLayout layout
+) {
+    auto level_barrier = [&](u32 level,
+                             vk::ImageLayout old_layout,
+                             vk::ImageLayout new_layout,
+                             vk::AccessFlags src_access,
+                             vk::AccessFlags dst_access,
+                             vk::PipelineStageFlags dst_stage) {
+        vk::ImageSubresourceRange range{};
+        range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+            .setBaseMipLevel(level)
+            .setLevelCount(1)
+            .setLayerCount(1);
+
+        vk::ImageMemoryBarrier barrier{};
+        barrier.setImage(image)
+            .setSubresourceRange(range)
+            .setOldLayout(old_layout)
+            .setNewLayout(new_layout)
+            .setSrcAccessMask(src_access)
+            .setDstAccessMask(dst_access);
+        cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            dst_stage,
+            {},
+            nullptr,
+            nullptr,
+            barrier
+        );
+    };
+
+    auto src_width = static_cast<i32>(width);
+    auto src_height = static_cast<i32>(height);
+    for (u32 level = 1; level < levels; level++) {
+        // previous level is complete, read from it
+        level_barrier(
+            level - 1,
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ImageLayout::eTransferSrcOptimal,
+            vk::AccessFlagBits::eTransferWrite,
+            vk::AccessFlagBits::eTransferRead,
+            vk::PipelineStageFlagBits::eTransfer
+        );
+
+        const auto dst_width = std::max(src_width / 2, 1);
+        const auto dst_height = std::max(src_height / 2, 1);
+        vk::ImageBlit blit{};
+        blit.setSrcOffsets({vk::Offset3D{0, 0, 0}, vk::Offset3D{src_width, src_height, 1}})
+            .setDstOffsets({vk::Offset3D{0, 0, 0}, vk::Offset3D{dst_width, dst_height, 1}});
+        blit.srcSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+            .setMipLevel(level - 1)
+            .setLayerCount(1);
+        blit.dstSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+            .setMipLevel(level)
+            .setLayerCount(1);
+        cmd.blitImage(
+            image,
+            vk::ImageLayout::eTransferSrcOptimal,
+            image,
+            vk::ImageLayout::eTransferDstOptimal,
+            blit,
+            vk::Filter::eLinear
+        );
+
+        level_barrier(
+            level - 1,
+            vk::ImageLayout::eTransferSrcOptimal,
+            layout,
+            vk::AccessFlagBits::eTransferRead,
+            vk::AccessFlagBits::eShaderRead,
+            vk::PipelineStageFlagBits::eFragmentShader
+        );
+        src_width = dst_width;
+        src_height = dst_height;
+    }
+
+    level_barrier(
+        levels - 1,
+        vk::ImageLayout::eTransferDstOptimal,
+        layout,
+        vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderRead,
+        vk::PipelineStageFlagBits::eFragmentShader
+    );
+}
+
+ImageUploadBatch::ImageUploadBatch() : _cmd{VulkanContext::oneshot()} {}
+
+ImageUploadBatch::~ImageUploadBatch() {
+    if (_cmd) {
+        submit();
+    }
+}
+
+const vk::CommandBuffer& ImageUploadBatch::cmd() const {
+    return _cmd.get();
+}
+
+void ImageUploadBatch::add_staging(AllocatedBuffer buffer) {
+    _staging.push_back(buffer);
+    _staging_size += buffer.size;
+}
+
+usize ImageUploadBatch::staging_size() const noexcept {
+    return _staging_size;
+}
+
+void ImageUploadBatch::require_graphics_queue() noexcept {
+    _graphics = true;
+}
+
+void ImageUploadBatch::submit() {
+    HVK_ASSERT(_cmd, "Image upload batch was already submitted");
+
+    // blits need a graphics queue (the oneshot pool is a graphics pool)
+    const auto& queue =
+        _graphics ? VulkanContext::graphics_queue() : VulkanContext::transfer_queue();
+    VulkanContext::flush_command_buffer(_cmd, queue);
+    _cmd.reset();
+
+    auto& allocator = VulkanContext::allocator();
+    for (auto& staging : _staging) {
+        allocator.destroy(staging);
+    }
+    _staging.clear();
+    _staging_size = 0;
+}
+
 vk::DescriptorImageInfo TextureBase::descriptor_info(vk::ImageLayout layout) const {
     return {
-        _sampler.get(),
+        _sampler,
         _view.get(),
         layout,
     };
 }
 
 const vk::Sampler& TextureBase::sampler() const {
-    return _sampler.get();
+    return _sampler;
 }
 
 const vk::ImageView& TextureBase::image_view() const {
     return _view.get();
 }
 
+VkImage TextureBase::relocate(VmaAllocation allocation, const vk::CommandBuffer& cmd) {
+    auto old = _resource.relocate(allocation, cmd);
+    _view = _resource.create_image_view(_resource.format());
+    return old;
+}
+
+vk::Sampler TextureBase::cached_sampler(vk::Filter filter, vk::SamplerAddressMode addr_mode) {
+    const auto mipmap_mode = filter == vk::Filter::eLinear ? vk::SamplerMipmapMode::eLinear
+                                                           : vk::SamplerMipmapMode::eNearest;
+
+    vk::SamplerCreateInfo info{};
+    info.setMagFilter(filter)
+        .setMinFilter(filter)
+        .setMipmapMode(mipmap_mode)
+        .setAddressModeU(addr_mode)
+        .setAddressModeV(addr_mode)
+        .setAddressModeW(addr_mode)
+        .setMinLod(0.0f)
+        .setMaxLod(VK_LOD_CLAMP_NONE);
+    return VulkanContext::sampler_cache().sampler(info);
+}
+
 ImageResource::ImageResource(ImageResource&& other) noexcept {
     if (this == &other) {
         return;
     }
     std::swap(_image, other._image);
+    std::swap(_info, other._info);
+    std::swap(_layout, other._layout);
     std::swap(_has_alpha, other._has_alpha);
+    std::swap(_is_translucent, other._is_translucent);
+    std::swap(_mip_levels, other._mip_levels);
 }
 
 ImageResource& ImageResource::operator=(ImageResource&& rhs) noexcept {
@@ -35,7 +442,11 @@ ImageResource& ImageResource::operator=(ImageResource&& rhs) noexcept {
 
     destroy();
     std::swap(_image, rhs._image);
+    std::swap(_info, rhs._info);
+    std::swap(_layout, rhs._layout);
     std::swap(_has_alpha, rhs._has_alpha);
+    std::swap(_is_translucent, rhs._is_translucent);
+    std::swap(_mip_levels, rhs._mip_levels);
 
     return *this;
 }
@@ -51,9 +462,8 @@ vk::UniqueImageView ImageResource::create_image_view(
     vk::ImageViewCreateInfo create_info{};
     create_info.setImage(_image.image).setViewType(vk::ImageViewType::e2D).setFormat(format);
 
-    // TODO(bwpge): fix level count for mip chain
     create_info.subresourceRange.setBaseMipLevel(0)
-        .setLevelCount(1)
+        .setLevelCount(_mip_levels)
         .setBaseArrayLayer(0)
         .setLayerCount(1)
         .setAspectMask(aspect_mask);
@@ -61,21 +471,362 @@ vk::UniqueImageView ImageResource::create_image_view(
     return VulkanContext::device().createImageViewUnique(create_info);
 }
 
+ImageResource ImageResource::from_ktx2(
+    const Ktx2Image& ktx,
+    vk::ImageLayout layout,
+    vk::ImageUsageFlags usage,
+    ImageUploadBatch* batch,
+    u32 first_level
+) {
+    HVK_ASSERT(first_level < ktx.levels.size(), "First level must be a level of the image");
+    spdlog::trace(
+        "Loading compressed image: {}x{}, levels {}..{} ({})",
+        ktx.width,
+        ktx.height,
+        first_level,
+        ktx.levels.size(),
+        vk::to_string(ktx.format)
+    );
+    ImageResource resource{};
+
+    // alpha cannot be cheaply inspected in compressed data, use what the
+    // texture cache recorded or fall back to what the format can represent
+    const auto alpha = ktx.metadata.find(std::string{KTX2_ALPHA_KEY});
+    if (alpha != ktx.metadata.end()) {
+        resource._has_alpha = alpha->second != "opaque";
+        resource._is_translucent = alpha->second == "blend";
+    } else {
+        resource._has_alpha = ktx.format != vk::Format::eBc1RgbUnormBlock
+            && ktx.format != vk::Format::eBc1RgbSrgbBlock
+            && ktx.format != vk::Format::eBc5UnormBlock
+            && ktx.format != vk::Format::eBc5SnormBlock;
+    }
+
+    std::vector<ImageLevel> levels{};
+    for (usize i = first_level; i < ktx.levels.size(); i++) {
+        const auto& level = ktx.levels[i];
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        levels.push_back({ktx.data.data() + level.offset, level.size});
+    }
+    resource.upload_levels(
+        levels,
+        static_cast<u32>(levels.size()),
+        std::max(ktx.width >> first_level, 1u),
+        std::max(ktx.height >> first_level, 1u),
+        ktx.format,
+        layout,
+        usage,
+        batch
+    );
+    return resource;
+}
+
+ImageResource ImageResource::from_resident_levels(
+    const Ktx2Image& ktx,
+    u32 first_level,
+    const ImageResource& resident,
+    u32 resident_level,
+    const vk::CommandBuffer& cmd,
+    AllocatedBuffer& staging
+) {
+    const auto level_count = static_cast<u32>(ktx.levels.size());
+    HVK_ASSERT(first_level < level_count, "First level must be a level of the image");
+    HVK_ASSERT(
+        resident._image.image && resident_level + resident._mip_levels == level_count,
+        "Resident image must hold every level from the resident level down"
+    );
+    auto level_extent = [&ktx](u32 level) {
+        return vk::Extent3D{
+            std::max(ktx.width >> level, 1u),
+            std::max(ktx.height >> level, 1u),
+            1,
+        };
+    };
+
+    auto& allocator = VulkanContext::allocator();
+    ImageResource resource{};
+    resource._info = resident._info;
+    resource._info.setExtent(level_extent(first_level)).setMipLevels(level_count - first_level);
+    resource._image =
+        allocator.create_image(resource._info, {}, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+    resource._layout = resident._layout;
+    resource._mip_levels = level_count - first_level;
+    resource._has_alpha = resident._has_alpha;
+    resource._is_translucent = resident._is_translucent;
+
+    // levels sharper than the resident ones come from the system memory copy
+    std::vector<vk::BufferImageCopy> uploads{};
+    if (first_level < resident_level) {
+        usize staging_size{};
+        for (u32 i = first_level; i < resident_level; i++) {
+            staging_size += ktx.levels[i].size;
+        }
+        staging = allocator.create_staging_buffer(staging_size);
+
+        usize offset{};
+        for (u32 i = first_level; i < resident_level; i++) {
+            const auto& level = ktx.levels[i];
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            allocator.copy_mapped(staging, ktx.data.data() + level.offset, level.size, offset);
+
+            vk::BufferImageCopy region{};
+            region.setBufferOffset(offset).setImageExtent(level_extent(i));
+            region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+                .setMipLevel(i - first_level)
+                .setLayerCount(1);
+            uploads.push_back(region);
+            offset += level.size;
+        }
+    }
+
+    // the rest is already on the device
+    const auto copy_level = std::max(first_level, resident_level);
+    std::vector<vk::ImageCopy> copies{};
+    for (u32 i = copy_level; i < level_count; i++) {
+        vk::ImageSubresourceLayers src{};
+        src.setAspectMask(vk::ImageAspectFlagBits::eColor)
+            .setMipLevel(i - resident_level)
+            .setLayerCount(1);
+        vk::ImageSubresourceLayers dst{src};
+        dst.setMipLevel(i - first_level);
+        vk::ImageCopy region{};
+        region.setSrcSubresource(src).setDstSubresource(dst).setExtent(level_extent(i));
+        copies.push_back(region);
+    }
+
+    // frames submitted before `cmd` may still sample the resident image
+    vk::ImageSubresourceRange dst_range{};
+    dst_range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+        .setLayerCount(1)
+        .setLevelCount(resource._mip_levels);
+    vk::ImageSubresourceRange src_range{};
+    src_range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+        .setBaseMipLevel(copy_level - resident_level)
+        .setLayerCount(1)
+        .setLevelCount(level_count - copy_level);
+    std::array<vk::ImageMemoryBarrier, 2> barriers{};
+    barriers[0]
+        .setImage(resident._image.image)
+        .setSubresourceRange(src_range)
+        .setOldLayout(resident._layout)
+        .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+        .setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
+        .setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+    barriers[1]
+        .setImage(resource._image.image)
+        .setSubresourceRange(dst_range)
+        .setOldLayout(vk::ImageLayout::eUndefined)
+        .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+        .setSrcAccessMask({})
+        .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eFragmentShader,
+        vk::PipelineStageFlagBits::eTransfer,
+        {},
+        nullptr,
+        nullptr,
+        barriers
+    );
+
+    if (!uploads.empty()) {
+        cmd.copyBufferToImage(
+            staging.buffer,
+            resource._image.image,
+            vk::ImageLayout::eTransferDstOptimal,
+            uploads
+        );
+    }
+    cmd.copyImage(
+        resident._image.image,
+        vk::ImageLayout::eTransferSrcOptimal,
+        resource._image.image,
+        vk::ImageLayout::eTransferDstOptimal,
+        copies
+    );
+
+    // the resident image is not sampled again, only the new one is transitioned
+    vk::ImageMemoryBarrier barrier{};
+    barrier.setImage(resource._image.image)
+        .setSubresourceRange(dst_range)
+        .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+        .setNewLayout(resource._layout)
+        .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+        .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eFragmentShader,
+        {},
+        nullptr,
+        nullptr,
+        barrier
+    );
+
+    return resource;
+}
+
+ImageResource ImageResource::from_staged(
+    StagedImage& staged,
+    vk::Format format,
+    vk::ImageLayout layout,
+    vk::ImageUsageFlags usage,
+    bool mipmaps,
+    ImageUploadBatch* batch
+) {
+    ImageResource resource{};
+    resource._has_alpha = staged.alpha.has_alpha;
+    resource._is_translucent = staged.alpha.translucent;
+
+    auto staging = std::exchange(staged.buffer, {});
+    auto* data = std::exchange(staged.data, nullptr);
+    if (is_bgra8(format)) {
+        // images are always decoded as RGBA
+        swizzle_rgba8(data, static_cast<usize>(staged.width) * staged.height, {2, 1, 0, 3});
+        VulkanContext::allocator().flush(staging);
+    }
+    const auto levels = mipmaps ? mip_level_count(staged.width, staged.height) : 1;
+    if (levels > 1 && !supports_linear_blit(format)) {
+        // the chain is filtered on the CPU, reading the base level back from
+        // the (host cached) staging memory
+        resource.upload(
+            data,
+            staging.size,
+            staged.width,
+            staged.height,
+            format,
+            layout,
+            usage,
+            mipmaps,
+            batch
+        );
+        VulkanContext::allocator().destroy(staging);
+        return resource;
+    }
+
+    vk::BufferImageCopy region{};
+    region.setBufferOffset(0).setImageExtent({staged.width, staged.height, 1});
+    region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+        .setMipLevel(0)
+        .setBaseArrayLayer(0)
+        .setLayerCount(1);
+    resource.record_upload(
+        staging,
+        {&region, 1},
+        levels,
+        staged.width,
+        staged.height,
+        format,
+        layout,
+        usage,
+        batch
+    );
+    return resource;
+}
+
 void ImageResource::upload(
-    void* data,
+    const void* data,
     usize size,
     u32 width,
     u32 height,
     vk::Format format,
     vk::ImageLayout layout,
-    vk::ImageUsageFlags usage
+    vk::ImageUsageFlags usage,
+    bool mipmaps,
+    ImageUploadBatch* batch
 )  //
 {
+    auto levels = mipmaps ? mip_level_count(width, height) : 1;
+    const bool blit = levels > 1 && supports_linear_blit(format);
+
+    // without linear blits the chain is filtered on the CPU and every level
+    // is uploaded from the same staging buffer
+    std::vector<std::vector<u8>> cpu_mips{};
+    if (levels > 1 && !blit) {
+        if (is_rgba8(format)) {
+            const auto* src = static_cast<const u8*>(data);
+            auto w = width;
+            auto h = height;
+            for (u32 level = 1; level < levels; level++) {
+                cpu_mips.push_back(downsample_rgba8(src, w, h, is_srgb(format)));
+                src = cpu_mips.back().data();
+                w = std::max(w / 2, 1u);
+                h = std::max(h / 2, 1u);
+            }
+        } else {
+            spdlog::warn("Cannot generate mips for format {}", vk::to_string(format));
+            levels = 1;
+        }
+    }
+
+    std::vector<ImageLevel> level_data{{data, size}};
+    for (const auto& mip : cpu_mips) {
+        level_data.push_back({mip.data(), mip.size()});
+    }
+    upload_levels(level_data, levels, width, height, format, layout, usage, batch);
+}
+
+void ImageResource::upload_levels(
+    std::span<const ImageLevel> level_data,
+    u32 levels,
+    u32 width,
+    u32 height,
+    vk::Format format,
+    vk::ImageLayout layout,
+    vk::ImageUsageFlags usage,
+    ImageUploadBatch* batch
+) {
+    HVK_ASSERT(!level_data.empty(), "Cannot upload image without level data");
+    HVK_ASSERT(
+        level_data.size() == levels || level_data.size() == 1,
+        "Either every level or only the base level must be provided"
+    );
     auto& allocator = VulkanContext::allocator();
 
-    // copy image data to buffer
-    auto staging_buf = allocator.create_staging_buffer(size);
-    allocator.copy_mapped(staging_buf, data, size);
+    usize staging_size{};
+    for (const auto& level : level_data) {
+        staging_size += level.size;
+    }
+
+    // copy all levels into one staging buffer, level sizes are multiples of
+    // the texel (block) size so every offset stays aligned
+    auto staging_buf = allocator.create_staging_buffer(staging_size);
+
+    std::vector<vk::BufferImageCopy> regions{};
+    usize offset{};
+    for (u32 i = 0; i < static_cast<u32>(level_data.size()); i++) {
+        const auto& level = level_data[i];
+        allocator.copy_mapped(staging_buf, level.data, level.size, offset);
+
+        vk::BufferImageCopy region{};
+        region.setBufferOffset(offset)
+            .setBufferRowLength(0)
+            .setBufferImageHeight(0)
+            .setImageExtent({std::max(width >> i, 1u), std::max(height >> i, 1u), 1});
+        region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+            .setMipLevel(i)
+            .setBaseArrayLayer(0)
+            .setLayerCount(1);
+        regions.push_back(region);
+        offset += level.size;
+    }
+
+    record_upload(staging_buf, regions, levels, width, height, format, layout, usage, batch);
+}
+
+void ImageResource::record_upload(
+    AllocatedBuffer staging,
+    std::span<const vk::BufferImageCopy> regions,
+    u32 levels,
+    u32 width,
+    u32 height,
+    vk::Format format,
+    vk::ImageLayout layout,
+    vk::ImageUsageFlags usage,
+    ImageUploadBatch* batch
+) {
+    // missing levels are generated from the base level with blits, and
+    // defragmentation copies the image when it is relocated
+    const bool blit = levels > regions.size();
+    usage |= vk::ImageUsageFlagBits::eTransferSrc;
 
     vk::Extent3D extent{
         static_cast<u32>(width),
@@ -83,27 +834,28 @@ void ImageResource::upload(
         1,
     };
 
-    // TODO(bwpge): fix level count for mip chain
     vk::ImageCreateInfo create_info{};
     create_info.setImageType(vk::ImageType::e2D)
         .setExtent(extent)
         .setFormat(format)
         .setUsage(usage | vk::ImageUsageFlagBits::eTransferDst)
         .setSamples(vk::SampleCountFlagBits::e1)
-        .setMipLevels(1)
+        .setMipLevels(levels)
         .setArrayLayers(1)
         .setTiling(vk::ImageTiling::eOptimal);
 
-    auto image = allocator.create_image(
-        create_info,
-        VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
-        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
-    );
+    // pooled with the other textures, see `MemoryCategory`
+    auto& allocator = VulkanContext::allocator();
+    auto image = allocator.create_image(create_info, {}, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
 
-    auto cmd = VulkanContext::oneshot();
+    // a single upload is its own batch, submitted before returning
+    std::optional<ImageUploadBatch> own_batch{};
+    if (!batch) {
+        batch = &own_batch.emplace();
+    }
+    const auto& cmd = batch->cmd();
     vk::ImageSubresourceRange range{};
-    // TODO(bwpge): fix level count for mip chain
-    range.setAspectMask(vk::ImageAspectFlagBits::eColor).setLayerCount(1).setLevelCount(1);
+    range.setAspectMask(vk::ImageAspectFlagBits::eColor).setLayerCount(1).setLevelCount(levels);
 
     // transition image to receive data
     {
@@ -114,7 +866,7 @@ void ImageResource::upload(
             .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
             .setSrcAccessMask({})
             .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
-        cmd->pipelineBarrier(
+        cmd.pipelineBarrier(
             vk::PipelineStageFlagBits::eTopOfPipe,
             vk::PipelineStageFlagBits::eTransfer,
             {},
@@ -125,23 +877,18 @@ void ImageResource::upload(
     }
 
     // copy image data from staging buffer
-    vk::BufferImageCopy copy_region{};
-    copy_region.setBufferOffset(0).setBufferRowLength(0).setBufferImageHeight(0).setImageExtent(
-        extent
-    );
-    copy_region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
-        .setMipLevel(0)
-        .setBaseArrayLayer(0)
-        .setLayerCount(1);
-    cmd->copyBufferToImage(
-        staging_buf.buffer,
+    cmd.copyBufferToImage(
+        staging.buffer,
         image.image,
         vk::ImageLayout::eTransferDstOptimal,
-        copy_region
+        regions
     );
 
     // transition to final layout
-    {
+    if (blit) {
+        generate_mips_blit(cmd, image.image, width, height, levels, layout);
+        batch->require_graphics_queue();
+    } else {
         vk::ImageMemoryBarrier barrier{};
         barrier.setImage(image.image)
             .setSubresourceRange(range)
@@ -149,7 +896,7 @@ void ImageResource::upload(
             .setNewLayout(layout)
             .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
             .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
-        cmd->pipelineBarrier(
+        cmd.pipelineBarrier(
             vk::PipelineStageFlagBits::eTransfer,
             vk::PipelineStageFlagBits::eFragmentShader,
             {},
@@ -159,9 +906,91 @@ void ImageResource::upload(
         );
     }
 
-    VulkanContext::flush_command_buffer(cmd, VulkanContext::transfer_queue());
-    allocator.destroy(staging_buf);
+    batch->add_staging(staging);
+    if (own_batch) {
+        own_batch->submit();
+    }
     std::swap(_image, image);
+    _info = create_info;
+    _layout = layout;
+    _mip_levels = levels;
+}
+
+VkImage ImageResource::relocate(VmaAllocation allocation, const vk::CommandBuffer& cmd) {
+    HVK_ASSERT(allocation, "Cannot relocate image to a null allocation");
+    HVK_ASSERT(_image.image, "Cannot relocate an empty image resource");
+
+    auto& allocator = VulkanContext::allocator();
+    auto image = static_cast<VkImage>(VulkanContext::device().createImage(_info));
+    allocator.bind_image(image, allocation);
+
+    vk::ImageSubresourceRange range{};
+    range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+        .setLayerCount(1)
+        .setLevelCount(_mip_levels);
+    std::array<vk::ImageMemoryBarrier, 2> barriers{};
+    barriers[0]
+        .setImage(_image.image)
+        .setSubresourceRange(range)
+        .setOldLayout(_layout)
+        .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+        .setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
+        .setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+    barriers[1]
+        .setImage(image)
+        .setSubresourceRange(range)
+        .setOldLayout(vk::ImageLayout::eUndefined)
+        .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+        .setSrcAccessMask({})
+        .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eFragmentShader,
+        vk::PipelineStageFlagBits::eTransfer,
+        {},
+        nullptr,
+        nullptr,
+        barriers
+    );
+
+    std::vector<vk::ImageCopy> regions{};
+    for (u32 level = 0; level < _mip_levels; level++) {
+        vk::ImageSubresourceLayers layers{};
+        layers.setAspectMask(vk::ImageAspectFlagBits::eColor).setMipLevel(level).setLayerCount(1);
+        vk::ImageCopy region{};
+        region.setSrcSubresource(layers).setDstSubresource(layers).setExtent({
+            std::max(_info.extent.width >> level, 1u),
+            std::max(_info.extent.height >> level, 1u),
+            1,
+        });
+        regions.push_back(region);
+    }
+    cmd.copyImage(
+        _image.image,
+        vk::ImageLayout::eTransferSrcOptimal,
+        image,
+        vk::ImageLayout::eTransferDstOptimal,
+        regions
+    );
+
+    vk::ImageMemoryBarrier barrier{};
+    barrier.setImage(image)
+        .setSubresourceRange(range)
+        .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+        .setNewLayout(_layout)
+        .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+        .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eFragmentShader,
+        {},
+        nullptr,
+        nullptr,
+        barrier
+    );
+
+    // the allocation handle stays the same, it refers to the new memory
+    // once the defragmentation pass has ended
+    return std::exchange(_image.image, image);
 }
 
 void ImageResource::destroy() {
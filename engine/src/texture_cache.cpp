@@ -0,0 +1,121 @@
+#include "hvk/texture_cache.hpp"
+
+#include <array>
+#include <chrono>
+
+#include "hvk/bc_encoder.hpp"
+#include "hvk/content_hash.hpp"
+#include "hvk/texture.hpp"
+
+namespace hvk {
+
+// bump when the encoder output changes to invalidate existing cache entries
+inline constexpr u32 TEXTURE_CACHE_VERSION = 2;
+
+std::filesystem::path texture_cache_path(u64 source_hash, bool srgb) {
+    // mixed into the source hash with xxHash as well, so names are stable
+    // across runs and standard libraries
+    const std::array<u8, 2> params{
+        static_cast<u8>(TEXTURE_CACHE_VERSION),
+        static_cast<u8>(srgb),
+    };
+    const auto key = content_hash(params, source_hash);
+    return std::filesystem::path{TEXTURE_CACHE_DIR} / fmt::format("{:016x}.ktx2", key);
+}
+
+Ktx2Image compress_texture(
+    const std::filesystem::path& path,
+    std::span<const u8> source,
+    bool srgb,
+    ThreadPool* pool
+) {
+    i32 width{};
+    i32 height{};
+    i32 channels{};
+    auto* pixels = source.empty()
+        ? stbi_load(path.string().c_str(), &width, &height, &channels, STBI_rgb_alpha)
+        : stbi_load_from_memory(
+              source.data(),
+              static_cast<i32>(source.size()),
+              &width,
+              &height,
+              &channels,
+              STBI_rgb_alpha
+          );
+    HVK_ASSERT(pixels, fmt::format("Failed to load image '{}'", path.string()));
+    HVK_ASSERT(width && height, "STB returned invalid image dimensions");
+
+    auto w = static_cast<u32>(width);
+    auto h = static_cast<u32>(height);
+    const usize size = static_cast<usize>(w) * h * 4;
+    const auto alpha = analyze_alpha(pixels, size);
+    const auto format = alpha.has_alpha ? BcFormat::BC3 : BcFormat::BC1;
+
+    Ktx2Image image{};
+    image.format = bc_vk_format(format, srgb);
+    image.width = w;
+    image.height = h;
+    image.metadata[std::string{KTX2_ALPHA_KEY}] = ktx2_alpha_value(alpha);
+
+    // mips are filtered before compression, block formats cannot be blitted
+    const auto levels = mip_level_count(w, h);
+    std::vector<u8> mip{};
+    const u8* src = pixels;
+    for (u32 level = 0; level < levels; level++) {
+        auto blocks = encode_bc(src, w, h, format, pool);
+        image.levels.push_back({image.data.size(), blocks.size()});
+        image.data.insert(image.data.end(), blocks.begin(), blocks.end());
+
+        if (level + 1 < levels) {
+            mip = downsample_rgba8(src, w, h, srgb);
+            src = mip.data();
+            w = std::max(w / 2, 1u);
+            h = std::max(h / 2, 1u);
+        }
+    }
+
+    stbi_image_free(pixels);
+    return image;
+}
+
+Ktx2Image load_compressed_texture(
+    const std::filesystem::path& path,
+    bool srgb,
+    ThreadPool* pool,
+    std::optional<u64> content_hash,
+    std::span<const u8> source
+) {
+    if (!content_hash) {
+        content_hash = source.empty() ? hash_file(path) : hvk::content_hash(source);
+    }
+    HVK_ASSERT(content_hash, fmt::format("Failed to read image '{}'", path.string()));
+    const auto cache_path = texture_cache_path(*content_hash, srgb);
+    if (std::filesystem::exists(cache_path)) {
+        if (auto cached = read_ktx2(cache_path)) {
+            spdlog::trace("Loaded compressed texture '{}' from cache", path.string());
+            return std::move(*cached);
+        }
+        spdlog::debug("Discarding invalid texture cache entry '{}'", cache_path.string());
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto image = compress_texture(path, source, srgb, pool);
+    const auto elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start
+    );
+    spdlog::debug(
+        "Compressed texture '{}' to {} ({:.1f} ms)",
+        path.string(),
+        vk::to_string(image.format),
+        elapsed.count()
+    );
+
+    std::error_code ec{};
+    std::filesystem::create_directories(TEXTURE_CACHE_DIR, ec);
+    if (ec || !write_ktx2(cache_path, image)) {
+        spdlog::warn("Failed to cache compressed texture '{}'", path.string());
+    }
+    return image;
+}
+
+}  // namespace hvk
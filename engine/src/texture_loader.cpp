@@ -0,0 +1,150 @@
+#include "hvk/texture_loader.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "hvk/texture_cache.hpp"
+#include "hvk/texture_streamer.hpp"
+
+namespace hvk {
+
+DecodedTexture decode_texture(
+    const std::filesystem::path& path,
+    bool srgb,
+    bool compress,
+    MipChain chain,
+    std::optional<u64> content_hash,
+    ThreadPool* pool,
+    std::vector<u8> source
+) {
+    DecodedTexture result{};
+    if (path.extension() == ".ktx2") {
+        result.ktx =
+            source.empty() ? read_ktx2(path) : read_ktx2(std::move(source), path.string());
+        HVK_ASSERT(result.ktx, fmt::format("Failed to load KTX2 texture '{}'", path.string()));
+        return result;
+    }
+    if (compress) {
+        // this usually runs on `pool` itself, which the encoder allows since
+        // it never waits for a queued task (see `encode_bc`)
+        result.ktx = load_compressed_texture(path, srgb, pool, content_hash, source);
+        return result;
+    }
+
+    result.staged = source.empty() ? stage_image_file(path) : stage_image(source);
+    HVK_ASSERT(result.staged, fmt::format("Failed to load image '{}'", path.string()));
+    if (chain != MipChain::None) {
+        const auto format = srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+        // streamed textures read their sharper levels again when needed
+        const auto w = result.staged->width;
+        const auto h = result.staged->height;
+        const auto first_level =
+            chain == MipChain::Tail ? streaming_tail_level(w, h, mip_level_count(w, h)) : 0;
+        result.ktx = build_mip_chain(*result.staged, format, first_level);
+        result.staged.reset();
+    }
+    return result;
+}
+
+std::optional<Ktx2Image> decode_texture_levels(
+    const std::filesystem::path& path,
+    bool srgb,
+    bool compress,
+    u32 first_level,
+    u32 last_level
+) {
+    std::optional<Ktx2Image> image{};
+    if (path.extension() == ".ktx2") {
+        image = read_ktx2(path);
+    } else if (compress) {
+        // the first load left the compressed chain in the texture cache
+        image = load_compressed_texture(path, srgb);
+    } else {
+        auto staged = stage_image_file(path);
+        if (!staged) {
+            return std::nullopt;
+        }
+        const auto format = srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+        return build_mip_chain(*staged, format, first_level, last_level);
+    }
+    if (!image) {
+        return std::nullopt;
+    }
+
+    std::vector<u8> data{};
+    for (u32 i = 0; i < image->levels.size(); i++) {
+        auto& level = image->levels[i];
+        if (i < first_level || i >= last_level) {
+            level.offset = 0;
+            continue;
+        }
+        const auto begin = image->data.begin() + static_cast<std::ptrdiff_t>(level.offset);
+        level.offset = data.size();
+        data.insert(data.end(), begin, begin + static_cast<std::ptrdiff_t>(level.size));
+    }
+    image->data = std::move(data);
+    return image;
+}
+
+Ktx2Image build_mip_chain(
+    StagedImage& staged,
+    vk::Format format,
+    u32 first_level,
+    u32 last_level
+) {
+    const bool srgb = format == vk::Format::eR8G8B8A8Srgb;
+    auto w = staged.width;
+    auto h = staged.height;
+    const auto levels = mip_level_count(w, h);
+    last_level = std::min(last_level, levels);
+
+    Ktx2Image image{};
+    image.format = format;
+    image.width = w;
+    image.height = h;
+    image.metadata[std::string{KTX2_ALPHA_KEY}] = ktx2_alpha_value(staged.alpha);
+    image.levels.reserve(levels);
+
+    // each level is filtered from the one before it, starting with the base
+    // level where it was decoded
+    const u8* src = staged.data;
+    std::vector<u8> mip{};
+    for (u32 level = 0; level < levels; level++) {
+        const usize size = static_cast<usize>(w) * h * 4;
+        if (level >= first_level && level < last_level) {
+            image.levels.push_back({image.data.size(), size});
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            image.data.insert(image.data.end(), src, src + size);
+        } else {
+            image.levels.push_back({0, size});
+        }
+        if (level + 1 < last_level) {
+            mip = downsample_rgba8(src, w, h, srgb);
+            src = mip.data();
+        }
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+
+    VulkanContext::allocator().destroy(staged.buffer);
+    staged.buffer = {};
+    staged.data = nullptr;
+    return image;
+}
+
+TextureHandle::TextureHandle(std::shared_ptr<const TextureLoad> load) : _load{std::move(load)} {}
+
+bool TextureHandle::valid() const noexcept {
+    return _load != nullptr;
+}
+
+bool TextureHandle::ready() const noexcept {
+    return valid() && _load->ready.load(std::memory_order_acquire);
+}
+
+Texture2D* TextureHandle::texture() const noexcept {
+    return valid() ? _load->texture : nullptr;
+}
+
+}  // namespace hvk
@@ -0,0 +1,358 @@
+#include "hvk/texture_streamer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <utility>
+
+#include "hvk/render_snapshot.hpp"
+#include "hvk/scene.hpp"
+#include "hvk/vk_context.hpp"
+
+namespace hvk {
+
+// side and far planes of the view frustum, normalized so that the signed
+// distance of a point is `dot(plane.xyz, p) + plane.w`. the side planes meet
+// at the eye, so anything behind the camera is outside as well.
+std::array<glm::vec4, 5> frustum_planes(const glm::mat4& view_proj) {
+    auto row = [&view_proj](glm::length_t i) {
+        return glm::vec4{view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]};
+    };
+    std::array planes{
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(3) - row(2),
+    };
+    for (auto& plane : planes) {
+        plane /= glm::length(glm::vec3{plane});
+    }
+    return planes;
+}
+
+u32 streaming_tail_level(u32 width, u32 height, u32 levels) {
+    u32 level{};
+    while (level + 1 < levels
+           && std::max(width >> level, height >> level) > STREAMING_MIP_TAIL_SIZE) {
+        level++;
+    }
+    return level;
+}
+
+TextureStreamer::TextureStreamer(usize frames_in_flight)
+    : _frames_in_flight{frames_in_flight} {}
+
+TextureStreamer::~TextureStreamer() {
+    auto& allocator = VulkanContext::allocator();
+    for (auto& retired : _retired) {
+        allocator.destroy(retired.staging);
+    }
+}
+
+void TextureStreamer::add(const TextureLoad& load, Ktx2Image image, ImageUploadBatch* batch) {
+    HVK_ASSERT(!image.levels.empty(), "Streamed texture must have at least one level");
+    HVK_ASSERT(!_index.contains(load.texture), "Texture is already streamed");
+
+    Entry entry{
+        .texture = load.texture,
+        .image = std::move(image),
+        .path = load.path,
+        .srgb = load.format == vk::Format::eR8G8B8A8Srgb,
+        .compressed = load.compressed,
+        .layout = load.layout,
+        .usage = load.usage,
+        .filter = load.filter,
+        .addr_mode = load.addr_mode,
+    };
+    entry.tail = streaming_tail_level(
+        entry.image.width,
+        entry.image.height,
+        static_cast<u32>(entry.image.levels.size())
+    );
+    entry.resident = entry.tail;
+    entry.target = entry.tail;
+
+    *entry.texture = Texture2D::from_ktx2(
+        entry.image,
+        entry.layout,
+        entry.usage,
+        entry.filter,
+        entry.addr_mode,
+        batch,
+        entry.tail
+    );
+    _resident += level_size(entry, entry.tail);
+    // the tail is on the device now, sharper levels are read again when needed
+    entry.image.data = {};
+
+    _index[entry.texture] = _entries.size();
+    _entries.push_back(std::move(entry));
+}
+
+void TextureStreamer::set_budget(vk::DeviceSize bytes) noexcept {
+    _budget = bytes;
+}
+
+void TextureStreamer::set_pool(ThreadPool* pool) noexcept {
+    _pool = pool;
+}
+
+vk::DeviceSize TextureStreamer::budget() const {
+    // memory used by everything else is not available to textures
+    const auto heaps = VulkanContext::allocator().device_local_budget();
+    const auto others = heaps.usage > _resident ? heaps.usage - _resident : 0;
+    const auto available = heaps.budget > others ? heaps.budget - others : 0;
+    return _budget ? std::min(_budget, available) : available;
+}
+
+vk::DeviceSize TextureStreamer::resident_size() const noexcept {
+    return _resident;
+}
+
+bool TextureStreamer::update(
+    const Scene& scene,
+    const RenderSnapshot& snapshot,
+    vk::Extent2D extent
+) {
+    if (_entries.empty()) {
+        return false;
+    }
+
+    _frame++;
+    for (auto& entry : _entries) {
+        // levels read in the background are picked up once complete
+        if (entry.loading.valid()
+            && entry.loading.wait_for(std::chrono::seconds{0}) != std::future_status::timeout) {
+            entry.loaded = entry.loading.get();
+        }
+        entry.pixels = 0.0f;
+        entry.target = entry.resident;
+    }
+
+    // projected diameter in pixels of a sphere with radius 1 at distance 1
+    const auto& camera = snapshot.camera;
+    const float pixel_scale = camera.proj[1][1] * static_cast<float>(extent.height);
+    const auto planes = frustum_planes(camera.view_proj);
+
+    const auto& models = scene.models();
+    for (usize i = 0; i < models.size() && i < snapshot.objects.size(); i++) {
+        const auto& model = models[i];
+        // object transforms are stored as the top rows of the model matrix
+        const auto& transform = snapshot.objects[i].transform;
+        float scale{};
+        for (glm::length_t c = 0; c < 3; c++) {
+            const glm::vec3 axis{transform[0][c], transform[1][c], transform[2][c]};
+            scale = std::max(scale, glm::length(axis));
+        }
+
+        for (const auto& node : model.nodes()) {
+            if (!node.material || !node.material->base_color_texture) {
+                continue;
+            }
+            const auto it = _index.find(node.material->base_color_texture);
+            if (it == _index.end()) {
+                continue;
+            }
+
+            const glm::vec3 center = glm::vec4{model.node_center(node), 1.0f} * transform;
+            const auto radius = model.node_radius(node) * scale;
+            const bool visible = std::all_of(planes.begin(), planes.end(), [&](const auto& p) {
+                return glm::dot(glm::vec3{p}, center) + p.w >= -radius;
+            });
+            if (!visible) {
+                continue;
+            }
+
+            auto& entry = _entries[it->second];
+            entry.last_seen = _frame;
+            const auto distance = glm::distance(camera.pos, center);
+            const auto pixels = distance > radius ? radius / distance * pixel_scale
+                                                  : std::numeric_limits<float>::max();
+            entry.pixels = std::max(entry.pixels, pixels);
+        }
+    }
+
+    const auto limit = budget();
+    auto resident = _resident;
+    // the budget may have shrunk without anything new being requested
+    evict(resident, 0, limit);
+
+    std::vector<Entry*> requests{};
+    for (auto& entry : _entries) {
+        if (entry.last_seen == _frame && wanted_level(entry) < entry.target) {
+            requests.push_back(&entry);
+        }
+    }
+    std::sort(requests.begin(), requests.end(), [](const Entry* a, const Entry* b) {
+        return a->pixels > b->pixels;
+    });
+
+    // largest on screen first, until the upload limit for this frame is used.
+    // only the new levels are uploaded, the rest is copied on the device.
+    vk::DeviceSize uploaded{};
+    for (auto* entry : requests) {
+        // the levels have to be read again before they can be uploaded, which
+        // is left to a later frame. levels read while another level was
+        // resident do not fit the image anymore.
+        const auto wanted = wanted_level(*entry);
+        if (entry->loaded && entry->load_last != entry->resident) {
+            entry->loaded.reset();
+        }
+        if (!entry->loaded) {
+            if (!entry->loading.valid()) {
+                load(*entry, wanted);
+            }
+            continue;
+        }
+
+        const auto level = std::max(wanted, entry->load_first);
+        const auto growth = level_size(*entry, level) - level_size(*entry, entry->target);
+        if (uploaded > 0 && uploaded + growth > STREAMING_UPLOAD_LIMIT) {
+            break;
+        }
+
+        if (!evict(resident, growth, limit)) {
+            continue;
+        }
+        resident += growth;
+        entry->target = level;
+        uploaded += growth;
+    }
+
+    return std::any_of(_entries.begin(), _entries.end(), [](const Entry& entry) {
+        return entry.target != entry.resident;
+    });
+}
+
+std::vector<const Texture2D*> TextureStreamer::apply(const vk::CommandBuffer& cmd, usize frame) {
+    // the last submission that could use an image is the one that replaced it
+    auto& allocator = VulkanContext::allocator();
+    auto completed = std::partition(_retired.begin(), _retired.end(), [&](const Retired& r) {
+        return r.frame + _frames_in_flight > frame;
+    });
+    for (auto it = completed; it != _retired.end(); it++) {
+        allocator.destroy(it->staging);
+    }
+    _retired.erase(completed, _retired.end());
+
+    const auto start = std::chrono::steady_clock::now();
+    usize sharpened{};
+    usize evicted{};
+    std::vector<const Texture2D*> changed{};
+    for (auto& entry : _entries) {
+        if (entry.target == entry.resident) {
+            continue;
+        }
+        if (entry.target < entry.resident) {
+            sharpened++;
+        } else {
+            evicted++;
+        }
+
+        // only sharper levels are uploaded, and need their data
+        HVK_ASSERT(
+            entry.target > entry.resident || entry.loaded,
+            "Streamed levels must be read before they are uploaded"
+        );
+        Retired retired{.frame = frame};
+        retired.texture = Texture2D::from_resident_levels(
+            entry.target < entry.resident ? *entry.loaded : entry.image,
+            entry.target,
+            *entry.texture,
+            entry.resident,
+            cmd,
+            retired.staging
+        );
+        std::swap(*entry.texture, retired.texture);
+        _retired.push_back(std::move(retired));
+        changed.push_back(entry.texture);
+
+        _resident -= level_size(entry, entry.resident);
+        _resident += level_size(entry, entry.target);
+        entry.resident = entry.target;
+        // the uploaded levels are in the staging buffer now
+        entry.loaded.reset();
+    }
+    if (changed.empty()) {
+        return changed;
+    }
+
+    constexpr double mib = 1024.0 * 1024.0;
+    spdlog::debug(
+        "Streamed textures: {} sharpened, {} evicted ({:.1f} ms), {:.1f} MiB resident",
+        sharpened,
+        evicted,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+            .count(),
+        static_cast<double>(_resident) / mib
+    );
+    return changed;
+}
+
+vk::DeviceSize TextureStreamer::level_size(const Entry& entry, u32 first_level) {
+    vk::DeviceSize size{};
+    for (usize i = first_level; i < entry.image.levels.size(); i++) {
+        size += entry.image.levels[i].size;
+    }
+    return size;
+}
+
+u32 TextureStreamer::wanted_level(const Entry& entry) {
+    const auto size = static_cast<float>(std::max(entry.image.width, entry.image.height));
+    if (entry.pixels >= size) {
+        return 0;
+    }
+
+    // the smallest level that still has a texel for every projected pixel
+    auto level = static_cast<u32>(std::log2(size / std::max(entry.pixels, 1.0f)));
+    level = level > STREAMING_LOD_BIAS ? level - STREAMING_LOD_BIAS : 0;
+    return std::min(level, entry.tail);
+}
+
+bool TextureStreamer::evict(
+    vk::DeviceSize& resident,
+    vk::DeviceSize required,
+    vk::DeviceSize budget
+) {
+    while (resident + required > budget) {
+        // one level at a time from the texture that was seen the longest ago
+        Entry* victim{};
+        for (auto& entry : _entries) {
+            const bool unseen = entry.last_seen + STREAMING_EVICT_FRAMES <= _frame;
+            if (unseen && entry.target < entry.tail
+                && (!victim || entry.last_seen < victim->last_seen)) {
+                victim = &entry;
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+
+        resident -= level_size(*victim, victim->target) - level_size(*victim, victim->target + 1);
+        victim->target++;
+    }
+    return true;
+}
+
+void TextureStreamer::load(Entry& entry, u32 first_level) {
+    entry.load_first = first_level;
+    entry.load_last = entry.resident;
+    auto read = [path = entry.path,
+                 srgb = entry.srgb,
+                 compressed = entry.compressed,
+                 first_level,
+                 last_level = entry.resident]() {
+        return decode_texture_levels(path, srgb, compressed, first_level, last_level);
+    };
+    if (_pool) {
+        entry.loading = _pool->submit(std::move(read));
+    } else {
+        entry.loading = std::async(std::launch::deferred, std::move(read));
+    }
+}
+
+}  // namespace hvk
@@ -0,0 +1,57 @@
+#include <algorithm>
+
+#include "hvk/thread_pool.hpp"
+
+namespace hvk {
+
+ThreadPool::ThreadPool(usize thread_count) {
+    thread_count = std::max<usize>(thread_count, 1);
+    spdlog::trace("Creating thread pool: threads={}", thread_count);
+
+    _workers.reserve(thread_count);
+    for (usize i = 0; i < thread_count; i++) {
+        _workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{_mutex};
+        _stopping = true;
+    }
+    _cv.notify_all();
+
+    for (auto& worker : _workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+usize ThreadPool::default_thread_count() {
+    auto count = static_cast<usize>(std::thread::hardware_concurrency());
+    return count > 1 ? count - 1 : 1;
+}
+
+usize ThreadPool::size() const noexcept {
+    return _workers.size();
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        std::function<void()> task{};
+        {
+            std::unique_lock lock{_mutex};
+            _cv.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+            if (_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(_tasks.front());
+            _tasks.pop();
+        }
+        task();
+    }
+}
+
+}  // namespace hvk
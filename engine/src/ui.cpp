@@ -109,22 +109,17 @@ UI::UI(const vk::UniqueRenderPass& render_pass) : _render_pass(render_pass.get()
     style.TabRounding = 4.0f;
 
     // descriptor pool
-    std::vector<vk::DescriptorPoolSize> sizes = {
-        {vk::DescriptorType::eCombinedImageSampler, 1},
-    };
-    vk::DescriptorPoolCreateInfo pool_ci{};
-    pool_ci.setPoolSizes(sizes).setMaxSets(1);
-    _pool = VulkanContext::device().createDescriptorPoolUnique(pool_ci);
+    _descriptors = DescriptorAllocator{1, {{vk::DescriptorType::eCombinedImageSampler, 1.0f}}};
 
     // descriptor layout and set
     DescriptorSetBindingMap map{
         {vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment},
     };
     _descriptor_set_layout = map.build_layout();
-    _descriptor_set = VulkanContext::allocate_descriptor_set(_pool, _descriptor_set_layout);
+    _descriptor_set = _descriptors.allocate(_descriptor_set_layout);
 
     DescriptorSetWriter writer{};
-    writer.write_images(_descriptor_set, map, _font_tex.descriptor_info());
+    writer.write_images(_descriptor_set, map, _font_tex.descriptor_info()).update();
 
     build_pipeline();
 }
@@ -212,7 +207,7 @@ void UI::draw(const vk::UniqueCommandBuffer& cmd) {
     cmd->bindPipeline(vk::PipelineBindPoint::eGraphics, _gfx_pipeline.pipelines[0].get());
     cmd->bindDescriptorSets(
         vk::PipelineBindPoint::eGraphics,
-        _gfx_pipeline.layout.get(),
+        _gfx_pipeline.layout,
         0,
         _descriptor_set,
         nullptr
@@ -220,7 +215,7 @@ void UI::draw(const vk::UniqueCommandBuffer& cmd) {
     cmd->bindVertexBuffers(0, _vertex.buffer(), {0});
     cmd->bindIndexBuffer(_index.buffer(), 0, vk::IndexType::eUint16);
     cmd->pushConstants(
-        _gfx_pipeline.layout.get(),
+        _gfx_pipeline.layout,
         vk::ShaderStageFlagBits::eVertex,
         0,
         sizeof(PushConstantBlock),
@@ -0,0 +1,681 @@
+#include "hvk/virtual_texture.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+#include "hvk/vk_context.hpp"
+
+namespace hvk {
+
+inline constexpr usize VT_SLOT_BYTES = static_cast<usize>(VT_SLOT_SIZE) * VT_SLOT_SIZE * 4;
+inline constexpr usize VT_FEEDBACK_BYTES = static_cast<usize>(VT_FEEDBACK_WORDS) * 4;
+inline constexpr usize VT_PAGE_TABLE_BYTES = static_cast<usize>(VT_FEEDBACK_BITS) * 4;
+
+// host visible buffer that stays mapped for its whole lifetime
+AllocatedBuffer create_mapped_buffer(
+    vk::DeviceSize size,
+    vk::BufferUsageFlags usage,
+    void** mapped
+) {
+    VmaAllocationInfo info{};
+    auto buf = VulkanContext::allocator().create_buffer(
+        size,
+        usage,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        VMA_MEMORY_USAGE_AUTO,
+        &info
+    );
+    HVK_ASSERT(info.pMappedData, "Virtual texture buffers should be persistently mapped");
+    *mapped = info.pMappedData;
+    return buf;
+}
+
+vk::ImageMemoryBarrier image_barrier(
+    VkImage image,
+    u32 levels,
+    u32 layers,
+    vk::ImageLayout old_layout,
+    vk::ImageLayout new_layout
+) {
+    const bool to_transfer = new_layout == vk::ImageLayout::eTransferDstOptimal;
+    vk::ImageSubresourceRange range{};
+    range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+        .setLevelCount(levels)
+        .setLayerCount(layers);
+
+    vk::ImageMemoryBarrier barrier{};
+    barrier.setImage(image)
+        .setSubresourceRange(range)
+        .setOldLayout(old_layout)
+        .setNewLayout(new_layout)
+        .setSrcAccessMask(to_transfer ? vk::AccessFlagBits::eShaderRead
+                                      : vk::AccessFlagBits::eTransferWrite)
+        .setDstAccessMask(to_transfer ? vk::AccessFlagBits::eTransferWrite
+                                      : vk::AccessFlagBits::eShaderRead);
+    return barrier;
+}
+
+// index of `v` in a repeating range of `n` texels
+u32 wrap_texel(i64 v, u32 n) {
+    const auto size = static_cast<i64>(n);
+    return static_cast<u32>(((v % size) + size) % size);
+}
+
+VirtualTextureCache::VirtualTextureCache(usize frames_in_flight)
+    : _slots(static_cast<usize>(VT_CACHE_SLOTS) * VT_CACHE_SLOTS),
+      _frames(frames_in_flight) {
+    auto& allocator = VulkanContext::allocator();
+    const auto& device = VulkanContext::device();
+
+    vk::ImageCreateInfo info{};
+    info.setImageType(vk::ImageType::e2D)
+        .setExtent({VT_CACHE_SIZE, VT_CACHE_SIZE, 1})
+        .setFormat(vk::Format::eR8G8B8A8Srgb)
+        .setUsage(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setMipLevels(1)
+        .setArrayLayers(1)
+        .setTiling(vk::ImageTiling::eOptimal);
+    _cache = allocator.create_image(info, {}, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    // one layer per texture, one level per texture level
+    info.setExtent({VT_PAGE_TABLE_SIZE, VT_PAGE_TABLE_SIZE, 1})
+        .setFormat(vk::Format::eR8G8B8A8Uint)
+        .setMipLevels(VT_PAGE_TABLE_LEVELS)
+        .setArrayLayers(VT_MAX_TEXTURES);
+    _page_tables = allocator.create_image(info, {}, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    vk::ImageViewCreateInfo view_info{};
+    view_info.setImage(_cache.image)
+        .setViewType(vk::ImageViewType::e2D)
+        .setFormat(vk::Format::eR8G8B8A8Srgb);
+    view_info.subresourceRange.setAspectMask(vk::ImageAspectFlagBits::eColor)
+        .setLevelCount(1)
+        .setLayerCount(1);
+    _cache_view = device.createImageViewUnique(view_info);
+
+    view_info.setImage(_page_tables.image)
+        .setViewType(vk::ImageViewType::e2DArray)
+        .setFormat(vk::Format::eR8G8B8A8Uint);
+    view_info.subresourceRange.setLevelCount(VT_PAGE_TABLE_LEVELS)
+        .setLayerCount(VT_MAX_TEXTURES);
+    _page_table_view = device.createImageViewUnique(view_info);
+
+    // pages are sampled at a single level, the borders make clamping safe
+    vk::SamplerCreateInfo sampler_info{};
+    sampler_info.setMagFilter(vk::Filter::eLinear)
+        .setMinFilter(vk::Filter::eLinear)
+        .setMipmapMode(vk::SamplerMipmapMode::eNearest)
+        .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+        .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+        .setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+    _cache_sampler = VulkanContext::sampler_cache().sampler(sampler_info);
+
+    // integer formats cannot be filtered, entries are read with texelFetch
+    sampler_info.setMagFilter(vk::Filter::eNearest)
+        .setMinFilter(vk::Filter::eNearest)
+        .setMaxLod(static_cast<float>(VT_PAGE_TABLE_LEVELS));
+    _page_table_sampler = VulkanContext::sampler_cache().sampler(sampler_info);
+
+    // page table entries with an alpha of 0 are never sampled, but both
+    // images need a defined layout before the first frame
+    {
+        ImageUploadBatch batch{};
+        batch.require_graphics_queue();
+        const auto& cmd = batch.cmd();
+
+        std::array to_transfer{
+            image_barrier(
+                _cache.image,
+                1,
+                1,
+                vk::ImageLayout::eUndefined,
+                vk::ImageLayout::eTransferDstOptimal
+            ),
+            image_barrier(
+                _page_tables.image,
+                VT_PAGE_TABLE_LEVELS,
+                VT_MAX_TEXTURES,
+                vk::ImageLayout::eUndefined,
+                vk::ImageLayout::eTransferDstOptimal
+            ),
+        };
+        for (auto& barrier : to_transfer) {
+            barrier.setSrcAccessMask({});
+        }
+        cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTopOfPipe,
+            vk::PipelineStageFlagBits::eTransfer,
+            {},
+            nullptr,
+            nullptr,
+            to_transfer
+        );
+
+        cmd.clearColorImage(
+            _cache.image,
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ClearColorValue{std::array<float, 4>{}},
+            to_transfer[0].subresourceRange
+        );
+        cmd.clearColorImage(
+            _page_tables.image,
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ClearColorValue{std::array<u32, 4>{}},
+            to_transfer[1].subresourceRange
+        );
+
+        std::array to_read{
+            image_barrier(
+                _cache.image,
+                1,
+                1,
+                vk::ImageLayout::eTransferDstOptimal,
+                vk::ImageLayout::eReadOnlyOptimal
+            ),
+            image_barrier(
+                _page_tables.image,
+                VT_PAGE_TABLE_LEVELS,
+                VT_MAX_TEXTURES,
+                vk::ImageLayout::eTransferDstOptimal,
+                vk::ImageLayout::eReadOnlyOptimal
+            ),
+        };
+        cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eFragmentShader,
+            {},
+            nullptr,
+            nullptr,
+            to_read
+        );
+        batch.submit();
+    }
+
+    for (auto& frame : _frames) {
+        void* mapped{};
+        frame.feedback = create_mapped_buffer(
+            VT_MAX_TEXTURES * VT_FEEDBACK_BYTES,
+            vk::BufferUsageFlagBits::eStorageBuffer,
+            &mapped
+        );
+        frame.feedback_bits = static_cast<u32*>(mapped);
+        std::memset(mapped, 0, VT_MAX_TEXTURES * VT_FEEDBACK_BYTES);
+        allocator.flush(frame.feedback);
+
+        frame.pages = create_mapped_buffer(
+            VT_UPLOADS_PER_FRAME * VT_SLOT_BYTES,
+            vk::BufferUsageFlagBits::eTransferSrc,
+            &mapped
+        );
+        frame.page_data = static_cast<u8*>(mapped);
+
+        frame.tables = create_mapped_buffer(
+            VT_MAX_TEXTURES * VT_PAGE_TABLE_BYTES,
+            vk::BufferUsageFlagBits::eTransferSrc,
+            &mapped
+        );
+        frame.table_data = static_cast<u8*>(mapped);
+    }
+
+    _texture_data = Buffer{
+        VT_MAX_TEXTURES * sizeof(VirtualTextureData),
+        vk::BufferUsageFlagBits::eStorageBuffer,
+    };
+}
+
+VirtualTextureCache::~VirtualTextureCache() {
+    auto& allocator = VulkanContext::allocator();
+    for (auto& frame : _frames) {
+        allocator.destroy(frame.feedback);
+        allocator.destroy(frame.pages);
+        allocator.destroy(frame.tables);
+    }
+    _cache_view.reset();
+    _page_table_view.reset();
+    allocator.destroy(_cache);
+    allocator.destroy(_page_tables);
+}
+
+bool VirtualTextureCache::reserve(u32 width, u32 height) {
+    // pages of power of two textures nest exactly in their parent page
+    const auto size = std::max(width, height);
+    if (_reserved == VT_MAX_TEXTURES || size < VT_MIN_TEXTURE_SIZE
+        || size > VT_PAGE_SIZE * VT_PAGE_TABLE_SIZE || !std::has_single_bit(width)
+        || !std::has_single_bit(height)) {
+        return false;
+    }
+    _reserved++;
+    return true;
+}
+
+void VirtualTextureCache::release() {
+    HVK_ASSERT(_reserved > _textures.size(), "No virtual texture reservation to release");
+    _reserved--;
+}
+
+void VirtualTextureCache::add(const TextureLoad& load, Ktx2Image image, ImageUploadBatch* batch) {
+    HVK_ASSERT(_textures.size() < _reserved, "Virtual texture was not reserved");
+    HVK_ASSERT(
+        image.format == vk::Format::eR8G8B8A8Srgb && !image.levels.empty(),
+        "Virtual textures must be a full RGBA8 mip chain"
+    );
+
+    VirtualTexture vt{
+        .texture = load.texture,
+        .image = std::move(image),
+        .dirty = true,
+    };
+    while (std::max(vt.image.width >> vt.root, vt.image.height >> vt.root) > VT_PAGE_SIZE) {
+        vt.root++;
+    }
+
+    *vt.texture = Texture2D::from_ktx2(
+        vt.image,
+        load.layout,
+        load.usage,
+        load.filter,
+        load.addr_mode,
+        batch,
+        vt.root
+    );
+
+    const auto index = static_cast<u32>(_textures.size());
+    VirtualTextureData data{
+        .size = {vt.image.width, vt.image.height},
+        .root_level = vt.root,
+    };
+    _texture_data.update(&data, sizeof(data), index * sizeof(VirtualTextureData));
+
+    spdlog::debug(
+        "Virtual texture {}: {}x{}, {} levels paged",
+        index,
+        vt.image.width,
+        vt.image.height,
+        vt.root
+    );
+    _index[vt.texture] = index;
+    _textures.push_back(std::move(vt));
+}
+
+u32 VirtualTextureCache::index_of(const Texture2D* texture) const {
+    const auto it = _index.find(texture);
+    return it == _index.end() ? 0 : it->second + 1;
+}
+
+void VirtualTextureCache::update(usize frame_idx, const vk::CommandBuffer& cmd) {
+    if (_textures.empty()) {
+        return;
+    }
+    _frame++;
+    auto& frame = _frames[frame_idx];
+
+    std::vector<Page> requests{};
+    read_feedback(frame, requests);
+    // root pages are always wanted, which also loads them for the first frame
+    for (u32 i = 0; i < _textures.size(); i++) {
+        requests.push_back({.texture = i, .level = _textures[i].root});
+    }
+
+    // ancestors are loaded before their descendants, so a missing page always
+    // falls back to the closest level available
+    const auto requested = requests.size();
+    for (usize i = 0; i < requested; i++) {
+        auto page = requests[i];
+        while (page.level < _textures[page.texture].root) {
+            page.level++;
+            page.x >>= 1;
+            page.y >>= 1;
+            requests.push_back(page);
+        }
+    }
+    std::sort(requests.begin(), requests.end(), [this](const Page& a, const Page& b) {
+        const auto a_depth = _textures[a.texture].root - a.level;
+        const auto b_depth = _textures[b.texture].root - b.level;
+        return a_depth != b_depth ? a_depth < b_depth : a.key() < b.key();
+    });
+    requests.erase(
+        std::unique(
+            requests.begin(),
+            requests.end(),
+            [](const Page& a, const Page& b) { return a.key() == b.key(); }
+        ),
+        requests.end()
+    );
+
+    std::vector<vk::BufferImageCopy> page_regions{};
+    auto load = [&](const Page& page, Slot& slot) {
+        const auto offset = page_regions.size() * VT_SLOT_BYTES;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        load_page(page, slot, frame.page_data + offset);
+
+        const auto idx = static_cast<u32>(&slot - _slots.data());
+        vk::BufferImageCopy region{};
+        region.setBufferOffset(offset)
+            .setImageOffset({
+                static_cast<i32>((idx % VT_CACHE_SLOTS) * VT_SLOT_SIZE),
+                static_cast<i32>((idx / VT_CACHE_SLOTS) * VT_SLOT_SIZE),
+                0,
+            })
+            .setImageExtent({VT_SLOT_SIZE, VT_SLOT_SIZE, 1});
+        region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor).setLayerCount(1);
+        page_regions.push_back(region);
+    };
+
+    for (const auto& page : requests) {
+        const auto it = _resident.find(page.key());
+        if (it != _resident.end()) {
+            _slots[it->second].last_used = _frame;
+            continue;
+        }
+        if (page_regions.size() == VT_UPLOADS_PER_FRAME) {
+            continue;
+        }
+        if (auto* slot = find_slot(false)) {
+            load(page, *slot);
+        }
+    }
+
+    // neighbours of what was sampled are likely to be sampled next, but are
+    // only loaded into slots nothing has needed for a while
+    const std::array<glm::ivec2, 4> neighbours{{{-1, 0}, {1, 0}, {0, -1}, {0, 1}}};
+    bool prefetch = true;
+    for (usize i = 0; i < requests.size() && prefetch; i++) {
+        const auto& page = requests[i];
+        const auto& image = _textures[page.texture].image;
+        const auto pages_x = level_pages(image.width, page.level);
+        const auto pages_y = level_pages(image.height, page.level);
+        for (const auto& offset : neighbours) {
+            const Page next{
+                .texture = page.texture,
+                .level = page.level,
+                .x = wrap_texel(static_cast<i64>(page.x) + offset.x, pages_x),
+                .y = wrap_texel(static_cast<i64>(page.y) + offset.y, pages_y),
+            };
+            if (_resident.contains(next.key())) {
+                continue;
+            }
+            auto* slot = find_slot(true);
+            prefetch = slot && page_regions.size() < VT_UPLOADS_PER_FRAME;
+            if (!prefetch) {
+                break;
+            }
+            load(next, *slot);
+        }
+    }
+
+    std::vector<vk::BufferImageCopy> table_regions{};
+    for (u32 i = 0; i < _textures.size(); i++) {
+        if (_textures[i].dirty) {
+            write_page_table(i, frame, table_regions);
+        }
+    }
+    if (page_regions.empty() && table_regions.empty()) {
+        return;
+    }
+
+    auto& allocator = VulkanContext::allocator();
+    allocator.flush(frame.pages);
+    allocator.flush(frame.tables);
+
+    // frames still in flight may be sampling the images, the barrier waits
+    // for their fragment shaders since they were submitted earlier
+    std::array to_transfer{
+        image_barrier(
+            _cache.image,
+            1,
+            1,
+            vk::ImageLayout::eReadOnlyOptimal,
+            vk::ImageLayout::eTransferDstOptimal
+        ),
+        image_barrier(
+            _page_tables.image,
+            VT_PAGE_TABLE_LEVELS,
+            VT_MAX_TEXTURES,
+            vk::ImageLayout::eReadOnlyOptimal,
+            vk::ImageLayout::eTransferDstOptimal
+        ),
+    };
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eFragmentShader,
+        vk::PipelineStageFlagBits::eTransfer,
+        {},
+        nullptr,
+        nullptr,
+        to_transfer
+    );
+
+    if (!page_regions.empty()) {
+        cmd.copyBufferToImage(
+            frame.pages.buffer,
+            _cache.image,
+            vk::ImageLayout::eTransferDstOptimal,
+            page_regions
+        );
+    }
+    if (!table_regions.empty()) {
+        cmd.copyBufferToImage(
+            frame.tables.buffer,
+            _page_tables.image,
+            vk::ImageLayout::eTransferDstOptimal,
+            table_regions
+        );
+    }
+
+    std::array to_read{
+        image_barrier(
+            _cache.image,
+            1,
+            1,
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ImageLayout::eReadOnlyOptimal
+        ),
+        image_barrier(
+            _page_tables.image,
+            VT_PAGE_TABLE_LEVELS,
+            VT_MAX_TEXTURES,
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ImageLayout::eReadOnlyOptimal
+        ),
+    };
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eFragmentShader,
+        {},
+        nullptr,
+        nullptr,
+        to_read
+    );
+}
+
+void VirtualTextureCache::record_feedback_barrier(const vk::CommandBuffer& cmd) {
+    vk::MemoryBarrier barrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead};
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eFragmentShader,
+        vk::PipelineStageFlagBits::eHost,
+        {},
+        barrier,
+        nullptr,
+        nullptr
+    );
+}
+
+vk::DescriptorBufferInfo VirtualTextureCache::feedback_info(usize frame) const {
+    return {_frames[frame].feedback.buffer, 0, VK_WHOLE_SIZE};
+}
+
+vk::DescriptorBufferInfo VirtualTextureCache::texture_info() const {
+    return _texture_data.descriptor_buffer_info();
+}
+
+vk::DescriptorImageInfo VirtualTextureCache::cache_info() const {
+    return {_cache_sampler, _cache_view.get(), vk::ImageLayout::eReadOnlyOptimal};
+}
+
+vk::DescriptorImageInfo VirtualTextureCache::page_table_info() const {
+    return {
+        _page_table_sampler,
+        _page_table_view.get(),
+        vk::ImageLayout::eReadOnlyOptimal,
+    };
+}
+
+u32 VirtualTextureCache::level_pages(u32 size, u32 level) {
+    return std::max((size >> level) / VT_PAGE_SIZE, 1u);
+}
+
+u32 VirtualTextureCache::level_offset(u32 level) {
+    // levels shrink by 4x, so this is the sum of the sizes of every level
+    // before `level`
+    constexpr u32 all = 1u << (2 * VT_PAGE_TABLE_LEVELS);
+    return (all - (1u << (2 * (VT_PAGE_TABLE_LEVELS - level)))) / 3;
+}
+
+void VirtualTextureCache::read_feedback(FrameResources& frame, std::vector<Page>& pages) {
+    auto& allocator = VulkanContext::allocator();
+    allocator.invalidate(frame.feedback);
+
+    for (u32 i = 0; i < _textures.size(); i++) {
+        for (u32 w = 0; w < VT_FEEDBACK_WORDS; w++) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            auto word = frame.feedback_bits[i * VT_FEEDBACK_WORDS + w];
+            while (word) {
+                const auto bit = w * 32 + static_cast<u32>(std::countr_zero(word));
+                word &= word - 1;
+
+                u32 level{};
+                while (level + 1 < VT_PAGE_TABLE_LEVELS && level_offset(level + 1) <= bit) {
+                    level++;
+                }
+                const auto local = bit - level_offset(level);
+                const auto table_size = VT_PAGE_TABLE_SIZE >> level;
+                const Page page{
+                    .texture = i,
+                    .level = level,
+                    .x = local % table_size,
+                    .y = local / table_size,
+                };
+                if (is_valid(page)) {
+                    pages.push_back(page);
+                }
+            }
+        }
+    }
+
+    std::memset(frame.feedback_bits, 0, VT_MAX_TEXTURES * VT_FEEDBACK_BYTES);
+    allocator.flush(frame.feedback);
+}
+
+bool VirtualTextureCache::is_valid(const Page& page) const {
+    const auto& vt = _textures[page.texture];
+    return page.level <= vt.root && page.x < level_pages(vt.image.width, page.level)
+        && page.y < level_pages(vt.image.height, page.level);
+}
+
+VirtualTextureCache::Slot* VirtualTextureCache::find_slot(bool prefetch) {
+    Slot* victim{};
+    for (auto& slot : _slots) {
+        if (!slot.used) {
+            return &slot;
+        }
+        if (slot.pinned || slot.last_used == _frame
+            || (prefetch && slot.last_used + VT_PREFETCH_AGE > _frame)) {
+            continue;
+        }
+        if (!victim || slot.last_used < victim->last_used) {
+            victim = &slot;
+        }
+    }
+    return victim;
+}
+
+void VirtualTextureCache::load_page(const Page& page, Slot& slot, u8* staging) {
+    if (slot.used) {
+        _resident.erase(slot.page.key());
+        _textures[slot.page.texture].dirty = true;
+    }
+    auto& vt = _textures[page.texture];
+    slot = {
+        .page = page,
+        .used = true,
+        .pinned = page.level == vt.root,
+        .last_used = _frame,
+    };
+    _resident[page.key()] = static_cast<usize>(&slot - _slots.data());
+    vt.dirty = true;
+
+    // the border wraps around like the repeat address mode
+    const auto width = std::max(vt.image.width >> page.level, 1u);
+    const auto height = std::max(vt.image.height >> page.level, 1u);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto* src = vt.image.data.data() + vt.image.levels[page.level].offset;
+    const auto x0 = static_cast<i64>(page.x * VT_PAGE_SIZE) - VT_PAGE_BORDER;
+    const auto y0 = static_cast<i64>(page.y * VT_PAGE_SIZE) - VT_PAGE_BORDER;
+    for (u32 y = 0; y < VT_SLOT_SIZE; y++) {
+        const auto sy = wrap_texel(y0 + y, height);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto* row = src + static_cast<usize>(sy) * width * 4;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        auto* dst = staging + static_cast<usize>(y) * VT_SLOT_SIZE * 4;
+        for (u32 x = 0; x < VT_SLOT_SIZE; x++) {
+            const auto sx = wrap_texel(x0 + x, width);
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            std::memcpy(dst + static_cast<usize>(x) * 4, row + static_cast<usize>(sx) * 4, 4);
+        }
+    }
+}
+
+void VirtualTextureCache::write_page_table(
+    u32 index,
+    FrameResources& frame,
+    std::vector<vk::BufferImageCopy>& regions
+) {
+    auto& vt = _textures[index];
+    vt.dirty = false;
+
+    // from the root down, so missing pages can copy their parent's entry
+    const usize base = index * VT_PAGE_TABLE_BYTES;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    auto* entries = reinterpret_cast<u32*>(frame.table_data + base);
+    for (u32 level = vt.root + 1; level-- > 0;) {
+        const auto pages_x = level_pages(vt.image.width, level);
+        const auto pages_y = level_pages(vt.image.height, level);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        auto* table = entries + level_offset(level);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto* parent = entries + level_offset(level + 1);
+        const auto parent_x = level_pages(vt.image.width, level + 1);
+
+        for (u32 y = 0; y < pages_y; y++) {
+            for (u32 x = 0; x < pages_x; x++) {
+                const Page page{.texture = index, .level = level, .x = x, .y = y};
+                u32 entry{};
+                const auto it = _resident.find(page.key());
+                if (it != _resident.end()) {
+                    // RGBA = slot x, slot y, level, resident
+                    const auto slot = static_cast<u32>(it->second);
+                    entry = (slot % VT_CACHE_SLOTS) | ((slot / VT_CACHE_SLOTS) << 8)
+                        | (level << 16) | (1u << 24);
+                } else if (level < vt.root) {
+                    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                    entry = parent[(y >> 1) * parent_x + (x >> 1)];
+                }
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                table[y * pages_x + x] = entry;
+            }
+        }
+
+        vk::BufferImageCopy region{};
+        region.setBufferOffset(base + level_offset(level) * sizeof(u32))
+            .setImageExtent({pages_x, pages_y, 1});
+        region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+            .setMipLevel(level)
+            .setBaseArrayLayer(index)
+            .setLayerCount(1);
+        regions.push_back(region);
+    }
+}
+
+}  // namespace hvk
@@ -1,8 +1,35 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
 #include "hvk/vk_context.hpp"
 #include "hvk/debug_utils.hpp"
 
 namespace hvk {
 
+// relative to the working directory, like shaders and assets
+inline constexpr std::string_view PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// checks the `VkPipelineCacheHeaderVersionOne` header of cache data loaded from
+// disk against the current device. drivers are required to reject mismatched
+// data themselves, but some are known to crash on it instead.
+bool is_pipeline_cache_compatible(
+    const std::vector<char>& data,
+    const vk::PhysicalDeviceProperties& props
+) {
+    if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) {
+        return false;
+    }
+
+    VkPipelineCacheHeaderVersionOne header{};
+    std::memcpy(&header, data.data(), sizeof(header));
+    bool same_uuid =
+        std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+    return header.headerSize >= sizeof(header)
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == props.vendorID && header.deviceID == props.deviceID && same_uuid;
+}
+
 vk::Extent2D
 get_surface_extent(vk::PhysicalDevice& gpu, vk::SurfaceKHR& surface, GLFWwindow* window) {
     const auto capabilities = gpu.getSurfaceCapabilitiesKHR(surface);
@@ -162,6 +189,7 @@ void VulkanContext::create_device() {
     }
 
     _gpu = devices[selected.value()];
+    _gpu_properties = _gpu.getProperties();
     select_queue_families();
 
     auto unique_queues = std::unordered_map<u32, u32>{};
@@ -198,6 +226,36 @@ void VulkanContext::create_device() {
     vk::PhysicalDeviceVulkan12Features phys_v12_features{};
     phys_v12_features.setSeparateDepthStencilLayouts(VK_TRUE);
 
+    // descriptor indexing features used for bindless textures, only enabled
+    // when the device supports all of them
+    auto supported =
+        _gpu.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    const auto& supported_v12 = supported.get<vk::PhysicalDeviceVulkan12Features>();
+    _bindless = _api_version >= VK_API_VERSION_1_2 && supported_v12.runtimeDescriptorArray
+        && supported_v12.descriptorBindingPartiallyBound
+        && supported_v12.descriptorBindingVariableDescriptorCount
+        && supported_v12.shaderSampledImageArrayNonUniformIndexing;
+    if (_bindless) {
+        phys_v12_features.setRuntimeDescriptorArray(VK_TRUE)
+            .setDescriptorBindingPartiallyBound(VK_TRUE)
+            .setDescriptorBindingVariableDescriptorCount(VK_TRUE)
+            .setShaderSampledImageArrayNonUniformIndexing(VK_TRUE);
+    }
+    spdlog::debug("Bindless textures {}", _bindless ? "enabled" : "not supported");
+
+    // block-compressed (BC1-7) textures
+    const auto& supported_v10 = supported.get<vk::PhysicalDeviceFeatures2>().features;
+    _texture_compression_bc = supported_v10.textureCompressionBC == VK_TRUE;
+    features.setTextureCompressionBC(_texture_compression_bc);
+    spdlog::debug(
+        "BC texture compression {}",
+        _texture_compression_bc ? "enabled" : "not supported"
+    );
+
+    // virtual texture feedback is written from fragment shaders
+    _fragment_stores = supported_v10.fragmentStoresAndAtomics == VK_TRUE;
+    features.setFragmentStoresAndAtomics(_fragment_stores);
+
     vk::DeviceCreateInfo create_info{};
     auto extensions = std::vector{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
     create_info.setQueueCreateInfos(queue_create_infos)
@@ -220,6 +278,62 @@ void VulkanContext::create_device() {
     _transfer_queue = _device->getQueue(_queue_family.transfer, queue_num);
 }
 
+void VulkanContext::create_pipeline_cache() {
+    std::vector<char> data{};
+    std::ifstream file{std::string{PIPELINE_CACHE_PATH}, std::ios::binary | std::ios::ate};
+    if (file.is_open()) {
+        data.resize(static_cast<usize>(file.tellg()));
+        file.seekg(0);
+        file.read(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file || !is_pipeline_cache_compatible(data, _gpu_properties)) {
+            spdlog::debug("Discarding incompatible pipeline cache '{}'", PIPELINE_CACHE_PATH);
+            data.clear();
+        }
+    }
+
+    spdlog::trace("Creating pipeline cache: initial_size={}", data.size());
+    vk::PipelineCacheCreateInfo info{};
+    info.setInitialDataSize(data.size()).setPInitialData(data.empty() ? nullptr : data.data());
+    _pipeline_cache = _device->createPipelineCacheUnique(info);
+}
+
+void VulkanContext::save_pipeline_cache() {
+    const auto& self = instance();
+    if (!self._pipeline_cache) {
+        return;
+    }
+
+    auto data = self._device->getPipelineCacheData(self._pipeline_cache.get());
+    if (data.empty()) {
+        return;
+    }
+
+    // write to a temporary file first so an interrupted save can never leave
+    // a truncated cache behind
+    std::filesystem::path path{PIPELINE_CACHE_PATH};
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream file{tmp, std::ios::binary | std::ios::trunc};
+        file.write(
+            reinterpret_cast<const char*>(data.data()),
+            static_cast<std::streamsize>(data.size())
+        );
+        if (!file) {
+            spdlog::warn("Failed to write pipeline cache '{}'", tmp.string());
+            return;
+        }
+    }
+
+    std::error_code ec{};
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        spdlog::warn("Failed to save pipeline cache '{}': {}", path.string(), ec.message());
+        return;
+    }
+    spdlog::debug("Saved pipeline cache '{}' ({} bytes)", path.string(), data.size());
+}
+
 void VulkanContext::create_allocator() {
     _allocator = Allocator{_instance.get(), _gpu, _device.get(), _api_version};
 }
@@ -0,0 +1,40 @@
+#version 450
+
+// position-only vertex stream, see `Vertex::position_binding_desc`
+layout (location = 0) in vec3 inPosition;
+
+layout (set = 0, binding = 0) uniform CameraData {
+    mat4 projection;
+    mat4 view;
+    mat4 viewProj;
+    vec3 pos;
+} camera;
+
+struct ObjectData {
+    // top three rows of the affine model matrix
+    mat3x4 transform;
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
+
+struct DrawData {
+    uint object;
+    uint material;
+};
+
+layout (std430, set = 0, binding = 3) readonly buffer DrawBuffer {
+    DrawData draws[];
+} drawBuffer;
+
+// must match the main pass exactly for `eEqual` depth testing
+invariant gl_Position;
+
+void main() {
+    DrawData draw = drawBuffer.draws[gl_InstanceIndex];
+    mat3x4 model = objectBuffer.objects[draw.object].transform;
+    vec3 worldPos = vec4(inPosition, 1.0) * model;
+
+    gl_Position = camera.viewProj * vec4(worldPos, 1.0);
+}
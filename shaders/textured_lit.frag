@@ -14,11 +14,15 @@ layout (set = 0, binding = 1) uniform SceneData {
 
 layout (set = 1, binding = 0) uniform sampler2D tex;
 
+// opaque materials are drawn with this disabled, the discard is compiled out
+// and early depth testing stays enabled
+layout (constant_id = 0) const bool ALPHA_TEST = true;
+
 const float LIGHT_MIN = 0.5;
 
 void main() {
     vec4 color = texture(tex, inTexCoord);
-    if (color.a < 0.01) {
+    if (ALPHA_TEST && color.a < 0.01) {
         discard;
     }
 
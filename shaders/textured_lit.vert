@@ -9,6 +9,7 @@ layout (location = 0) out vec3 fragPos;
 layout (location = 1) out vec3 fragNormal;
 layout (location = 2) out vec3 fragColor;
 layout (location = 3) out vec2 fragTexCoord;
+layout (location = 4) flat out uint fragMaterial;
 
 layout (set = 0, binding = 0) uniform CameraData {
     mat4 projection;
@@ -22,15 +23,45 @@ layout (set = 0, binding = 1) uniform SceneData {
     vec4 lightDir;
 } scene;
 
-layout (push_constant) uniform constants {
-    mat4 model;
-    mat4 normalTransform;
-} pc;
+struct ObjectData {
+    // top three rows of the affine model matrix
+    mat3x4 transform;
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
+
+struct DrawData {
+    uint object;
+    uint material;
+};
+
+layout (std430, set = 0, binding = 3) readonly buffer DrawBuffer {
+    DrawData draws[];
+} drawBuffer;
+
+// must match the depth pre-pass exactly for `eEqual` depth testing
+invariant gl_Position;
 
 void main() {
-    gl_Position = camera.viewProj * pc.model * vec4(inPosition, 1.0);
-    fragPos = vec3(pc.model * vec4(inPosition, 1.0));
-    fragNormal = normalize(mat3(pc.normalTransform) * inNormal);
+    DrawData draw = drawBuffer.draws[gl_InstanceIndex];
+    mat3x4 model = objectBuffer.objects[draw.object].transform;
+    vec3 worldPos = vec4(inPosition, 1.0) * model;
+
+    // cofactor of the upper 3x3 model matrix, which is proportional to the
+    // inverse-transpose and correct for normals once normalized
+    mat3 basis = transpose(mat3(model[0].xyz, model[1].xyz, model[2].xyz));
+    mat3 normalTransform = mat3(
+        cross(basis[1], basis[2]),
+        cross(basis[2], basis[0]),
+        cross(basis[0], basis[1])
+    );
+
+    gl_Position = camera.viewProj * vec4(worldPos, 1.0);
+    fragPos = worldPos;
+    fragNormal = normalize(normalTransform * inNormal);
     fragColor = inColor;
     fragTexCoord = inTexCoord;
+    fragMaterial = draw.material;
 }
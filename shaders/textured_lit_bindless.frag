@@ -0,0 +1,44 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec3 inColor;
+layout (location = 3) in vec2 inTexCoord;
+layout (location = 4) flat in uint inMaterial;
+
+layout (location = 0) out vec4 outColor;
+
+layout (set = 0, binding = 1) uniform SceneData {
+    vec4 lightColor;
+    vec4 lightDir;
+} scene;
+
+struct MaterialData {
+    vec4 baseColorFactor;
+    uint baseColorTexture;
+};
+
+layout (std430, set = 1, binding = 0) readonly buffer MaterialBuffer {
+    MaterialData materials[];
+} materialBuffer;
+
+layout (set = 1, binding = 1) uniform sampler2D textures[];
+
+// opaque materials are drawn with this disabled, the discard is compiled out
+// and early depth testing stays enabled
+layout (constant_id = 0) const bool ALPHA_TEST = true;
+
+const float LIGHT_MIN = 0.5;
+
+void main() {
+    MaterialData material = materialBuffer.materials[inMaterial];
+    // the material is uniform within a draw, but not across merged draws
+    vec4 color = texture(textures[nonuniformEXT(material.baseColorTexture)], inTexCoord);
+    if (ALPHA_TEST && color.a < 0.01) {
+        discard;
+    }
+
+    float light = max(LIGHT_MIN, dot(scene.lightDir.rgb, inNormal));
+    outColor = vec4(light * color.rgb, color.a) * scene.lightColor;
+}
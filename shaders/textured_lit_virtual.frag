@@ -0,0 +1,121 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec3 inColor;
+layout (location = 3) in vec2 inTexCoord;
+layout (location = 4) flat in uint inMaterial;
+
+layout (location = 0) out vec4 outColor;
+
+layout (set = 0, binding = 1) uniform SceneData {
+    vec4 lightColor;
+    vec4 lightDir;
+} scene;
+
+// one bit per page table entry, set for every page that was sampled
+layout (std430, set = 0, binding = 4) buffer FeedbackBuffer {
+    uint bits[];
+} feedback;
+
+struct VirtualTextureData {
+    uvec2 size;
+    uint rootLevel;
+    uint padding;
+};
+
+layout (std430, set = 0, binding = 5) readonly buffer VirtualTextureBuffer {
+    VirtualTextureData textures[];
+} virtualTextures;
+
+layout (set = 0, binding = 6) uniform sampler2D pageCache;
+// RGBA = cache slot x, cache slot y, level of the page in the slot, resident
+layout (set = 0, binding = 7) uniform usampler2DArray pageTables;
+
+struct MaterialData {
+    vec4 baseColorFactor;
+    uint baseColorTexture;
+    // 1 + index into the virtual texture buffer, 0 if not virtual
+    uint virtualTexture;
+};
+
+layout (std430, set = 1, binding = 0) readonly buffer MaterialBuffer {
+    MaterialData materials[];
+} materialBuffer;
+
+layout (set = 1, binding = 1) uniform sampler2D textures[];
+
+// opaque materials are drawn with this disabled, the discard is compiled out
+// and early depth testing stays enabled
+layout (constant_id = 0) const bool ALPHA_TEST = true;
+
+const float LIGHT_MIN = 0.5;
+
+// must match virtual_texture.hpp
+const uint PAGE_SIZE = 128;
+const uint PAGE_BORDER = 4;
+const uint SLOT_SIZE = PAGE_SIZE + 2 * PAGE_BORDER;
+const uint PAGE_TABLE_LEVELS = 8;
+const uint FEEDBACK_WORDS = 683;
+
+// first feedback bit of `level`, levels are laid out like the page table
+uint levelOffset(uint level) {
+    return ((1u << (2u * PAGE_TABLE_LEVELS)) - (1u << (2u * (PAGE_TABLE_LEVELS - level)))) / 3u;
+}
+
+// derivatives are taken by the caller in uniform control flow
+vec4 sampleVirtual(uint index, uint fallback, vec2 uv, vec2 dx, vec2 dy) {
+    VirtualTextureData vt = virtualTextures.textures[index];
+    vec2 size = vec2(vt.size);
+    float lod = 0.5 * log2(max(dot(dx * size, dx * size), dot(dy * size, dy * size)));
+    uint level = uint(clamp(floor(lod), 0.0, float(vt.rootLevel)));
+    // levels that fit in one page are an ordinary texture
+    if (level >= vt.rootLevel) {
+        return textureGrad(textures[nonuniformEXT(fallback)], uv, dx, dy);
+    }
+
+    vec2 wrapped = fract(uv);
+    uvec2 levelSize = max(vt.size >> level, uvec2(1));
+    uvec2 page = uvec2(wrapped * vec2(levelSize)) / PAGE_SIZE;
+
+    // a quarter of the pixels is plenty to find every visible page
+    if (((uint(gl_FragCoord.x) + uint(gl_FragCoord.y)) & 3u) == 0u) {
+        uint tableSize = (1u << (PAGE_TABLE_LEVELS - 1u)) >> level;
+        uint bit = levelOffset(level) + page.y * tableSize + page.x;
+        atomicOr(feedback.bits[index * FEEDBACK_WORDS + bit / 32u], 1u << (bit % 32u));
+    }
+
+    // the entry points at this page or its closest resident ancestor
+    uvec4 entry = texelFetch(pageTables, ivec3(page, index), int(level));
+    vec2 texel = wrapped * vec2(max(vt.size >> entry.z, uvec2(1)));
+    vec2 local = texel - floor(texel / float(PAGE_SIZE)) * float(PAGE_SIZE);
+    vec2 cacheTexel = vec2(entry.xy * SLOT_SIZE + PAGE_BORDER) + local;
+    return textureLod(pageCache, cacheTexel / vec2(textureSize(pageCache, 0)), 0.0);
+}
+
+void main() {
+    MaterialData material = materialBuffer.materials[inMaterial];
+    vec2 dx = dFdx(inTexCoord);
+    vec2 dy = dFdy(inTexCoord);
+
+    // the material is uniform within a draw, but not across merged draws
+    vec4 color;
+    if (material.virtualTexture != 0) {
+        color = sampleVirtual(
+            material.virtualTexture - 1,
+            material.baseColorTexture,
+            inTexCoord,
+            dx,
+            dy
+        );
+    } else {
+        color = texture(textures[nonuniformEXT(material.baseColorTexture)], inTexCoord);
+    }
+    if (ALPHA_TEST && color.a < 0.01) {
+        discard;
+    }
+
+    float light = max(LIGHT_MIN, dot(scene.lightDir.rgb, inNormal));
+    outColor = vec4(light * color.rgb, color.a) * scene.lightColor;
+}